@@ -26,6 +26,7 @@ void ExportNgsx_cutint(py::module &m)
            int subdivlvl,
            int time_order,
            SWAP_DIMENSIONS_POLICY quad_dir_policy,
+           py::object adefinedonelements,
            int heapsize)
         {
           static Timer t ("IntegrateX"); RegionTimer reg(t);
@@ -42,11 +43,24 @@ void ExportNgsx_cutint(py::module &m)
           double sum = 0.0;
           int DIM = ma->GetDimension();
 
-          Array<int> dnums;
-          ma->IterateElements
-            (VOL, lh, [&] (Ngs_Element el, LocalHeap & lh)
+          shared_ptr<BitArray> definedonelements = nullptr;
+          if (py::extract<shared_ptr<BitArray>> (adefinedonelements).check())
+            definedonelements = py::extract<shared_ptr<BitArray>>(adefinedonelements)();
+
+          Array<int> elnrs;
+          if (definedonelements)
+            BitArrayToIndices(*definedonelements, elnrs);
+          else
+          {
+            elnrs.SetSize(ma->GetNE(VOL));
+            for (int i : Range(elnrs))
+              elnrs[i] = i;
+          }
+
+          IterateIndices
+            (elnrs, lh, [&] (int elnr, LocalHeap & lh)
              {
-               auto & trafo = ma->GetTrafo (el, lh);
+               auto & trafo = ma->GetTrafo (ElementId(VOL,elnr), lh);
 
                const IntegrationRule * ir;
                Array<double> wei_arr;
@@ -78,6 +92,7 @@ void ExportNgsx_cutint(py::module &m)
         py::arg("subdivlvl")=0,
         py::arg("time_order")=-1,
         py::arg("quad_dir_policy")=FIND_OPTIMAL,
+        py::arg("definedonelements")=DummyArgument(),
         py::arg("heapsize")=1000000,
         docu_string(R"raw_string(
 Integrate on a level set domains. The accuracy of the integration is 'order' w.r.t. a (multi-)linear
@@ -119,6 +134,9 @@ heapsize : int
 
 quad_dir_policy : int
   policy for the selection of the order of integration directions
+
+definedonelements : ngsolve.BitArray / None
+  if provided, only the marked elements are visited (e.g. the cut elements for domain_type IF)
 )raw_string"));
 
 }
@@ -179,7 +179,7 @@ namespace ngcomp
 
 
   template<int D>
-  void CalcDeformationError (shared_ptr<CoefficientFunction> lset_ho, shared_ptr<GridFunction> gf_lset_p1, shared_ptr<GridFunction> deform, shared_ptr<CoefficientFunction> qn, StatisticContainer & cont, LocalHeap & clh, double lower_lset_bound, double upper_lset_bound){
+  void CalcDeformationError (shared_ptr<CoefficientFunction> lset_ho, shared_ptr<GridFunction> gf_lset_p1, shared_ptr<GridFunction> deform, shared_ptr<CoefficientFunction> qn, StatisticContainer & cont, LocalHeap & clh, double lower_lset_bound, double upper_lset_bound, bool batched, double * n_totalits, double * n_maxits){
     static Timer time_fct ("CalcDeformationError");
     RegionTimer reg (time_fct);
 
@@ -232,47 +232,76 @@ namespace ngcomp
         deform->GetVector().GetIndirect(dnums,elvec_as_vec);
 
         IntegrationRule ir = SelectIntegrationRule (eltrans.GetElementType(), 2*scafe.Order());
-        for (int l = 0; l < ir.GetNIP(); l++)
+        const int nip = ir.GetNIP();
+
+        // point search on all integration points at once:
+        FlatArray<Mat<D>> trafo_of_normals(nip, lh);
+        FlatMatrixFixWidth<D> normals(nip, lh);
+        FlatMatrixFixWidth<D> orig_points(nip, lh);
+        FlatMatrixFixWidth<D> final_points(nip, lh);
+        FlatVector<> goal_vals(nip, lh);
+        for (int l = 0; l < nip; l++)
         {
           MappedIntegrationPoint<D,D> mip(ir[l], eltrans);
-          scafe.CalcShape(ir[l],shape);
-          Vec<D> deform_h = Trans(elvec) * shape;
-
-          Vec<D> deform;
-          {    // point search:
-            Vec<D> grad;
-            CalcGradientOfCoeff(gf_lset_p1, mip, grad, lh);
-            Mat<D> trafo_of_normals = mip.GetJacobianInverse() * Trans(mip.GetJacobianInverse());
+          Vec<D> grad;
+          CalcGradientOfCoeff(gf_lset_p1, mip, grad, lh);
+          trafo_of_normals[l] = mip.GetJacobianInverse() * Trans(mip.GetJacobianInverse());
 
-            Vec<D> normal = mip.GetJacobianInverse() * grad;
-            double len = L2Norm(normal);
-            normal /= len;
-
-            Vec<D> qnormal;
-            if (qn)
-            {
-              qn->Evaluate(mip,qnormal);
-              normal = mip.GetJacobianInverse() * qnormal;
-              // double len = L2Norm(normal);
-              // normal /= len;
-              // qnormal /= L2Norm(qnormal);
-            }
-            Vec<D> orig_point;
-            for (int d = 0; d < D; ++d)
-              orig_point(d) = ir[l](d);
+          Vec<D> normal = mip.GetJacobianInverse() * grad;
+          double len = L2Norm(normal);
+          normal /= len;
 
-            double goal_val = gf_lset_p1->Evaluate(mip);
+          Vec<D> qnormal;
+          if (qn)
+          {
+            qn->Evaluate(mip,qnormal);
+            normal = mip.GetJacobianInverse() * qnormal;
+            // double len = L2Norm(normal);
+            // normal /= len;
+            // qnormal /= L2Norm(qnormal);
+          }
+          normals.Row(l) = normal;
+          for (int d = 0; d < D; ++d)
+            orig_points(l,d) = ir[l](d);
+          goal_vals(l) = gf_lset_p1->Evaluate(mip);
+        }
+        double el_totalits = 0.0;
+        double el_maxits = 0.0;
+        LsetEvaluator<D> lseteval(lset_ho, eltrans);
+        if (batched)
+          SearchCorrespondingPoints<D>(lseteval, orig_points, goal_vals,
+                                       trafo_of_normals, normals, false,
+                                       final_points, lh, &el_totalits, &el_maxits);
+        else
+          for (int l = 0; l < nip; l++)
+          {
+            Vec<D> orig_point = orig_points.Row(l);
+            Vec<D> normal = normals.Row(l);
             Vec<D> final_point;
-            SearchCorrespondingPoint<D>(LsetEvaluator<D>(lset_ho, eltrans),
-                                        orig_point, goal_val,
-                                        trafo_of_normals, normal, false,
-                                        final_point, lh);
-            Vec<D> ref_dist = (final_point - orig_point);
-            deform = mip.GetJacobian() * ref_dist;
-            // if (qn)
-            //   deform = InnerProduct(deform,qnormal) * qnormal;
-
+            SearchCorrespondingPoint<D>(lseteval, orig_point, goal_vals(l),
+                                        trafo_of_normals[l], normal, false,
+                                        final_point, lh, &el_totalits, &el_maxits);
+            final_points.Row(l) = final_point;
           }
+        if (n_totalits)
+        {
+#pragma omp atomic
+          *n_totalits += el_totalits;
+        }
+#pragma omp critical(maxits)
+        if (n_maxits && el_maxits > *n_maxits)
+          *n_maxits = el_maxits;
+
+        for (int l = 0; l < nip; l++)
+        {
+          MappedIntegrationPoint<D,D> mip(ir[l], eltrans);
+          scafe.CalcShape(ir[l],shape);
+          Vec<D> deform_h = Trans(elvec) * shape;
+
+          Vec<D> ref_dist = final_points.Row(l) - orig_points.Row(l);
+          Vec<D> deform = mip.GetJacobian() * ref_dist;
+          // if (qn)
+          //   deform = InnerProduct(deform,qnormal) * qnormal;
 
           deform_h -= deform;
 
@@ -454,10 +483,12 @@ namespace ngcomp
                                  double , bool );
   template void CalcDeformationError<2> (shared_ptr<CoefficientFunction> , shared_ptr<GridFunction> ,
                                          shared_ptr<GridFunction> , shared_ptr<CoefficientFunction> ,
-                                         StatisticContainer & , LocalHeap & , double , double );
+                                         StatisticContainer & , LocalHeap & , double , double ,
+                                         bool , double * , double * );
   template void CalcDeformationError<3> (shared_ptr<CoefficientFunction> , shared_ptr<GridFunction> ,
                                          shared_ptr<GridFunction> , shared_ptr<CoefficientFunction> ,
-                                         StatisticContainer & , LocalHeap & , double , double );
+                                         StatisticContainer & , LocalHeap & , double , double ,
+                                         bool , double * , double * );
   
 }
 
@@ -27,8 +27,11 @@ namespace ngcomp
   template <int D>
   void CalcDistances (shared_ptr<CoefficientFunction> gf_lset_ho, shared_ptr<GridFunction> gf_lset_p1, shared_ptr<GridFunction> deform, StatisticContainer & cont, LocalHeap & lh, double define_threshold = -1.0, bool abs_ref_threshold = false);
 
+  // batched: point searches of all integration points of an element at once (SearchCorrespondingPoints),
+  // n_totalits/n_maxits: total/maximum number of iterations of the point searches in the elements
   template<int D>
-  void CalcDeformationError (shared_ptr<CoefficientFunction> lset_ho, shared_ptr<GridFunction> gf_lset_p1, shared_ptr<GridFunction> deform, shared_ptr<CoefficientFunction> qn, StatisticContainer & cont, LocalHeap & lh, double, double);
+  void CalcDeformationError (shared_ptr<CoefficientFunction> lset_ho, shared_ptr<GridFunction> gf_lset_p1, shared_ptr<GridFunction> deform, shared_ptr<CoefficientFunction> qn, StatisticContainer & cont, LocalHeap & lh, double, double,
+                             bool batched = true, double * n_totalits = nullptr, double * n_maxits = nullptr);
 
   
 }
@@ -1,4 +1,5 @@
 #include "calcpointshift.hpp"
+#include <comp.hpp>   // for GridFunction
 
 // using namespace ngsolve;
 using namespace ngfem;
@@ -6,6 +7,33 @@ using namespace ngfem;
 namespace ngfem
 { 
 
+  // gradient of a scalar GridFunction with a ScalarFiniteElement on the element
+  // of mip (by its dshape), returns false if this is not possible
+  template<int D>
+  static bool CalcGradientOfGridFunction(const ngcomp::GridFunction & gf, const MappedIntegrationPoint<D,D>& mip,
+                                         Vec<D>& der, LocalHeap& lh)
+  {
+    const ElementTransformation & eltrans = mip.GetTransformation();
+    auto fes = gf.GetFESpace();
+    if (eltrans.VB() != VOL || fes->GetDimension() != 1 || gf.GetMultiDim() != 1
+        || fes->GetMeshAccess()->GetDimension() != D)
+      return false;
+
+    ElementId ei(VOL, eltrans.GetElementNr());
+    auto scafe = dynamic_cast<const ScalarFiniteElement<D>*>(&fes->GetFE(ei, lh));
+    if (!scafe)
+      return false;
+    ArrayMem<int,100> dnums;
+    fes->GetDofNrs(ei, dnums);
+    FlatVector<> vals(dnums.Size(), lh);
+    gf.GetVector().GetIndirect(dnums, vals);
+    FlatMatrixFixWidth<D> dshape(scafe->GetNDof(), lh);
+    scafe->CalcDShape(mip.IP(), dshape);
+    Vec<D> der_ref = Trans(dshape) * vals;
+    der = Trans(mip.GetJacobianInverse()) * der_ref;
+    return true;
+  }
+
   template<int D>
   void CalcGradientOfCoeff(shared_ptr<CoefficientFunction> coef, const MappedIntegrationPoint<D,D>& mip,
                            Vec<D>& der, LocalHeap& lh)
@@ -14,31 +42,33 @@ namespace ngfem
     RegionTimer reg (time_fct);
 
     HeapReset hr(lh);
-    // bmatu = 0;
-    // evaluate dshape by numerical diff
-    //fel_u, eltrans, sip, returnval, lh
 
-    const IntegrationPoint& ip = mip.IP();//volume_ir[i];
+    // GridFunctions: exact gradient
+    if (auto gf = dynamic_pointer_cast<ngcomp::GridFunction>(coef))
+      if (CalcGradientOfGridFunction(*gf, mip, der, lh))
+        return;
+
+    // other coefficient functions: evaluate dshape by numerical diff
+    // (all 2*D points in one evaluation)
+    const IntegrationPoint& ip = mip.IP();
     const ElementTransformation & eltrans = mip.GetTransformation();
     
-    Vec<D> der_ref;
-  
     double eps = 1e-7;
+    IntegrationRule ir(2*D, lh);
     for (int j = 0; j < D; j++)   // d / dxj
     {
-      IntegrationPoint ipl(ip);
-      ipl(j) -= eps;
-      MappedIntegrationPoint<D,D> mipl(ipl, eltrans);
-
-      IntegrationPoint ipr(ip);
-      ipr(j) += eps;
-      MappedIntegrationPoint<D,D> mipr(ipr, eltrans);
-
-      const double valright = coef->Evaluate(mipr);
-      const double valleft = coef->Evaluate(mipl);
-      
-      der_ref[j] = (1.0/(2*eps)) * (valright-valleft);
+      ir[2*j] = ip;
+      ir[2*j](j) -= eps;
+      ir[2*j+1] = ip;
+      ir[2*j+1](j) += eps;
     }
+    MappedIntegrationRule<D,D> mir(ir, eltrans, lh);
+    FlatMatrix<> vals(2*D, 1, lh);
+    coef->Evaluate(mir, vals);
+
+    Vec<D> der_ref;
+    for (int j = 0; j < D; j++)
+      der_ref[j] = (1.0/(2*eps)) * (vals(2*j+1,0)-vals(2*j,0));
     der = Trans(mip.GetJacobianInverse()) * der_ref;
   }
 
@@ -80,6 +110,60 @@ namespace ngfem
   }
 
 
+  template<int D>
+  void LsetEvaluator<D>::Evaluate(const IntegrationRule & ir, FlatVector<> vals, LocalHeap & lh) const
+  {
+    HeapReset hr (lh);
+    if (scafe)
+    {
+      try
+      {
+        SIMD_IntegrationRule simd_ir(ir, lh);
+        FlatVector<SIMD<double>> simd_vals(simd_ir.Size(), lh);
+        scafe->Evaluate(simd_ir, scavalues, simd_vals);
+        FlatVector<> flat_vals(simd_ir.Size()*SIMD<double>::Size(), reinterpret_cast<double*>(&simd_vals(0)));
+        vals = flat_vals.Range(0, ir.Size());
+        return;
+      }
+      catch (ExceptionNOSIMD e)
+      {
+        scafe->Evaluate(ir, scavalues, vals);
+        return;
+      }
+    }
+    for (size_t i = 0; i < ir.Size(); ++i)
+      vals(i) = Evaluate(ir[i], lh);
+  }
+
+  template<int D>
+  void LsetEvaluator<D>::EvaluateGrad(const IntegrationRule & ir, FlatMatrixFixWidth<D> grads, LocalHeap & lh) const
+  {
+    HeapReset hr (lh);
+    if (scafe)
+    {
+      try
+      {
+        SIMD_IntegrationRule simd_ir(ir, lh);
+        FlatMatrix<SIMD<double>> simd_grads(D, simd_ir.Size(), lh);
+        scafe->EvaluateGrad(simd_ir, scavalues, simd_grads);
+        for (int d = 0; d < D; ++d)
+        {
+          FlatVector<> flat_grad(simd_ir.Size()*SIMD<double>::Size(), reinterpret_cast<double*>(&simd_grads(d,0)));
+          grads.Col(d) = flat_grad.Range(0, ir.Size());
+        }
+        return;
+      }
+      catch (ExceptionNOSIMD e)
+      {
+        scafe->EvaluateGrad(ir, scavalues, grads);
+        return;
+      }
+    }
+    for (size_t i = 0; i < ir.Size(); ++i)
+      grads.Row(i) = EvaluateGrad(ir[i], lh);
+  }
+
+
   bool ElementInRelevantBand (shared_ptr<CoefficientFunction> lset_p1,
                               const ElementTransformation & eltrans,
                               double lower_lset_bound, 
@@ -120,22 +204,22 @@ namespace ngfem
                               double lower_lset_bound, 
                               double upper_lset_bound)
   {
-    bool has_neg = false;
-    bool has_pos = false;
-    for (int s = 0; s < lset_p1.Size(); ++s)
+    if (lset_p1.Size() == 0) return false;
+    // min/max reduction without branches (vectorizes), zero values count for both sides
+    double minval = lset_p1[0];
+    double maxval = lset_p1[0];
+    double minabs = abs(lset_p1[0]);
+    for (int s = 1; s < lset_p1.Size(); ++s)
     {
       const double val = lset_p1[s];
-      if (val==0.0) has_neg = has_pos = true;
-      if (val > lower_lset_bound)
-        has_pos = true;
-      if (val < upper_lset_bound)
-        has_neg = true;
+      minval = min2(minval, val);
+      maxval = max2(maxval, val);
+      minabs = min2(minabs, abs(val));
     }
-    
-    if (!has_neg || !has_pos)
-      return false;
-    else
-      return true;
+    const bool has_zero = minabs == 0.0;
+    const bool has_pos = has_zero || maxval > lower_lset_bound;
+    const bool has_neg = has_zero || minval < upper_lset_bound;
+    return has_neg && has_pos;
   }  
 
 
@@ -206,6 +290,94 @@ namespace ngfem
   }
 
 
+  template<int D>
+  void SearchCorrespondingPoints (
+    const LsetEvaluator<D> & lseteval,
+    FlatMatrixFixWidth<D> init_points, FlatVector<> goal_vals,
+    FlatArray<Mat<D>> trafo_of_normals, FlatMatrixFixWidth<D> init_search_dirs,
+    bool dynamic_search_dir,
+    FlatMatrixFixWidth<D> final_points, LocalHeap & lh,
+    double * n_totalits,
+    double * n_maxits)
+  {
+    static Timer time_fct ("SearchCorrespondingPoints");
+    RegionTimer reg (time_fct);
+
+    HeapReset hr(lh);
+    const size_t np = init_points.Height();
+    final_points = init_points;
+    FlatMatrixFixWidth<D> search_dirs(np, lh);
+    search_dirs = init_search_dirs;
+
+    // points that have not converged yet (and their number of iterations)
+    FlatArray<int> active(np, lh);
+    FlatArray<int> its(np, lh);
+    for (size_t i = 0; i < np; ++i)
+    {
+      active[i] = i;
+      its[i] = 20;
+    }
+    size_t nactive = np;
+
+    for (int it = 0; it < 20 && nactive > 0; ++it)
+    {
+      HeapReset hr_it(lh);
+      IntegrationRule ir(nactive, lh);
+      for (size_t k = 0; k < nactive; ++k)
+      {
+        IntegrationPoint ip(0.0,0.0,0.0,0.0);
+        for (int d = 0; d < D; ++d) ip(d) = final_points(active[k],d);
+        ir[k] = ip;
+      }
+      FlatVector<> curr_vals(nactive, lh);
+      FlatMatrixFixWidth<D> curr_grads(nactive, lh);
+      lseteval.Evaluate(ir, curr_vals, lh);
+      lseteval.EvaluateGrad(ir, curr_grads, lh);
+
+      size_t still_active = 0;
+      for (size_t k = 0; k < nactive; ++k)
+      {
+        const int i = active[k];
+        const double curr_defect = goal_vals(i) - curr_vals(k);
+        if (abs(curr_defect) < 1e-14)
+        {
+          its[i] = it;
+          continue;
+        }
+        Vec<D> curr_grad = curr_grads.Row(k);
+        if (dynamic_search_dir)
+          search_dirs.Row(i) = trafo_of_normals[i] * curr_grad;
+        Vec<D> search_dir = search_dirs.Row(i);
+        const double dphidn = InnerProduct(curr_grad,search_dir);
+        final_points.Row(i) += curr_defect / dphidn * search_dir;
+        active[still_active++] = i;
+      }
+      nactive = still_active;
+    }
+
+    for (size_t k = 0; k < nactive; ++k)
+    {
+      std::cout << " SearchCorrespondingPoint:: did not converge " << std::endl;
+      final_points.Row(active[k]) = init_points.Row(active[k]);
+    }
+
+    if (n_totalits)
+    {
+      double sum_its = 0;
+      for (auto it : its) sum_its += it;
+#pragma omp critical (totalits)
+      *n_totalits += sum_its;
+    }
+    if (n_maxits)
+    {
+      int max_its = 0;
+      for (auto it : its) max_its = max2(max_its, it);
+#pragma omp critical (maxits)
+      *n_maxits = max2((double)max_its,*n_maxits);
+    }
+  }
+
+
   template void CalcGradientOfCoeff<2>
   (shared_ptr<CoefficientFunction>, const MappedIntegrationPoint<2,2>&, Vec<2>&, LocalHeap&);
   template void CalcGradientOfCoeff<3>
@@ -216,5 +388,8 @@ namespace ngfem
   
   template void SearchCorrespondingPoint<2> (const LsetEvaluator<2> &, const Vec<2> &, double, const Mat<2> &, const Vec<2> &, bool, Vec<2> &, LocalHeap &, double *, double *);
   template void SearchCorrespondingPoint<3> (const LsetEvaluator<3> &, const Vec<3> &, double, const Mat<3> &, const Vec<3> &, bool, Vec<3> &, LocalHeap &, double *, double *);
+
+  template void SearchCorrespondingPoints<2> (const LsetEvaluator<2> &, FlatMatrixFixWidth<2>, FlatVector<>, FlatArray<Mat<2>>, FlatMatrixFixWidth<2>, bool, FlatMatrixFixWidth<2>, LocalHeap &, double *, double *);
+  template void SearchCorrespondingPoints<3> (const LsetEvaluator<3> &, FlatMatrixFixWidth<3>, FlatVector<>, FlatArray<Mat<3>>, FlatMatrixFixWidth<3>, bool, FlatMatrixFixWidth<3>, LocalHeap &, double *, double *);
   
 }
@@ -30,6 +30,9 @@ namespace ngfem
 
     double Evaluate(const IntegrationPoint & ip, LocalHeap & lh) const;
     Vec<D> EvaluateGrad(const IntegrationPoint & ip, LocalHeap & lh) const;
+    // values and (reference) gradients on a whole point set (SIMD for a finite element)
+    void Evaluate(const IntegrationRule & ir, FlatVector<> vals, LocalHeap & lh) const;
+    void EvaluateGrad(const IntegrationRule & ir, FlatMatrixFixWidth<D> grads, LocalHeap & lh) const;
   };
 
 
@@ -55,5 +58,19 @@ namespace ngfem
     double * n_totalits = nullptr,
     double * n_maxits = nullptr
     );
+
+  // batched version of SearchCorrespondingPoint for all points (rows) of an
+  // element: the Newton iterations evaluate lset_ho on all active points at
+  // once and stop when all points have converged
+  template<int D>
+  void SearchCorrespondingPoints (
+    const LsetEvaluator<D> & lseteval,                                         //<- lset_ho
+    FlatMatrixFixWidth<D> init_points, FlatVector<> goal_vals,                 //<- init.points and goal vals
+    FlatArray<Mat<D>> trafo_of_normals, FlatMatrixFixWidth<D> init_search_dirs, //<- search directions
+    bool dynamic_search_dir,
+    FlatMatrixFixWidth<D> final_points, LocalHeap & lh,                        //<- result and localheap
+    double * n_totalits = nullptr,
+    double * n_maxits = nullptr
+    );
   
 }
@@ -105,11 +105,24 @@ The computed deformation depends on different options:
         self.deform = GridFunction(self.v_def, "deform")
         self.heapsize = heapsize
 
+        # number of vertices and elements at the last update of the spaces and
+        # elements of the last band (only there lset_ho, qn and deform are nonzero)
+        self.mesh_size = (mesh.nv, mesh.ne)
+        self.band = None
+
     def CalcDeformation(self, levelset, ba =None, blending=None):
         """
 Compute the mesh deformation, s.t. isolines on cut elements of lset_p1 (the piecewise linear
 approximation) are mapped towards the corresponding isolines of a given function
 
+lset_p1 is the (nodal) P1 interpolation of levelset. lset_ho, qn and the deformation are only
+computed on the elements of the band (lset_lower_bound, lset_upper_bound) (or ba) and are zero
+elsewhere (see CalcDeformationInBand). The band is stored in self.band.
+
+Note: lset_p1 used to be the P1 interpolation of lset_ho, i.e. it had the vertex values of the
+projection of levelset. Both agree if levelset is in the space of lset_ho, otherwise they (and
+hence the band and the deformation) can differ slightly.
+
 Parameters:
 
 levelset : CoefficientFunction
@@ -129,37 +142,42 @@ blending : None/string/CoefficientFunction
      order polynomial with lset_p1. It is scaled with h, so that value 1 is not reached within cut
      elements.
         """
-        self.v_ho.Update()
-        self.lset_ho.Update()
-        self.v_p1.Update()
-        self.lset_p1.Update()
-        self.v_qn.Update()
-        self.qn.Update()
-        self.v_def.Update()
-        self.deform.Update()
-        
-        self.lset_ho.Set(levelset)
-        self.qn.Set(self.lset_ho.Deriv())
-        InterpolateToP1(self.lset_ho,self.lset_p1,eps_perturbation=self.eps_perturbation)
+        mesh = self.v_p1.mesh
+        if self.mesh_size != (mesh.nv, mesh.ne):
+            self.v_ho.Update()
+            self.lset_ho.Update()
+            self.v_p1.Update()
+            self.lset_p1.Update()
+            self.v_qn.Update()
+            self.qn.Update()
+            self.v_def.Update()
+            self.deform.Update()
+            self.mesh_size = (mesh.nv, mesh.ne)
+            self.band = None
+
         if blending == None or blending == "none":
             blending = CoefficientFunction(0.0)
         elif blending == "quadratic":
-            scale=sqrt(self.lset_p1.space.mesh.dim) * specialcf.mesh_size
+            scale=sqrt(mesh.dim) * specialcf.mesh_size
             blending = self.lset_p1*self.lset_p1/( scale * scale)
         elif blending == "quartic":
-            scale=sqrt(self.lset_p1.space.mesh.dim) * specialcf.mesh_size
+            scale=sqrt(mesh.dim) * specialcf.mesh_size
             blending = self.lset_p1*self.lset_p1*self.lset_p1*self.lset_p1/(scale*scale*scale*scale)
-            
-        ProjectShift(self.lset_ho,
-                     self.lset_p1,
-                     self.deform,
-                     self.qn,
-                     ba,
-                     blending,
-                     lower=self.lset_lower_bound,
-                     upper=self.lset_upper_bound,
-                     threshold=self.threshold,
-                     heapsize=self.heapsize)
+
+        # lset_p1, the band, lset_ho, qn and the deformation (only on the band)
+        self.band = CalcDeformationInBand(levelset,
+                                          self.lset_ho,
+                                          self.lset_p1,
+                                          self.deform,
+                                          self.qn,
+                                          ba,
+                                          blending,
+                                          lower=self.lset_lower_bound,
+                                          upper=self.lset_upper_bound,
+                                          threshold=self.threshold,
+                                          eps_perturbation=self.eps_perturbation,
+                                          last_band=self.band,
+                                          heapsize=self.heapsize)
         return self.deform
 
 
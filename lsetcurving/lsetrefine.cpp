@@ -6,14 +6,22 @@
 
 #include "lsetrefine.hpp"
 #include "calcpointshift.hpp"
+#include "projshift.hpp"
 
 namespace ngcomp
 { 
 
-  void RefineAtLevelSet (shared_ptr<GridFunction> gf_lset_p1, double lower_lset_bound, double upper_lset_bound, LocalHeap & lh){
+  shared_ptr<BitArray> RefineAtLevelSet (shared_ptr<GridFunction> gf_lset_p1, double lower_lset_bound, double upper_lset_bound, LocalHeap & lh){
 
+    static Timer time_fct ("LsetCurv::RefineAtLevelSet");
+    RegionTimer reg (time_fct);
     auto ma = gf_lset_p1->GetMeshAccess();
     const int D = ma->GetDimension();
+
+    // element only marked if "at the interface" (parallel)
+    shared_ptr<BitArray> band = GetElementsInRelevantBand(gf_lset_p1, lower_lset_bound, upper_lset_bound);
+
+    // the netgen refinement flags are set in one (serial) pass
     if (D == 3)
     {
       int nse = ma->GetNSE();
@@ -22,22 +30,10 @@ namespace ngcomp
     }
 
     int ne=ma->GetNE();
-      
     for (int elnr = 0; elnr < ne; ++elnr)
-    {
-      HeapReset hr(lh);
-      // element only measure error if "at the interface"
-      Array<int> dnums_lset_p1;
-      gf_lset_p1->GetFESpace()->GetDofNrs(ElementId(VOL,elnr),dnums_lset_p1);
-      FlatVector<> lset_vals_p1(dnums_lset_p1.Size(),lh);
-      gf_lset_p1->GetVector().GetIndirect(dnums_lset_p1,lset_vals_p1);
-
-      if (ElementInRelevantBand(lset_vals_p1, lower_lset_bound, upper_lset_bound))
-        Ng_SetRefinementFlag (elnr+1, 1);
-      else
-        Ng_SetRefinementFlag (elnr+1, 0);
-    }
-      
+      Ng_SetRefinementFlag (elnr+1, band->Test(elnr) ? 1 : 0);
+
+    return band;
   }
 
 }
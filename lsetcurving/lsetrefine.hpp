@@ -14,6 +14,7 @@ using namespace ngfem;
 namespace ngcomp
 { 
 
-  void RefineAtLevelSet (shared_ptr<GridFunction> gf_lset_p1, double lower_lset_bound, double upper_lset_bound, LocalHeap & lh);
+  // marks (and returns) the elements where the P1 level set has values in [lower_lset_bound, upper_lset_bound]
+  shared_ptr<BitArray> RefineAtLevelSet (shared_ptr<GridFunction> gf_lset_p1, double lower_lset_bound, double upper_lset_bound, LocalHeap & lh);
   
 }
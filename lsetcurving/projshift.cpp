@@ -1,22 +1,94 @@
 #include "projshift.hpp"
 #include "calcpointshift.hpp"
 #include "shiftintegrators.hpp"
+#include "../utils/p1interpol.hpp"
+#include "../xfem/cutinfo.hpp"
 
 namespace ngcomp
 {
 
-  void ProjectShift (shared_ptr<GridFunction> lset_ho, shared_ptr<GridFunction> lset_p1,
-                     shared_ptr<GridFunction> deform, shared_ptr<CoefficientFunction> qn,
-                     shared_ptr<BitArray> ba,
-                     shared_ptr<CoefficientFunction> blending,
-                     double lower_lset_bound, double upper_lset_bound, double threshold,
-                     LocalHeap & clh)
+  // Inverse mass matrices of affine simplices: M_T^{-1} = M_ref^{-1} / |det J|.
+  // The high order shape functions depend on the ordering of the element
+  // vertices, so M_ref^{-1} is cached per ordering (for a fixed order).
+  class ReferenceMassInverseCache
+  {
+    shared_ptr<MeshAccess> ma;
+    Array<shared_ptr<Matrix<>>> massinv;   // per vertex ordering code
+    Array<int> orders;
+
+    static int OrderingCode (FlatArray<int> verts)
+    {
+      int code = 0;
+      for (int k = verts.Size()-1; k >= 0; --k)
+      {
+        int rank = 0;
+        for (auto v : verts)
+          if (v < verts[k])
+            rank++;
+        code = code * verts.Size() + rank;
+      }
+      return code;
+    }
+
+    static bool IsCachedType (ELEMENT_TYPE et) { return et == ET_TRIG || et == ET_TET; }
+  public:
+    ReferenceMassInverseCache (const FESpace & fes, const BitArray & els,
+                               const BilinearFormIntegrator & mass, LocalHeap & lh)
+      : ma(fes.GetMeshAccess())
+    {
+      massinv.SetSize(256);  // 4^4 orderings of a tetrahedron
+      massinv = nullptr;
+      orders.SetSize(256);
+      for (size_t elnr = 0; elnr < els.Size(); ++elnr)
+      {
+        if (!els.Test(elnr)) continue;
+        HeapReset hr(lh);
+        ElementId ei(VOL,elnr);
+        Ngs_Element ngel = ma->GetElement(ei);
+        if (!IsCachedType(ngel.GetType())) continue;
+        int code = OrderingCode(ngel.Vertices());
+        if (massinv[code]) continue;
+        const ElementTransformation & eltrans = ma->GetTrafo(ei, lh);
+        if (eltrans.IsCurvedElement()) continue;
+        const FiniteElement & fel = fes.GetFE(ei, lh);
+        auto minv = make_shared<Matrix<>>(fel.GetNDof());
+        mass.CalcElementMatrix(fel, eltrans, *minv, lh);
+        IntegrationPoint ip(0.0,0.0,0.0);
+        *minv *= 1.0/eltrans(ip, lh).GetMeasure();
+        CalcInverse(*minv);
+        massinv[code] = minv;
+        orders[code] = fel.Order();
+      }
+    }
+
+    // false if the element is not an affine simplex of a cached ordering and order
+    bool GetInverse (int elnr, const FiniteElement & fel, const ElementTransformation & eltrans,
+                     FlatMatrix<> minv, LocalHeap & lh) const
+    {
+      Ngs_Element ngel = ma->GetElement(ElementId(VOL,elnr));
+      if (!IsCachedType(ngel.GetType()) || eltrans.IsCurvedElement())
+        return false;
+      int code = OrderingCode(ngel.Vertices());
+      if (!massinv[code] || orders[code] != fel.Order() || massinv[code]->Height() != size_t(fel.GetNDof()))
+        return false;
+      HeapReset hr(lh);
+      IntegrationPoint ip(0.0,0.0,0.0);
+      minv = (1.0/eltrans(ip, lh).GetMeasure()) * *massinv[code];
+      return true;
+    }
+  };
+
+  // Computes the shift on the elements in band and averages it on shared dofs.
+  // Only dofs of band elements are written (the first element that visits a
+  // dof overwrites the old value).
+  static void ProjectShiftOnBand (shared_ptr<GridFunction> lset_ho, shared_ptr<GridFunction> lset_p1,
+                                  shared_ptr<GridFunction> deform, shared_ptr<CoefficientFunction> qn,
+                                  const BitArray & band,
+                                  shared_ptr<CoefficientFunction> blending,
+                                  double lower_lset_bound, double upper_lset_bound, double threshold,
+                                  LocalHeap & clh)
   {
-    static Timer time_fct ("LsetCurv::ProjectShift");
-    RegionTimer reg (time_fct);
-    
     auto ma = lset_p1->GetMeshAccess();
-    int ne=ma->GetNE();
     int D =ma->GetDimension();
 
     shared_ptr<BilinearFormIntegrator> mass;
@@ -42,9 +114,12 @@ namespace ngcomp
     else
       shift3D = make_shared<ShiftIntegrator<3>>(shift_array);
 
-    shared_ptr<BaseVector> factor = deform->GetVector().CreateVector();
-    *factor = 0.0;
-    deform->GetVector() = 0.0;
+    ReferenceMassInverseCache massinv_cache(*deform->GetFESpace(), band, *mass, clh);
+
+    // number of band elements per dof (for the averaging)
+    Array<int> factor(deform->GetFESpace()->GetNDof());
+    factor = 0;
+    FlatVector<> def_vec = deform->GetVector().FVDouble();
 
     ProgressOutput progress (ma, "project shift on element", ma->GetNE());
 
@@ -55,29 +130,23 @@ namespace ngcomp
          HeapReset hr(lh);
          progress.Update();
       
-         Array<int> p1_dofs;
-         lset_p1->GetFESpace()->GetDofNrs(el,p1_dofs);
-         FlatVector<> vals(p1_dofs.Size(),lh);
-         lset_p1->GetVector().GetIndirect(p1_dofs,vals);
-         const ElementTransformation & eltrans = el.GetTrafo();
-      
-         if ( (ba) && ( !(ba->Test(elnr)) ))
-           return;
-         if ( (!ba) && !ElementInRelevantBand(vals, lower_lset_bound, upper_lset_bound) )
+         if (!band.Test(elnr))
            return;
 
+         const ElementTransformation & eltrans = el.GetTrafo();
          int ndofs = el.GetDofs().Size();
          const FiniteElement & fel_deform = el.GetFE();
-         // FlatVector<> vals(def_dofs.Size(),lh);
-         // lset_p1->GetVector().GetIndirect(def_dofs,vals);
          FlatMatrix<> massmat (ndofs,lh);
          FlatVector<> elvec (D*ndofs,lh);
          FlatVector<> elres (D*ndofs,lh);
-         mass->CalcElementMatrix(fel_deform, eltrans, massmat, lh);
-         CalcInverse(massmat);
+         if (!massinv_cache.GetInverse(elnr, fel_deform, eltrans, massmat, lh))
+         {
+           mass->CalcElementMatrix(fel_deform, eltrans, massmat, lh);
+           CalcInverse(massmat);
+         }
 
       
-         Array<int> lset_ho_dofs;
+         ArrayMem<int,100> lset_ho_dofs;
          lset_ho->GetFESpace()->GetDofNrs(el,lset_ho_dofs);
          FlatVector<> lset_ho_vals(lset_ho_dofs.Size(),lh);
          lset_ho->GetVector().GetIndirect(lset_ho_dofs,lset_ho_vals);
@@ -86,8 +155,8 @@ namespace ngcomp
          if (D==2)
          {
            const ScalarFiniteElement<2> & scafe_lset_ho = dynamic_cast< const ScalarFiniteElement<2> &>(fel_lset_ho);
-           shared_ptr<LsetEvaluator<2>> lseteval = make_shared<LsetEvaluator<2>>(scafe_lset_ho,lset_ho_vals);
-           shift2D->CalcElementVector(fel_deform, eltrans, elvec, lh, lseteval);
+           LsetEvaluator<2> lseteval(scafe_lset_ho,lset_ho_vals);
+           shift2D->CalcElementVector(fel_deform, eltrans, elvec, lh, &lseteval);
         
            FlatMatrixFixWidth<2> elvec_vec(ndofs,&elvec(0));
            FlatMatrixFixWidth<2> shift_vec(ndofs,&elres(0));
@@ -100,9 +169,9 @@ namespace ngcomp
          else
          {
            const ScalarFiniteElement<3> & scafe_lset_ho = dynamic_cast< const ScalarFiniteElement<3> &>(fel_lset_ho);
-           shared_ptr<LsetEvaluator<3>> lseteval = make_shared<LsetEvaluator<3>>(scafe_lset_ho,lset_ho_vals);
+           LsetEvaluator<3> lseteval(scafe_lset_ho,lset_ho_vals);
         
-           shift3D->CalcElementVector(fel_deform, eltrans, elvec, lh, lseteval);
+           shift3D->CalcElementVector(fel_deform, eltrans, elvec, lh, &lseteval);
         
            FlatMatrixFixWidth<3> elvec_vec(ndofs,&elvec(0));
            FlatMatrixFixWidth<3> shift_vec(ndofs,&elres(0));
@@ -113,64 +182,196 @@ namespace ngcomp
              shift_vec.Row(l) = 0.0;
          }
 
-         FlatVector<> def_vals(D*ndofs,lh);
-         deform->GetVector().GetIndirect(el.GetDofs(),def_vals);
-         def_vals += elres;
-         deform->GetVector().SetIndirect(el.GetDofs(),def_vals);
-
-         // increase dof counter
-         FlatVector<> factors(D*ndofs,lh);
-         factor->GetIndirect(el.GetDofs(),factors);
-         for (int k = 0; k < factors.Size(); k+=D)
-           factors(k) += 1.0 ;
-         factor->SetIndirect(el.GetDofs(),factors);
-
-         
+         // sum up the deformation (elements of the same color do not share dofs)
+         auto dofs = el.GetDofs();
+         for (int j = 0; j < ndofs; ++j)
+         {
+           if (!IsRegularDof(dofs[j])) continue;
+           for (int d = 0; d < D; ++d)
+             if (factor[dofs[j]] == 0)
+               def_vec(D*dofs[j]+d) = elres(D*j+d);
+             else
+               def_vec(D*dofs[j]+d) += elres(D*j+d);
+           factor[dofs[j]]++;
+         }
        });
     
     progress.Done();
-    
-    if (task_manager)
+
+    // averaging of the (summed) deformation
+    ParallelFor (factor.Size(), [&] (size_t i)
+    {
+      if (factor[i] > 1)
+        def_vec.Range(D*i, D*(i+1)) *= 1.0/factor[i];
+    });
+  }
+
+
+  // element-wise L2 projection of cf on the elements in els, averaged on shared
+  // dofs. Only dofs of elements in els are written.
+  static void SetValuesOnElements (shared_ptr<CoefficientFunction> cf, shared_ptr<GridFunction> gf,
+                                   const BitArray & els, LocalHeap & clh)
+  {
+    auto fes = gf->GetFESpace();
+    int dim = fes->GetDimension();
+    FlatVector<> vec = gf->GetVector().FVDouble();
+    Array<int> cnt(fes->GetNDof());
+    cnt = 0;
+
+    IterateElements
+      (*fes, VOL, clh, [&] (FESpace::Element el, LocalHeap & lh)
+       {
+         if (!els.Test(el.Nr()))
+           return;
+         auto & fel = dynamic_cast<const BaseScalarFiniteElement&> (el.GetFE());
+         const ElementTransformation & eltrans = el.GetTrafo();
+         int nd = fel.GetNDof();
+
+         IntegrationRule ir(fel.ElementType(), 2*fel.Order());
+         auto & mir = eltrans(ir, lh);
+         FlatMatrix<> vals(ir.Size(), dim, lh);
+         cf->Evaluate(mir, vals);
+
+         FlatVector<> shape(nd, lh);
+         FlatMatrix<> massmat(nd, lh);
+         FlatMatrix<> elrhs(nd, dim, lh);
+         FlatMatrix<> elcoefs(nd, dim, lh);
+         massmat = 0.0;
+         elrhs = 0.0;
+         for (size_t i = 0; i < ir.Size(); ++i)
+         {
+           fel.CalcShape(ir[i], shape);
+           double w = mir[i].GetWeight();
+           massmat += w * shape * Trans(shape);
+           for (int j = 0; j < nd; ++j)
+             for (int d = 0; d < dim; ++d)
+               elrhs(j,d) += w * shape(j) * vals(i,d);
+         }
+         CalcInverse(massmat);
+         elcoefs = massmat * elrhs;
+
+         auto dofs = el.GetDofs();
+         for (int j = 0; j < nd; ++j)
+         {
+           if (!IsRegularDof(dofs[j])) continue;
+           for (int d = 0; d < dim; ++d)
+             if (cnt[dofs[j]] == 0)
+               vec(dim*dofs[j]+d) = elcoefs(j,d);
+             else
+               vec(dim*dofs[j]+d) += elcoefs(j,d);
+           cnt[dofs[j]]++;
+         }
+       });
+
+    ParallelFor (cnt.Size(), [&] (size_t i)
     {
-      SharedLoop sl (Range (factor->Size()));
-      task_manager->CreateJob
-        ( [&] (const TaskInfo & ti) {
-          LocalHeap lh = clh.Split();
-          
-          // averaging of the (summed) deformation
-          Array<int> dnums(1);
-
-          for (int i : sl)
-          {
-            HeapReset hr(lh);
-            FlatVector<> val_fac(D,lh);
-            FlatVector<> values(D,lh);
-            dnums[0] = i;
-            deform->GetVector().GetIndirect(dnums,values);
-            factor->GetIndirect(dnums,val_fac);
-            if (val_fac(0) > 0)
-              values *= 1.0/val_fac(0);
-            deform->GetVector().SetIndirect(dnums,values);
-          }
-        });
+      if (cnt[i] > 1)
+        vec.Range(dim*i, dim*(i+1)) *= 1.0/cnt[i];
+    });
+  }
+
+
+  // sets all dofs of the elements in els to zero
+  static void ZeroValuesOnElements (shared_ptr<GridFunction> gf, shared_ptr<BitArray> els,
+                                    LocalHeap & lh)
+  {
+    auto fes = gf->GetFESpace();
+    int dim = fes->GetDimension();
+    FlatVector<> vec = gf->GetVector().FVDouble();
+    shared_ptr<BitArray> dofs = GetDofsOfElements(fes, els, lh);
+    ParallelForRange (dofs->Size(), [&] (IntRange myrange)
+    {
+      for (auto d : myrange)
+        if (dofs->Test(d))
+          vec.Range(dim*d, dim*(d+1)) = 0.0;
+    });
+  }
+
+
+  void ProjectShift (shared_ptr<GridFunction> lset_ho, shared_ptr<GridFunction> lset_p1,
+                     shared_ptr<GridFunction> deform, shared_ptr<CoefficientFunction> qn,
+                     shared_ptr<BitArray> ba,
+                     shared_ptr<CoefficientFunction> blending,
+                     double lower_lset_bound, double upper_lset_bound, double threshold,
+                     LocalHeap & clh)
+  {
+    static Timer time_fct ("LsetCurv::ProjectShift");
+    RegionTimer reg (time_fct);
+
+    deform->GetVector() = 0.0;
+    shared_ptr<BitArray> band = ba;
+    if (!band)
+      band = GetElementsInRelevantBand(lset_p1, lower_lset_bound, upper_lset_bound);
+    ProjectShiftOnBand(lset_ho, lset_p1, deform, qn, *band, blending,
+                       lower_lset_bound, upper_lset_bound, threshold, clh);
+  }
+
+
+  shared_ptr<BitArray> GetElementsInRelevantBand (shared_ptr<GridFunction> lset_p1,
+                                                  double lower_lset_bound, double upper_lset_bound)
+  {
+    auto ma = lset_p1->GetMeshAccess();
+    auto fes_p1 = lset_p1->GetFESpace();
+    FlatVector<> vec_p1 = lset_p1->GetVector().FVDouble();
+    int ne = ma->GetNE(VOL);
+    auto band = make_shared<BitArray>(ne);
+    band->Clear();
+    ParallelFor (ne, [&] (size_t elnr)
+    {
+      ArrayMem<int,8> p1_dofs;
+      fes_p1->GetDofNrs(ElementId(VOL,elnr), p1_dofs);
+      VectorMem<8> vals(p1_dofs.Size());
+      for (auto k : Range(p1_dofs))
+        vals(k) = vec_p1(p1_dofs[k]);
+      if (ElementInRelevantBand(vals, lower_lset_bound, upper_lset_bound))
+        band->SetBitAtomic(elnr);
+    });
+    return band;
+  }
+
+
+  shared_ptr<BitArray> CalcDeformationInBand (shared_ptr<CoefficientFunction> levelset,
+                                              shared_ptr<GridFunction> lset_ho, shared_ptr<GridFunction> lset_p1,
+                                              shared_ptr<GridFunction> deform, shared_ptr<GridFunction> qn,
+                                              shared_ptr<BitArray> ba,
+                                              shared_ptr<CoefficientFunction> blending,
+                                              double lower_lset_bound, double upper_lset_bound, double threshold,
+                                              double eps_perturbation,
+                                              shared_ptr<BitArray> last_band,
+                                              LocalHeap & lh)
+  {
+    static Timer time_fct ("LsetCurv::CalcDeformationInBand");
+    RegionTimer reg (time_fct);
+    auto ma = lset_p1->GetMeshAccess();
+
+    // 1. P1 interpolation and the band of relevant elements
+    InterpolateP1 interpol(levelset, lset_p1);
+    interpol.Do(lh, eps_perturbation);
+    shared_ptr<BitArray> band = ba ? make_shared<BitArray>(*ba)
+      : GetElementsInRelevantBand(lset_p1, lower_lset_bound, upper_lset_bound);
+
+    // 2. remove the values of the last band (everything if there is none)
+    if (last_band && last_band->Size() == size_t(ma->GetNE(VOL)))
+    {
+      ZeroValuesOnElements(lset_ho, last_band, lh);
+      ZeroValuesOnElements(qn, last_band, lh);
+      ZeroValuesOnElements(deform, last_band, lh);
     }
     else
     {
-      Array<int> dnums(1);
-      for (int i : Range(factor->Size()) )
-      {
-        HeapReset hr(clh);
-        FlatVector<> val_fac(D,clh);
-        FlatVector<> values(D,clh);
-        dnums[0] = i;
-        deform->GetVector().GetIndirect(dnums,values);
-        factor->GetIndirect(dnums,val_fac);
-        if (val_fac(0) > 0)
-              values *= 1.0/val_fac(0);
-        deform->GetVector().SetIndirect(dnums,values);
-      }
+      lset_ho->GetVector() = 0.0;
+      qn->GetVector() = 0.0;
+      deform->GetVector() = 0.0;
     }
+
+    // 3. higher order level set, its gradient and the shift on the band
+    SetValuesOnElements(levelset, lset_ho, *band, lh);
+    auto grad_lset_ho = make_shared<GridFunctionCoefficientFunction>
+      (lset_ho, lset_ho->GetFESpace()->GetFluxEvaluator());
+    SetValuesOnElements(grad_lset_ho, qn, *band, lh);
+    ProjectShiftOnBand(lset_ho, lset_p1, deform, qn, *band, blending,
+                       lower_lset_bound, upper_lset_bound, threshold, lh);
+    return band;
   }
   
 }
-
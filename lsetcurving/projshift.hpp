@@ -17,4 +17,23 @@ namespace ngcomp
                      double lower_lset_bound, double upper_lset_bound, double threshold,
                      LocalHeap & lh);
 
+  // elements where the P1 level set has a value in [lower_lset_bound, upper_lset_bound]
+  shared_ptr<BitArray> GetElementsInRelevantBand (shared_ptr<GridFunction> lset_p1,
+                                                  double lower_lset_bound, double upper_lset_bound);
+
+  // Band-limited version of lset_ho.Set(levelset), qn.Set(grad(lset_ho)),
+  // InterpolateToP1 and ProjectShift: lset_p1 is interpolated from levelset
+  // first, then lset_ho, qn and deform are only computed on the band (or ba)
+  // and all their other values are zero. Only the dofs of last_band (the band
+  // of the last call) are reset. Returns the band.
+  shared_ptr<BitArray> CalcDeformationInBand (shared_ptr<CoefficientFunction> levelset,
+                                              shared_ptr<GridFunction> lset_ho, shared_ptr<GridFunction> lset_p1,
+                                              shared_ptr<GridFunction> deform, shared_ptr<GridFunction> qn,
+                                              shared_ptr<BitArray> ba,
+                                              shared_ptr<CoefficientFunction> blending,
+                                              double lower_lset_bound, double upper_lset_bound, double threshold,
+                                              double eps_perturbation,
+                                              shared_ptr<BitArray> last_band,
+                                              LocalHeap & lh);
+
 }
@@ -22,6 +22,14 @@ void ExportNgsx_lsetcurving(py::module &m)
 
 
 
+  auto ToList = [](const Array<double> & vals)
+  {
+    py::list ret (vals.Size());
+    for (int i = 0; i < vals.Size(); i++)
+      ret[i] = vals[i];
+    return ret;
+  };
+
   py::class_<StatisticContainer, shared_ptr<StatisticContainer>>(m, "StatisticContainer")
     .def(py::init<>())
     .def("Print", [](StatisticContainer & self, string label, string select)
@@ -44,6 +52,14 @@ void ExportNgsx_lsetcurving(py::module &m)
          },
          py::arg("label")="something",py::arg("select")="all"
       )
+    .def_property_readonly("ErrorL2Norm", [ToList](StatisticContainer & self)
+                           { return ToList(self.ErrorL2Norm); })
+    .def_property_readonly("ErrorL1Norm", [ToList](StatisticContainer & self)
+                           { return ToList(self.ErrorL1Norm); })
+    .def_property_readonly("ErrorMaxNorm", [ToList](StatisticContainer & self)
+                           { return ToList(self.ErrorMaxNorm); })
+    .def_property_readonly("ErrorMisc", [ToList](StatisticContainer & self)
+                           { return ToList(self.ErrorMisc); })
     ;
 
   m.def("CalcMaxDistance",  [] (PyCF lset_ho, PyGF lset_p1, PyGF deform, int heapsize)
@@ -111,16 +127,30 @@ This is an internal function (and should be removed after some refactoring at so
     )
     ;
 
-  // m.def("CalcDeformationError",  [] (PyCF lset_ho, PyGF lset_p1, PyGF deform, PyCF qn, StatisticContainer & stats, double lower, double upper, int heapsize)
-  //       {
-  //         LocalHeap lh (heapsize, "CalcDeformationError-Heap");
-  //         if (lset_p1->GetMeshAccess()->GetDimension()==2)
-  //           CalcDeformationError<2>(lset_ho, lset_p1, deform, qn, stats, lh, lower, upper);
-  //         else
-  //           CalcDeformationError<3>(lset_ho, lset_p1, deform, qn, stats, lh, lower, upper);
-  //       } ,
-  //       py::arg("lset_ho")=NULL,py::arg("lset_p1")=NULL,py::arg("deform")=NULL,py::arg("qn")=NULL,py::arg("stats")=NULL,py::arg("lower")=0.0,py::arg("upper")=0.0,py::arg("heapsize")=1000000)
-  //   ;
+  m.def("CalcDeformationError",  [] (PyCF lset_ho, PyGF lset_p1, PyGF deform, PyCF qn, StatisticContainer & stats, double lower, double upper, bool batched, int heapsize)
+        {
+          LocalHeap lh (heapsize, "CalcDeformationError-Heap");
+          double n_totalits = 0.0;
+          double n_maxits = 0.0;
+          if (lset_p1->GetMeshAccess()->GetDimension()==2)
+            CalcDeformationError<2>(lset_ho, lset_p1, deform, qn, stats, lh, lower, upper, batched, &n_totalits, &n_maxits);
+          else
+            CalcDeformationError<3>(lset_ho, lset_p1, deform, qn, stats, lh, lower, upper, batched, &n_totalits, &n_maxits);
+          return py::make_tuple(n_totalits, n_maxits);
+        } ,
+        py::arg("lset_ho")=NULL,py::arg("lset_p1")=NULL,py::arg("deform")=NULL,py::arg("qn")=NULL,py::arg("stats")=NULL,py::arg("lower")=0.0,py::arg("upper")=0.0,py::arg("batched")=true,py::arg("heapsize")=1000000,
+        docu_string(R"raw_string(
+Compares the deformation with the ideal one (obtained from a point search on lset_ho) in the
+integration points of the elements in the band (lower,upper) and appends the L2 and the maximum
+norm of the difference (ErrorL2Norm, ErrorMaxNorm) and the L2 norm of the jump of the ideal
+deformation over the facets (ErrorMisc) to stats.
+
+The point searches of all integration points of an element are done at once (batched=True) or
+one after the other (batched=False). Returns the total and the maximum number of iterations of
+the point searches in the elements.
+)raw_string")
+    )
+    ;
 
   m.def("ProjectShift",  [] (PyGF lset_ho, PyGF lset_p1, PyGF deform, PyCF qn,
                              py::object active_elems_in,
@@ -212,13 +242,75 @@ heapsize : int
 )raw_string")
     ;
 
+  m.def("CalcDeformationInBand",  [] (PyCF levelset, PyGF lset_ho, PyGF lset_p1, PyGF deform, PyGF qn,
+                                      py::object active_elems_in,
+                                      PyCF blending,
+                                      double lower, double upper, double threshold,
+                                      double eps_perturbation,
+                                      py::object last_band_in,
+                                      int heapsize)
+        {
+          shared_ptr<BitArray> active_elems = nullptr;
+          if (py::extract<PyBA> (active_elems_in).check())
+            active_elems = py::extract<PyBA>(active_elems_in)();
+          shared_ptr<BitArray> last_band = nullptr;
+          if (py::extract<PyBA> (last_band_in).check())
+            last_band = py::extract<PyBA>(last_band_in)();
+
+          LocalHeap lh (heapsize, "CalcDeformationInBand-Heap", true);
+          return CalcDeformationInBand(levelset, lset_ho, lset_p1, deform, qn, active_elems, blending,
+                                       lower, upper, threshold, eps_perturbation, last_band, lh);
+        } ,
+        py::arg("levelset"),
+        py::arg("lset_ho"),
+        py::arg("lset_p1"),
+        py::arg("deform"),
+        py::arg("qn"),
+        py::arg("active_elements")=DummyArgument(),
+        py::arg("blending")=NULL,
+        py::arg("lower")=0.0,
+        py::arg("upper")=0.0,
+        py::arg("threshold")=1.0,
+        py::arg("eps_perturbation")=1e-14,
+        py::arg("last_band")=DummyArgument(),
+        py::arg("heapsize")=1000000,
+        docu_string(R"raw_string(
+Band-limited pipeline of lset_ho.Set(levelset), qn.Set(grad(lset_ho)), InterpolateToP1 and
+ProjectShift: lset_p1 is the P1 interpolation of levelset, which determines the band of elements
+with a level set value in [lower,upper] (or active_elements if given). lset_ho (element-wise
+projection, averaged on the band), qn and deform are only computed on the band. All other values
+of lset_ho, qn and deform are zero; only the dofs of last_band (the band of the last call) are
+reset, all dofs if last_band is None. Returns the band as a BitArray.
+
+Parameters
+
+levelset : ngsolve.CoefficientFunction
+  level set function
+
+lset_ho, lset_p1, deform, qn : ngsolve.GridFunction
+  higher order / P1 level set, deformation and normal direction field
+
+active_elements, blending, lower, upper, threshold :
+  see ProjectShift
+
+eps_perturbation : float
+  epsilon perturbation that is used to interpolate to P1
+
+last_band : ngsolve.BitArray / None
+  band of the last call (on the same mesh)
+
+heapsize : int
+  heapsize of local computations.
+)raw_string")
+    );
+
 // ProjectShift
 
 
   m.def("RefineAtLevelSet",  [] (PyGF lset_p1, double lower, double upper, int heapsize)
         {
           LocalHeap lh (heapsize, "RefineAtLevelSet-Heap");
-          RefineAtLevelSet(lset_p1, lower, upper, lh);
+          return RefineAtLevelSet(lset_p1, lower, upper, lh);
         } ,
         py::arg("gf")=NULL,py::arg("lower")=0.0,py::arg("upper")=0.0,py::arg("heapsize")=1000000,
         docu_string(R"raw_string(
@@ -238,6 +330,11 @@ upper : float
 
 heapsize : int
   heapsize of local computations.
+
+Returns
+
+ngsolve.BitArray
+  the marked elements (can be reused e.g. as band for ProjectShift)
 )raw_string"));
 
   m.def("shifted_eval", [](PyGF self,
@@ -8,102 +8,116 @@ namespace ngfem
 
   const int NEWTON_ITER_TRESHOLD = 100;
 
-  template <int D, int SpaceD>
-  void DiffOpShiftedEval<D, SpaceD> ::
-  CalcMatrix (const FiniteElement & bfel,
-              const BaseMappedIntegrationPoint & bmip,
-              SliceMatrix<double,ColMajor> mat,
-              LocalHeap & lh) const
+  // Reference coordinates of the shifted points of the points mip(i), i < npts,
+  // of one element, i.e. the solutions x of Theta(Phi(x)) = z with
+  // z = mip(i) + forth(mip(i)). The deformations are gathered once per element
+  // and the fixed point iterations run on all points that have not converged.
+  template <int SpaceD, typename TMIP>
+  static void CalcShiftedPoints (shared_ptr<GridFunction> back,
+                                 shared_ptr<GridFunction> forth,
+                                 const ElementTransformation & trafo,
+                                 int npts, TMIP mip,
+                                 FlatMatrixFixWidth<SpaceD> ref_points,
+                                 LocalHeap & lh)
   {
-    const MappedIntegrationPoint<DIM_ELEMENT,DIM_SPACE> & mip =
-      static_cast<const MappedIntegrationPoint<DIM_ELEMENT,DIM_SPACE>&> (bmip);
-
-    const ScalarFiniteElement<SpaceD> & scafe =
-            dynamic_cast<const ScalarFiniteElement<SpaceD> & > (bfel);
-    const int ndof = scafe.GetNDof();
-
-    FlatVector<> shape (ndof,lh);
-
-    IntegrationPoint ip(mip.IP());
-    auto elid = mip.GetTransformation().GetElementId();
-    Array<int> dnums;
+    HeapReset hr(lh);
+    auto elid = trafo.GetElementId();
 
-    Vec<SpaceD> z = mip.GetPoint();
+    FlatMatrixFixWidth<SpaceD> z(npts, lh);
+    for (int i = 0; i < npts; ++i)
+    {
+      z.Row(i) = mip(i).GetPoint();
+      for (int d = 0; d < SpaceD; ++d)
+        ref_points(i,d) = mip(i).IP()(d);
+    }
 
     if (forth)
     {
+      Array<int> dnums;
       forth->GetFESpace()->GetDofNrs(elid,dnums);
-      FlatVector<> values_forth(dnums.Size()*DIM_SPACE,lh);
+      FlatVector<> values_forth(dnums.Size()*SpaceD,lh);
       FlatMatrixFixWidth<SpaceD> vector_forth(dnums.Size(),&(values_forth(0)));
       forth->GetVector().GetIndirect(dnums,values_forth);
 
       FiniteElement& fe_forth = forth->GetFESpace()->GetFE(elid,lh);
       const ScalarFiniteElement<SpaceD> & scafe_forth =
         dynamic_cast<const ScalarFiniteElement<SpaceD> & > (fe_forth);
-      FlatVector<> shape_forth(dnums.Size(),lh);
-      scafe_forth.CalcShape(ip,shape_forth);
-      Vec<SpaceD> dvec_forth = Trans(vector_forth)*shape_forth;
-      z += dvec_forth;
+      IntegrationRule ir(npts, lh);
+      for (int i = 0; i < npts; ++i)
+        ir[i] = mip(i).IP();
+      FlatMatrix<> shapes_forth(dnums.Size(), npts, lh);
+      scafe_forth.CalcShape(ir, shapes_forth);
+      for (int i = 0; i < npts; ++i)
+        z.Row(i) += Trans(vector_forth)*shapes_forth.Col(i);
     }
-      
+
+    IntegrationPoint ipx0(0,0,0);
+    MappedIntegrationPoint<SpaceD,SpaceD> mip_x0(ipx0,trafo);
+    FlatMatrixFixWidth<SpaceD> zdiff(npts, lh);
+    for (int i = 0; i < npts; ++i)
+      zdiff.Row(i) = z.Row(i) - mip_x0.GetPoint();
 
     // Solve the problem Theta(Phi(x)) = z
 
     if (back)
     {
-      
+      Array<int> dnums;
       back->GetFESpace()->GetDofNrs(elid,dnums);
-      FlatVector<> values_back(dnums.Size()*DIM_SPACE,lh);
+      FlatVector<> values_back(dnums.Size()*SpaceD,lh);
       FlatMatrixFixWidth<SpaceD> vector_back(dnums.Size(),&(values_back(0)));
       back->GetVector().GetIndirect(dnums,values_back);
     
       FiniteElement& fe_back = back->GetFESpace()->GetFE(elid,lh);
       const ScalarFiniteElement<SpaceD> & scafe_back =
         dynamic_cast<const ScalarFiniteElement<SpaceD> & > (fe_back);
-      FlatVector<> shape_back(dnums.Size(),lh);
-      scafe_back.CalcShape(ip,shape_back);
-      Vec<SpaceD> dvec_back = Trans(vector_back)*shape_back;
-    
 
-      int its = 0;
-      const double h = sqrt(mip.GetJacobiDet());
-      Vec<SpaceD> diff;
-      IntegrationPoint ipx(ip);
+      FlatArray<int> active(npts, lh);
+      for (int i = 0; i < npts; ++i)
+        active[i] = i;
+      int nactive = npts;
 
-      IntegrationPoint ipx0(0,0,0);
-      MappedIntegrationPoint<SpaceD,SpaceD> mip_x0(ipx0,mip.GetTransformation());
-      Vec<SpaceD> zdiff = z-mip_x0.GetPoint();
-    
-      // static atomic<int> cnt_its(0);
-      // static atomic<int> cnt_calls(0);
-      
-      // Fixed point iteration
-      while (its < NEWTON_ITER_TRESHOLD)
+      // Fixed point iteration (on all active points)
+      int its = 0;
+      while (nactive > 0)
       {
-        scafe_back.CalcShape(ipx,shape_back);
-        dvec_back = Trans(vector_back)*shape_back;
-        diff = zdiff - dvec_back - mip.GetJacobian() * ipx.Point();
-        // cout << "diff = " << diff << endl;
-        // cout << "its = " << its << endl;
-        if ( L2Norm(diff) < 1e-8*h ) break;
-        ipx.Point() = mip.GetJacobianInverse() * (zdiff - dvec_back);
-
+        if (its == NEWTON_ITER_TRESHOLD)
+          throw Exception(" shifted eval took NEWTON_ITER_TRESHOLD iterations and didn't (yet?) converge! ");
+
+        HeapReset hr_it(lh);
+        IntegrationRule irx(nactive, lh);
+        for (int k = 0; k < nactive; ++k)
+        {
+          // copy of the original point (keeps weight (time) and flags)
+          IntegrationPoint ipx(mip(active[k]).IP());
+          for (int d = 0; d < SpaceD; ++d)
+            ipx(d) = ref_points(active[k],d);
+          irx[k] = ipx;
+        }
+        FlatMatrix<> shapes_back(dnums.Size(), nactive, lh);
+        scafe_back.CalcShape(irx, shapes_back);
+
+        int still_active = 0;
+        for (int k = 0; k < nactive; ++k)
+        {
+          const int i = active[k];
+          const double h = sqrt(mip(i).GetJacobiDet());
+          Vec<SpaceD> dvec_back = Trans(vector_back)*shapes_back.Col(k);
+          Vec<SpaceD> x = ref_points.Row(i);
+          Vec<SpaceD> diff = zdiff.Row(i) - dvec_back - mip(i).GetJacobian() * x;
+          if ( L2Norm(diff) < 1e-8*h ) continue;
+          ref_points.Row(i) = mip(i).GetJacobianInverse() * (zdiff.Row(i) - dvec_back);
+          active[still_active++] = i;
+        }
+        nactive = still_active;
         its++;
-        // cnt_its++;
-      
       }
-      if (its == NEWTON_ITER_TRESHOLD)
-        throw Exception(" shifted eval took NEWTON_ITER_TRESHOLD iterations and didn't (yet?) converge! ");
-    
-      // cnt_calls++;
-      // cout << "cnt/calls = " << cnt_its/cnt_calls << endl;
 
       /* 
          FlatMatrixFixWidth<2> dshape_back(dnums.Size(),lh);
          FlatVector<> shape_back_new(dnums.Size(),lh);
 
          // not so robust Newton-type version (not working so well):
-    
+  
          while (its==0 || (L2Norm(diff) > 1e-8*h && its < 20000))
          {
          MappedIntegrationPoint<2,2> mip_x0(ipx,mip.GetTransformation());
@@ -176,39 +190,108 @@ namespace ngfem
 
          }
       */
-
-      scafe.CalcShape(ipx,shape);
-      mat = 0.0;
-      mat.Row(0) = shape;
     }
     else
     {
-      int its = 0;
-      const double h = sqrt(mip.GetJacobiDet());
-      Vec<SpaceD> diff;
-      IntegrationPoint ipx(ip);
-      IntegrationPoint ipx0(0,0,0);
-      MappedIntegrationPoint<SpaceD,SpaceD> mip_x0(ipx0,mip.GetTransformation());
-      Vec<SpaceD> zdiff = z-mip_x0.GetPoint();
-    
-      // Fixed point iteration
-      while (its < NEWTON_ITER_TRESHOLD)
+      for (int i = 0; i < npts; ++i)
       {
-        diff = zdiff - mip.GetJacobian() * ipx.Point();
-        if ( L2Norm(diff) < 1e-8*h ) break;
-        ipx.Point() = mip.GetJacobianInverse() * zdiff;
-        its++;
+        int its = 0;
+        const double h = sqrt(mip(i).GetJacobiDet());
+        Vec<SpaceD> zd = zdiff.Row(i);
+        // Fixed point iteration
+        while (its < NEWTON_ITER_TRESHOLD)
+        {
+          Vec<SpaceD> x = ref_points.Row(i);
+          Vec<SpaceD> diff = zd - mip(i).GetJacobian() * x;
+          if ( L2Norm(diff) < 1e-8*h ) break;
+          ref_points.Row(i) = mip(i).GetJacobianInverse() * zd;
+          its++;
+        }
+        if (its == NEWTON_ITER_TRESHOLD)
+          throw Exception(" shifted eval took NEWTON_ITER_TRESHOLD iterations and didn't (yet?) converge! ");
       }
-      if (its == NEWTON_ITER_TRESHOLD)
-        throw Exception(" shifted eval took NEWTON_ITER_TRESHOLD iterations and didn't (yet?) converge! ");
-
-      scafe.CalcShape(ipx,shape);
-      mat = 0.0;
-      for (int j = 0; j < D; j++)
-        for (int k = 0; k < shape.Size(); k++)
-          mat(j,k*D+j) = shape(k);
     }
-    
+  }
+
+
+  // matrices of all points (Dim() rows per point) from the shapes at the shifted points
+  template <int D, int SpaceD>
+  static void FillShiftedMatrices (bool has_back, FlatMatrix<> shapes,
+                                   SliceMatrix<double,ColMajor> mat)
+  {
+    const int ndof = shapes.Height();
+    mat = 0.0;
+    for (int i = 0; i < shapes.Width(); ++i)
+    {
+      if (has_back)
+        mat.Row(i*D) = shapes.Col(i);
+      else
+        for (int j = 0; j < D; j++)
+          for (int k = 0; k < ndof; k++)
+            mat(i*D+j,k*D+j) = shapes(k,i);
+    }
+  }
+
+
+  template <int D, int SpaceD>
+  void DiffOpShiftedEval<D, SpaceD> ::
+  CalcMatrix (const FiniteElement & bfel,
+              const BaseMappedIntegrationPoint & bmip,
+              SliceMatrix<double,ColMajor> mat,
+              LocalHeap & lh) const
+  {
+    HeapReset hr(lh);
+    const MappedIntegrationPoint<DIM_ELEMENT,DIM_SPACE> & mip =
+      static_cast<const MappedIntegrationPoint<DIM_ELEMENT,DIM_SPACE>&> (bmip);
+
+    const ScalarFiniteElement<SpaceD> & scafe =
+            dynamic_cast<const ScalarFiniteElement<SpaceD> & > (bfel);
+
+    FlatMatrixFixWidth<SpaceD> ref_points(1, lh);
+    CalcShiftedPoints<SpaceD> (back, forth, mip.GetTransformation(), 1,
+                               [&] (int i) -> const MappedIntegrationPoint<SpaceD,SpaceD> & { return mip; },
+                               ref_points, lh);
+
+    IntegrationRule irx(1, lh);
+    irx[0] = mip.IP();
+    for (int d = 0; d < SpaceD; ++d)
+      irx[0](d) = ref_points(0,d);
+    FlatMatrix<> shapes(scafe.GetNDof(), 1, lh);
+    scafe.CalcShape(irx, shapes);
+    FillShiftedMatrices<D,SpaceD> (back != nullptr, shapes, mat);
+  }
+
+
+  template <int D, int SpaceD>
+  void DiffOpShiftedEval<D, SpaceD> ::
+  CalcMatrix (const FiniteElement & bfel,
+              const BaseMappedIntegrationRule & bmir,
+              SliceMatrix<double,ColMajor> mat,
+              LocalHeap & lh) const
+  {
+    HeapReset hr(lh);
+    const MappedIntegrationRule<DIM_ELEMENT,DIM_SPACE> & mir =
+      static_cast<const MappedIntegrationRule<DIM_ELEMENT,DIM_SPACE>&> (bmir);
+
+    const ScalarFiniteElement<SpaceD> & scafe =
+            dynamic_cast<const ScalarFiniteElement<SpaceD> & > (bfel);
+    const int npts = mir.Size();
+
+    FlatMatrixFixWidth<SpaceD> ref_points(npts, lh);
+    CalcShiftedPoints<SpaceD> (back, forth, mir.GetTransformation(), npts,
+                               [&] (int i) -> const MappedIntegrationPoint<SpaceD,SpaceD> & { return mir[i]; },
+                               ref_points, lh);
+
+    IntegrationRule irx(npts, lh);
+    for (int i = 0; i < npts; ++i)
+    {
+      irx[i] = mir[i].IP();
+      for (int d = 0; d < SpaceD; ++d)
+        irx[i](d) = ref_points(i,d);
+    }
+    FlatMatrix<> shapes(scafe.GetNDof(), npts, lh);
+    scafe.CalcShape(irx, shapes);
+    FillShiftedMatrices<D,SpaceD> (back != nullptr, shapes, mat);
   }
 
 
@@ -226,6 +309,24 @@ namespace ngfem
     flux = mat * x;
   }
   
+  template <int D, int SpaceD>
+  void DiffOpShiftedEval<D, SpaceD> ::
+  Apply (const FiniteElement & fel,
+         const BaseMappedIntegrationRule & mir,
+         BareSliceVector<double> x, 
+         BareSliceMatrix<double> flux,
+         LocalHeap & lh) const
+  {
+    HeapReset hr(lh);
+    const int ndof = D*fel.GetNDof();
+    FlatMatrix<double,ColMajor> mat(Dim()*mir.Size(), ndof, lh);
+    CalcMatrix (fel, mir, mat, lh);
+    FlatVector<> fx(ndof, lh);
+    fx = x.Range(0,ndof);
+    for (size_t i = 0; i < mir.Size(); ++i)
+      flux.Row(i).Range(0,Dim()) = mat.Rows(i*Dim(),(i+1)*Dim()) * fx;
+  }
+
   template <int D, int SpaceD>
   void DiffOpShiftedEval<D, SpaceD> ::
   ApplyTrans (const FiniteElement & fel,
@@ -240,6 +341,25 @@ namespace ngfem
     x = Trans(mat) * flux;
   }
 
+  template <int D, int SpaceD>
+  void DiffOpShiftedEval<D, SpaceD> ::
+  ApplyTrans (const FiniteElement & fel,
+              const BaseMappedIntegrationRule & mir,
+              FlatMatrix<double> flux,
+              BareSliceVector<double> x, 
+              LocalHeap & lh) const
+  {
+    HeapReset hr(lh);
+    const int ndof = D*fel.GetNDof();
+    FlatMatrix<double,ColMajor> mat(Dim()*mir.Size(), ndof, lh);
+    CalcMatrix (fel, mir, mat, lh);
+    FlatVector<> fx(ndof, lh);
+    fx = 0.0;
+    for (size_t i = 0; i < mir.Size(); ++i)
+      fx += Trans(mat.Rows(i*Dim(),(i+1)*Dim())) * flux.Row(i);
+    x.Range(0,ndof) = fx;
+  }
+
   template class DiffOpShiftedEval<1, 1>;
   template class DiffOpShiftedEval<2, 1>;
   template class DiffOpShiftedEval<3, 1>;
@@ -51,6 +51,13 @@ namespace ngfem
         LocalHeap & lh) const;
 
 
+    // all points of a rule at once (deformations gathered once per element)
+    virtual void
+    CalcMatrix (const FiniteElement & bfel,
+        const BaseMappedIntegrationRule & mir,
+        SliceMatrix<double,ColMajor> mat,
+        LocalHeap & lh) const;
+
     virtual void
     Apply (const FiniteElement & fel,
            const BaseMappedIntegrationPoint & mip,
@@ -58,6 +65,13 @@ namespace ngfem
            FlatVector<double> flux,
            LocalHeap & lh) const;
     
+    virtual void
+    Apply (const FiniteElement & fel,
+           const BaseMappedIntegrationRule & mir,
+           BareSliceVector<double> x, 
+           BareSliceMatrix<double> flux,
+           LocalHeap & lh) const;
+    
     virtual void
     ApplyTrans (const FiniteElement & fel,
         const BaseMappedIntegrationPoint & mip,
@@ -65,6 +79,13 @@ namespace ngfem
         FlatVector<double> x,
         LocalHeap & lh) const;
 
+    virtual void
+    ApplyTrans (const FiniteElement & fel,
+        const BaseMappedIntegrationRule & mir,
+        FlatMatrix<double> flux,
+        BareSliceVector<double> x, 
+        LocalHeap & lh) const;
+
   };
 
 
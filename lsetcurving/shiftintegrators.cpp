@@ -40,7 +40,7 @@ namespace ngfem
                                                 const ElementTransformation & eltrans,
                                                 FlatVector<double> elvec,
                                                 LocalHeap & lh,
-                                                shared_ptr<LsetEvaluator<D>> lseteval) const
+                                                const LsetEvaluator<D> * lseteval) const
   {
     static Timer time_fct ("ShiftIntegrator<D>::CalcElementVector");
     RegionTimer reg (time_fct);
@@ -48,8 +48,9 @@ namespace ngfem
     elvec = 0.0;
     const ScalarFiniteElement<D> & scafe = dynamic_cast<const ScalarFiniteElement<D> &>(fel);
 
+    LsetEvaluator<D> coef_lseteval(coef_lset_ho, eltrans);
     if (!lseteval)
-      lseteval = make_shared<LsetEvaluator<D>>(coef_lset_ho, eltrans);
+      lseteval = &coef_lseteval;
     
     FlatMatrixFixWidth<D> elvecmat(scafe.GetNDof(),&elvec(0));
     elvecmat = 0.0;
@@ -65,23 +66,33 @@ namespace ngfem
     }
     
     IntegrationRule ir = SelectIntegrationRule (eltrans.GetElementType(), 2*scafe.Order());
-    for (int l = 0 ; l < ir.GetNIP(); l++)
+    const int nip = ir.GetNIP();
+
+    // setup of the point searches of all integration points
+    FlatArray<Mat<D>> trafo_of_normals(nip, lh);
+    FlatMatrixFixWidth<D> normals(nip, lh);
+    FlatMatrixFixWidth<D> orig_points(nip, lh);
+    FlatMatrixFixWidth<D> final_points(nip, lh);
+    FlatVector<> goal_vals(nip, lh);
+    FlatVector<> lsethovals(nip, lh);
+    if (coef_blending)
+      lseteval->Evaluate(ir, lsethovals, lh);
+
+    for (int l = 0 ; l < nip; l++)
     {
       MappedIntegrationPoint<D,D> mip(ir[l], eltrans);
-      scafe.CalcShape(ir[l],shape);
 
-      Mat<D> trafo_of_normals = mip.GetJacobianInverse() * Trans(mip.GetJacobianInverse());
+      trafo_of_normals[l] = mip.GetJacobianInverse() * Trans(mip.GetJacobianInverse());
         
       if (qn)
         qn->Evaluate(mip,grad);
 
-      Vec<D> normal = mip.GetJacobianInverse() * grad;
+      normals.Row(l) = mip.GetJacobianInverse() * grad;
       // double len = L2Norm(normal);
       // normal /= len;
         
-      Vec<D> orig_point;
       for (int d = 0; d < D; ++d)
-        orig_point(d) = ir[l](d);
+        orig_points(l,d) = ir[l](d);
 
       const double lsetp1val = coef_lset_p1->Evaluate(mip);
                                                                                  
@@ -95,16 +106,22 @@ namespace ngfem
       if (alpha > 1)
         throw Exception("alpha should not be larger than 1");
       
-      double goal_val = (1.0-alpha) * lsetp1val + alpha * lseteval->Evaluate(mip.IP(),lh);
+      goal_vals(l) = (1.0-alpha) * lsetp1val;
+      if (alpha != 0.0)
+        goal_vals(l) += alpha * lsethovals(l);
+    }
 
-      // double goal_val = coef_lset_p1->Evaluate(mip);
-      
-      Vec<D> final_point;
-      SearchCorrespondingPoint<D>(*lseteval,
-                                  orig_point, goal_val, 
-                                  trafo_of_normals, normal, false,
-                                  final_point, lh);
-      Vec<D> ref_dist = (final_point - orig_point);
+    SearchCorrespondingPoints<D>(*lseteval,
+                                 orig_points, goal_vals,
+                                 trafo_of_normals, normals, false,
+                                 final_points, lh);
+
+    for (int l = 0 ; l < nip; l++)
+    {
+      MappedIntegrationPoint<D,D> mip(ir[l], eltrans);
+      scafe.CalcShape(ir[l],shape);
+
+      Vec<D> ref_dist = final_points.Row(l) - orig_points.Row(l);
       const double ref_dist_size = L2Norm(ref_dist);
       if ((max_deform >= 0.0) && (ref_dist_size > max_deform))
       {
@@ -30,7 +30,7 @@ namespace ngfem
                                     const ElementTransformation & eltrans,
                                     FlatVector<double> elvec,
                                     LocalHeap & lh,
-                                    shared_ptr<LsetEvaluator<D>> lseteval) const;
+                                    const LsetEvaluator<D> * lseteval) const;
     virtual void CalcElementVector (const FiniteElement & fel,
                                     const ElementTransformation & eltrans,
                                     FlatVector<double> elvec,
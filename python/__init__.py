@@ -165,6 +165,10 @@ Other Parameters :
   time_order : int
     order in time that is used in the space-time integration. time_order=-1 means that no space-time
     rule will be applied. This is only relevant for space-time discretizations.
+
+  simd_evaluate : boolean
+    (only for level set domains with skeleton=True) evaluate the form on SIMD integration rules
+    (with fallback to the scalar evaluation) or use the scalar evaluation only
 """
     if levelset_domain != None and type(levelset_domain)==dict:
         if not "force_intorder" in levelset_domain:
@@ -252,6 +256,10 @@ Other Parameters :
   time_order : int
     order in time that is used in the space-time integration. time_order=-1 means that no space-time
     rule will be applied. This is only relevant for space-time discretizations.
+
+  simd_evaluate : boolean
+    (only for level set domains without space-time rule) evaluate the form on SIMD integration
+    rules (with fallback to the scalar evaluation) or use the scalar evaluation only
 """
     if levelset_domain != None and type(levelset_domain)==dict:
         if not "force_intorder" in levelset_domain:
@@ -278,7 +286,7 @@ Other Parameters :
         else:
             return SymbolicLFI_old(levelset_domain,*args,**kwargs)
 
-def Integrate_X_special_args(levelset_domain={}, cf=None, mesh=None, VOL_or_BND=VOL, order=5, time_order=-1, region_wise=False, element_wise = False, heapsize=1000000):
+def Integrate_X_special_args(levelset_domain={}, cf=None, mesh=None, VOL_or_BND=VOL, order=5, time_order=-1, region_wise=False, element_wise = False, definedonelements=None, heapsize=1000000):
     """
 Integrate_X_special_args should not be called directly.
 See documentation of Integrate.
@@ -304,6 +312,7 @@ See documentation of Integrate.
                       subdivlvl=levelset_domain["subdivlvl"],
                       time_order=time_order,
                       quad_dir_policy=levelset_domain["quad_dir_policy"],
+                      definedonelements=definedonelements,
                       heapsize=heapsize)
 
 
@@ -361,6 +370,9 @@ region_wise : bool
 element_wise : bool
   (only active for non-levelset version)
 
+definedonelements : ngsolve.BitArray
+  (only active for levelset version) restricts the integration to the marked elements
+
 heapsize : int
   heapsize for local computations.
     """
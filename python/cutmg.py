@@ -64,11 +64,17 @@ class CutFemSmoother:
         self.ifsolver = kwargs["ifsolver"]
         ifdofs = GetDofsOfElements(CutVh, ci.GetElementsOfType(IF)) & CutVh.FreeDofs()
         #self.proj = Projector(mask=self.ifdofs,range=True)
-        ifdofslst = [ [i] for i in range(len(ifdofs)) if ifdofs[i]==True ]
         if self.ifsolver == "direct":
-            self.ifpre = self.a.mat.Inverse(ifdofs, inverse="sparsecholesky")
+            # an InterfaceCorrection of a previous setup (e.g. time step) can be
+            # passed to reuse its factorization pattern
+            self.ifcorr = kwargs.get("ifcorrection",None)
+            if self.ifcorr == None:
+                self.ifcorr = InterfaceCorrection(self.a.mat, ifdofs)
+            else:
+                self.ifcorr.Update(self.a.mat, ifdofs)
         elif self.ifsolver == "cg":
             print("cg if solver")
+            ifdofslst = [ [i] for i in range(len(ifdofs)) if ifdofs[i]==True ]
             self.ifpre = self.a.mat.CreateBlockSmoother(ifdofslst)
         else:
             pass
@@ -85,6 +91,9 @@ class CutFemSmoother:
             return
         if self.ifcorr_only_once and k < nu-1:
             return
+        if self.ifsolver == "direct":
+            self.ifcorr.Apply(u, rhs)
+            return
         update = u.CreateVector()
         # this needs to be more efficient 
         # with help of ifdofs ...
@@ -120,6 +129,14 @@ class LinearMGIterator(BaseMatrix):
         #AssembleProblem = kwargs['assemblefct'] #not used
         ProlType = kwargs.get('ProlType',P1Prolongation)
         self.nu = kwargs.get('nu',2)
+        # use the C++ multigrid cycle (CutMultiGrid) instead of MultiGridCL
+        self.native = kwargs.get('native',False)
+        # coarse level matrices as Galerkin products P^T A P of the finest matrix,
+        # the bilinear form only needs to be assembled on the finest level
+        # (Update(None, ...) on all other levels), only with native=True
+        self.galerkin = kwargs.get('galerkin',False)
+        if self.galerkin and not self.native:
+            raise ValueError("LinearMGIterator: galerkin=True requires native=True")
         mesh = kwargs['mesh']
         
         self.tol=kwargs.get("tol",1e-6)
@@ -154,14 +171,42 @@ class LinearMGIterator(BaseMatrix):
         self.mats = [a.mat]
         #list of smoothers
         self.smoothers = [None]
+        self.freedofs = [self.CutVh.FreeDofs()]
+        # interface corrections per level (native only), the ones of a previous
+        # setup (e.g. time step) can be passed to reuse their factorization pattern
+        self.ifcorrs = [None]
+        self.old_ifcorrs = kwargs.get("ifcorrections",[])
+        # interface dofs per level (galerkin only)
+        self.ifdofs = [None]
         #coarse grid solver
         self.coarseinv = a.mat.Inverse(self.CutVh.FreeDofs(), inverse="sparsecholesky")
         self.MGpre = self.coarseinv
     
     def Update(self, a, CutVh, ci):
         self.CutProl.Update(CutVh)
-        self.mats.append(a.mat)
         self.CutVh = CutVh
+        if self.galerkin:
+            self.GalerkinUpdate(a, CutVh, ci)
+            return
+        self.mats.append(a.mat)
+        if self.native:
+            self.freedofs.append(CutVh.FreeDofs())
+            level = len(self.mats)-1
+            if self.ifsolver == None:
+                self.ifcorrs.append(None)
+            else:
+                ifdofs = GetDofsOfElements(CutVh, ci.GetElementsOfType(IF)) & CutVh.FreeDofs()
+                if level < len(self.old_ifcorrs) and self.old_ifcorrs[level] != None:
+                    self.old_ifcorrs[level].Update(a.mat, ifdofs)
+                    self.ifcorrs.append(self.old_ifcorrs[level])
+                else:
+                    self.ifcorrs.append(InterfaceCorrection(a.mat, ifdofs))
+            # only the new level is set up, the others are reused
+            self.MGpre = CutMultiGrid(matrices=self.mats, prol=self.CutProl,
+                                      freedofs=self.freedofs, ifdofs=self.ifcorrs,
+                                      coarsegridsolver=self.coarseinv, nu=self.nu,
+                                      ifcorr_only_once=True)
+            return
         current_smoother = CutFemSmoother(a=a, CutVh=CutVh, ci=ci, ifsolver=self.ifsolver,
                                                  ifcorr_only_once = True)
         self.smoothers.append(current_smoother)
@@ -171,6 +216,33 @@ class LinearMGIterator(BaseMatrix):
                                    nu=self.nu,
                                    coarsegridsolver=self.coarseinv)        
         
+    def GalerkinUpdate(self, a, CutVh, ci):
+        self.freedofs.append(CutVh.FreeDofs())
+        if self.ifsolver == None:
+            self.ifdofs.append(None)
+        else:
+            self.ifdofs.append(GetDofsOfElements(CutVh, ci.GetElementsOfType(IF)) & CutVh.FreeDofs())
+        level = len(self.freedofs)-1
+        if a == None:
+            # no fine matrix yet: keep the placeholders (and the last preconditioner)
+            self.mats.append(None)
+            self.ifcorrs.append(None)
+            return
+        # one fine assembly plus sparse products for all coarser levels
+        self.mats = GalerkinCoarseMatrices(self.CutProl, a.mat, level)
+        self.coarseinv = self.mats[0].Inverse(self.freedofs[0], inverse="sparsecholesky")
+        for l in range(1,level+1):
+            if self.ifdofs[l] == None:
+                self.ifcorrs[l] = None
+            elif self.ifcorrs[l] != None:
+                self.ifcorrs[l].Update(self.mats[l], self.ifdofs[l])
+            else:
+                self.ifcorrs[l] = InterfaceCorrection(self.mats[l], self.ifdofs[l])
+        self.MGpre = CutMultiGrid(matrices=self.mats, prol=self.CutProl,
+                                  freedofs=self.freedofs, ifdofs=self.ifcorrs,
+                                  coarsegridsolver=self.coarseinv, nu=self.nu,
+                                  ifcorr_only_once=True)
+
     def createVec(self):
         return self.mats[-1].CreateColVector()
 
@@ -218,47 +290,26 @@ class LinearMGIterator(BaseMatrix):
     def Width(self):
         return self.mats[-1].height
 
+def GalerkinCoarseMatrices(prol, mat, level):
+    """
+    Computes the coarse level matrices P^T A P from the matrix mat on level
+    'level' and the prolongation matrices of prol (P1Prolongation,
+    P2Prolongation or P2CutProlongation, updated on all levels).
+    Returns the list of matrices from the coarsest to the finest level.
+    """
+    mats = [mat]
+    for l in range(level,0,-1):
+        mats.insert(0, GalerkinProjection(mats[0], prol.CreateMatrix(l)))
+    return mats
+
 def VertPatches(fes,mesh):
-    blocks = []
-    freedofs = fes.FreeDofs()
-    for v in mesh.vertices:
-        vdofs = set()
-        for el in mesh[v].elements:
-            #print( fes.GetDofNrs(el) )
-            #input('w')
-            vdofs |= set(d for d in fes.GetDofNrs(el) if (freedofs[abs(d)] and d >=0) )
-        #print(vdofs)
-        blocks.append (vdofs)
-    return blocks
+    return PatchBlocks(fes, "vert")
 
 def ElemPatches(fes):
-    blocks = []
-    freedofs = fes.FreeDofs()
-    for el in fes.Elements():
-        eldofs = set(d for d in fes.GetDofNrs(el) if (freedofs[abs(d)] and d >=0) )        
-        blocks.append (eldofs)
-    return blocks
+    return PatchBlocks(fes, "elem")
 
 def EdgePatches(fes,mesh):
-    blocks = []
-    freedofs = fes.FreeDofs()
-    for edge in mesh.edges:
-        edofs = fes.GetDofNrs(edge)
-
-        if( len(edofs) == 0 ): continue
-        
-        # print('found edge dof: ', edofs)
-        elcntr = 0
-        edofs = set()
-        for el in mesh[edge].elements:
-            elcntr += 1
-            # print('  with element ', elcntr, ' el: ', fes.GetDofNrs(el) )
-            # print('  with element ', elcntr, ' el: ', el.nr )
-            edofs |= set( d for d in fes.GetDofNrs(el) if(freedofs[abs(d)] and d>=0) )
-    
-        # input('next edge')
-        blocks.append (edofs)
-    return blocks
+    return PatchBlocks(fes, "edge")
 
 
 class P2TwoGridCL(BaseMatrix):
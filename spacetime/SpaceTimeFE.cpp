@@ -37,7 +37,7 @@ namespace ngfem
 
             Vector<> time_shape(tFE->GetNDof());
             IntegrationPoint z(override_time ? time : ip.Weight());
-            if(! ip.GetPrecomputedGeometry())
+            if(! override_time && ! ip.GetPrecomputedGeometry())
               throw Exception("SpaceTimeFE :: CalcShape called with a mere space IR");
             tFE->CalcShape(z,time_shape);
 
@@ -67,7 +67,7 @@ namespace ngfem
 
             Vector<> time_shape(tFE->GetNDof());
             IntegrationPoint z(override_time ? time : ip.Weight());
-            if(! ip.GetPrecomputedGeometry())
+            if(! override_time && ! ip.GetPrecomputedGeometry())
               throw Exception("SpaceTimeFE :: CalcDShape called with a mere space IR");
             tFE->CalcShape(z,time_shape);
 
@@ -96,7 +96,7 @@ namespace ngfem
 
            Matrix<double> time_dshape(tFE->GetNDof(),1);
            IntegrationPoint z(override_time ? time : ip.Weight());
-           if(! ip.GetPrecomputedGeometry())
+           if(! override_time && ! ip.GetPrecomputedGeometry())
              throw Exception("SpaceTimeFE :: CalcDtShape called with a mere space IR");
            tFE->CalcDShape(z,time_dshape);
 
@@ -201,7 +201,7 @@ SpaceTimeFESpace :: SpaceTimeFESpace (shared_ptr<MeshAccess> ama, shared_ptr<FES
 
   void SpaceTimeFESpace ::InterpolateToP1(shared_ptr<CoefficientFunction> st_CF, shared_ptr<CoefficientFunction> ctref, shared_ptr<GridFunction> st_GF)
   {
-    LocalHeapMem<100000> lh("SpacetimeInterpolateToP1");
+    LocalHeap lh(1000000, "SpacetimeInterpolateToP1", true);
     auto node_gf = make_shared < S_GridFunction < double > >( Vh_ptr);
     node_gf->Update();
     auto gf_vec = st_GF->GetVectorPtr()->FV<double>();
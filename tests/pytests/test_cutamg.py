@@ -0,0 +1,68 @@
+import pytest
+from ngsolve import *
+from xfem import *
+from ngsolve.meshes import *
+
+ngsglobals.msg_level = 0
+
+@pytest.mark.parametrize("radius", [0.5, 0.5+1e-3, 0.5+1e-6, 0.61])
+
+def test_cutamg(radius):
+    mesh = MakeStructured2DMesh(quads = False, mapping = lambda x,y: (2*x-1,2*y-1), nx=32, ny=32)
+    levelset = sqrt(x*x+y*y) - radius
+    lsetp1 = GridFunction(H1(mesh,order=1))
+    InterpolateToP1(levelset,lsetp1)
+
+    Vh = H1(mesh, order=1, dirichlet=".*")
+    Vhx = XFESpace(Vh, lsetp1)
+    VhG = FESpace([Vh,Vhx])
+
+    alpha = [1.0,2.0]
+    n = 1.0/grad(lsetp1).Norm() * grad(lsetp1)
+    h = specialcf.mesh_size
+    kappa = [CutRatioGF(Vhx.GetCutInfo()),1.0-CutRatioGF(Vhx.GetCutInfo())]
+    stab = 10*(alpha[1]+alpha[0])/h
+
+    u_std, u_x = VhG.TrialFunction()
+    v_std, v_x = VhG.TestFunction()
+    u = [u_std + op(u_x) for op in [neg,pos]]
+    v = [v_std + op(v_x) for op in [neg,pos]]
+    gradu = [grad(u_std) + op(u_x) for op in [neg_grad,pos_grad]]
+    gradv = [grad(v_std) + op(v_x) for op in [neg_grad,pos_grad]]
+    average_flux_u = sum([- kappa[i] * alpha[i] * gradu[i] * n for i in [0,1]])
+    average_flux_v = sum([- kappa[i] * alpha[i] * gradv[i] * n for i in [0,1]])
+
+    lset_neg = { "levelset" : lsetp1, "domain_type" : NEG}
+    lset_pos = { "levelset" : lsetp1, "domain_type" : POS}
+    lset_if  = { "levelset" : lsetp1, "domain_type" : IF }
+
+    # non-symmetric storage for the Galerkin products
+    a = BilinearForm(VhG, symmetric = False)
+    a += SymbolicBFI(levelset_domain = lset_neg, form = alpha[0] * gradu[0] * gradv[0])
+    a += SymbolicBFI(levelset_domain = lset_pos, form = alpha[1] * gradu[1] * gradv[1])
+    a += SymbolicBFI(levelset_domain = lset_if , form = average_flux_u * (v[0]-v[1]))
+    a += SymbolicBFI(levelset_domain = lset_if , form = average_flux_v * (u[0]-u[1]))
+    a += SymbolicBFI(levelset_domain = lset_if , form = stab * (u[0]-u[1]) * (v[0]-v[1]))
+    a.Assemble()
+
+    f = LinearForm(VhG)
+    f += SymbolicLFI(levelset_domain = lset_neg, form = v[0])
+    f += SymbolicLFI(levelset_domain = lset_pos, form = v[1])
+    f.Assemble()
+
+    pre = CutAMG(a.mat, VhG, freedofs=VhG.FreeDofs(), coarsesize=50)
+    assert pre.nlevels > 2
+    assert pre.GetNDof(0) == VhG.ndof
+    for l in range(1,pre.nlevels):
+        assert pre.GetNDof(l) < pre.GetNDof(l-1)
+
+    gfu = GridFunction(VhG)
+    inv = CGSolver(a.mat, pre, printrates=False, precision=1e-8, maxsteps=200)
+    gfu.vec.data = inv * f.vec
+    print("radius", radius, "levels", pre.nlevels, "steps", inv.GetSteps())
+    assert inv.GetSteps() < 60
+
+    sol = gfu.vec.CreateVector()
+    sol.data = a.mat.Inverse(VhG.FreeDofs()) * f.vec
+    sol.data -= gfu.vec
+    assert Norm(sol) < 1e-5 * Norm(gfu.vec)
@@ -0,0 +1,513 @@
+import pytest
+from ngsolve import *
+from ngsolve.meshes import *
+from xfem import *
+from math import factorial
+
+def assert_same_for_flags(apply, flags=[False, True], tol=1e-10):
+    # apply(flag) returns a vector, the vectors for all flags have to agree
+    results = [apply(flag) for flag in flags]
+    assert Norm(results[0]) > 0
+    for w in results[1:]:
+        w.data -= results[0]
+        assert Norm(w) < tol * Norm(results[0])
+
+@pytest.mark.parametrize("dim", [2,3])
+@pytest.mark.parametrize("order", [1,2])
+def test_facetpatch_cache(dim, order):
+    if dim == 2:
+        mesh = MakeStructured2DMesh(quads=False,nx=8,ny=8,mapping=lambda x,y: (2*x-1,2*y-1))
+        levelset = sqrt(x*x+y*y) - 0.5
+    else:
+        mesh = MakeStructured3DMesh(hexes=False,nx=4,ny=4,nz=4,mapping=lambda x,y,z: (2*x-1,2*y-1,2*z-1))
+        levelset = sqrt(x*x+y*y+z*z) - 0.5
+    lsetp1 = GridFunction(H1(mesh,order=1))
+    InterpolateToP1(levelset,lsetp1)
+    ci = CutInfo(mesh,lsetp1)
+    ba_facets = GetFacetsWithNeighborTypes(mesh,a=ci.GetElementsOfType(HASNEG),b=ci.GetElementsOfType(IF))
+
+    Vh = H1(mesh,order=order)
+    u,v = Vh.TnT()
+    gfu = GridFunction(Vh)
+    gfu.Set(x*x+y)
+    h = 2.0/8.0
+
+    def apply(use_cache):
+        a = BilinearForm(Vh,symmetric=False)
+        bfi = SymbolicFacetPatchBFI(form = 0.1/h/h*(u-u.Other())*(v-v.Other()),
+                                    skeleton=False, definedonelements=ba_facets,
+                                    use_cache=use_cache)
+        a += bfi
+        a.Assemble()
+        if use_cache:
+            # congruent patches share their matrix: only few different patches
+            ncached = PatchMatrixCacheSize(bfi)
+            assert ncached > 0
+            assert ncached < ba_facets.NumSet()
+            assert 10 * ncached < mesh.nfacet
+            # reassembly hits the cache
+            a.Assemble()
+            assert PatchMatrixCacheSize(bfi) == ncached
+        else:
+            assert PatchMatrixCacheSize(bfi) == 0
+        w = gfu.vec.CreateVector()
+        w.data = a.mat * gfu.vec
+        return w
+
+    assert_same_for_flags(apply)
+
+def test_facetpatch_cache_xfes():
+    mesh = MakeStructured2DMesh(quads=False,nx=8,ny=8,mapping=lambda x,y: (2*x-1,2*y-1))
+    lsetp1 = GridFunction(H1(mesh,order=1))
+    InterpolateToP1(sqrt(x*x+y*y) - 0.5,lsetp1)
+    ci = CutInfo(mesh,lsetp1)
+    ba_facets = GetFacetsWithNeighborTypes(mesh,a=ci.GetElementsOfType(IF),b=ci.GetElementsOfType(IF))
+
+    Vh = H1(mesh,order=1)
+    Vhx = XFESpace(Vh,lsetp1)
+    VhG = FESpace([Vh,Vhx])
+    (u_std,u_x), (v_std,v_x) = VhG.TnT()
+    gfu = GridFunction(VhG)
+    gfu.components[0].Set(x*x+y)
+    gfu.components[1].vec[:] = 1
+    h = 2.0/8.0
+
+    # congruent patches with a different NEG/POS pattern of the extended dofs must not share
+    # a cached matrix
+    def apply(use_cache):
+        a = BilinearForm(VhG,symmetric=False)
+        bfi = SymbolicFacetPatchBFI(form = 0.1/h/h*(u_std+neg(u_x)-u_std.Other()-neg(u_x).Other())
+                                                  *(v_std+neg(v_x)-v_std.Other()-neg(v_x).Other()),
+                                    skeleton=False, definedonelements=ba_facets,
+                                    use_cache=use_cache)
+        a += bfi
+        a.Assemble()
+        if use_cache:
+            ncached = PatchMatrixCacheSize(bfi)
+            assert 0 < ncached <= ba_facets.NumSet()
+            a.Assemble()
+            assert PatchMatrixCacheSize(bfi) == ncached
+        w = gfu.vec.CreateVector()
+        w.data = a.mat * gfu.vec
+        return w
+
+    assert_same_for_flags(apply)
+
+@pytest.mark.parametrize("order", [1,2])
+@pytest.mark.parametrize("symmetric_p2", [False,True])
+def test_facetpatch_affine_vs_newton(order, symmetric_p2):
+    mesh = MakeStructured2DMesh(quads=False,nx=8,ny=8,mapping=lambda x,y: (2*x-1,2*y-1))
+    lsetp1 = GridFunction(H1(mesh,order=1))
+    InterpolateToP1(sqrt(x*x+y*y) - 0.5,lsetp1)
+    ci = CutInfo(mesh,lsetp1)
+    ba_facets = GetFacetsWithNeighborTypes(mesh,a=ci.GetElementsOfType(HASNEG),b=ci.GetElementsOfType(IF))
+
+    Vh = H1(mesh,order=order)
+    u,v = Vh.TnT()
+    gfu = GridFunction(Vh)
+    gfu.Set(x*x+y)
+    h = 2.0/8.0
+
+    # an affine deformation keeps the elements straight (closed form patch map),
+    # a tiny quadratic perturbation switches to the Newton iteration. The same value
+    # on all edge dofs adds c*(l0*l1+l0*l2+l1*l2) on every element, which is not affine
+    # although the Jacobian in the barycenter is the one of the affine part
+    deform = GridFunction(VectorH1(mesh,order=2))
+    def apply(eps):
+        deform.Set(CoefficientFunction((0.1*y+eps*x*x,0.05*x)))
+        if symmetric_p2:
+            defx = deform.components[0].vec
+            for i in range(mesh.nv, len(defx)):
+                defx[i] += 0.05
+        a = BilinearForm(Vh,symmetric=False)
+        a += SymbolicFacetPatchBFI(form = 0.1/h/h*(u-u.Other())*(v-v.Other()),
+                                   skeleton=False, definedonelements=ba_facets,
+                                   deformation=deform)
+        a.Assemble()
+        w = gfu.vec.CreateVector()
+        w.data = a.mat * gfu.vec
+        return w
+
+    assert_same_for_flags(apply, [0, 1e-7], tol=1e-5)
+
+@pytest.mark.parametrize("order", [1,2])
+def test_aggregation_embedding(order):
+    mesh = MakeStructured2DMesh(quads=False,nx=8,ny=8,mapping=lambda x,y: (2*x-1,2*y-1))
+    levelset = sqrt(x*x+y*y) - 0.53
+    lsetp1 = GridFunction(H1(mesh,order=1))
+    InterpolateToP1(levelset,lsetp1)
+    ci = CutInfo(mesh,lsetp1)
+
+    aggregation = ElementAggregation(mesh,ci,domain_type=NEG,threshold=0.2)
+    roots = aggregation.GetRootElements()
+    bad = aggregation.GetBadElements()
+    active = ci.GetElementsOfType(HASNEG)
+    assert (roots | bad).NumSet() == active.NumSet()
+    assert (roots & bad).NumSet() == 0
+    for el in mesh.Elements():
+        if bad[el.nr]:
+            assert roots[aggregation.GetRootOfElement(el.nr)]
+
+    Vh = H1(mesh,order=order)
+    P = AggregationEmbedding(aggregation,Vh)
+    ones = BaseVector(P.width)
+    ones[:] = 1
+    w = GridFunction(Vh)
+    w.vec.data = P * ones
+
+    # the extension of constants is exact
+    active_dofs = GetDofsOfElements(Vh,active)
+    for i in range(Vh.ndof):
+        assert abs(w.vec[i] - (1 if active_dofs[i] else 0)) < 1e-10
+
+    # ... and of polynomials of degree order (the reduced dofs are the ones of root elements)
+    pol = x-2*y if order == 1 else x*y
+    gradpol = CoefficientFunction((1,-2)) if order == 1 else CoefficientFunction((y,x))
+    gfpol = GridFunction(Vh)
+    gfpol.Set(pol)
+    wellposed = GetDofsOfElements(Vh,roots)
+    rpol = BaseVector(P.width)
+    rpol.FV().NumPy()[:] = [gfpol.vec[i] for i in range(Vh.ndof) if wellposed[i]]
+    w.vec.data = P * rpol
+    for i in range(Vh.ndof):
+        assert abs(w.vec[i] - (gfpol.vec[i] if active_dofs[i] else 0)) < 1e-10
+
+    # reduced solve P^T A P x = P^T f and ghost penalty solve of an unfitted problem with
+    # solution pol: both reproduce pol on the active dofs
+    u,v = Vh.TnT()
+    lset_neg = { "levelset" : lsetp1, "domain_type" : NEG}
+    a = BilinearForm(Vh,symmetric=False)
+    a += SymbolicBFI(levelset_domain = lset_neg, form = grad(u)*grad(v) + u*v, definedonelements=active)
+    a.Assemble()
+    f = LinearForm(Vh)
+    f += SymbolicLFI(levelset_domain = lset_neg, form = gradpol*grad(v) + pol*v, definedonelements=active)
+    f.Assemble()
+
+    ared = GalerkinProjection(a.mat, P)
+    fred = BaseVector(P.width)
+    fred.data = P.T * f.vec
+    xred = BaseVector(P.width)
+    xred.data = ared.Inverse(inverse="sparsecholesky") * fred
+    gfagg = GridFunction(Vh)
+    gfagg.vec.data = P * xred
+
+    h = 2.0/8.0
+    ba_facets = GetFacetsWithNeighborTypes(mesh,a=active,b=ci.GetElementsOfType(IF))
+    agp = BilinearForm(Vh,symmetric=False)
+    agp += SymbolicBFI(levelset_domain = lset_neg, form = grad(u)*grad(v) + u*v, definedonelements=active)
+    agp += SymbolicFacetPatchBFI(form = 0.1/h/h*(u-u.Other())*(v-v.Other()),
+                                 skeleton=False, definedonelements=ba_facets)
+    agp.Assemble()
+    gfgp = GridFunction(Vh)
+    gfgp.vec.data = agp.mat.Inverse(active_dofs, inverse="sparsecholesky") * f.vec
+
+    for i in range(Vh.ndof):
+        if active_dofs[i]:
+            assert abs(gfagg.vec[i] - gfgp.vec[i]) < 1e-8
+            assert abs(gfgp.vec[i] - gfpol.vec[i]) < 1e-8
+
+def test_restrictedblf_reuse_graph():
+    mesh = MakeStructured2DMesh(quads=False,nx=10,ny=10,mapping=lambda x,y: (2*x-1,2*y-1))
+    lsetp1 = GridFunction(H1(mesh,order=1))
+    Vh = H1(mesh,order=1,dgjumps=True)
+    u,v = Vh.TnT()
+    gfu = GridFunction(Vh)
+    gfu.Set(1+x*y)
+    h = 2.0/10.0
+
+    ci = CutInfo(mesh)
+    els = BitArray(mesh.ne)
+    facets = BitArray(mesh.nfacet)
+    def update_restrictions(radius):
+        InterpolateToP1(sqrt(x*x+y*y) - radius,lsetp1)
+        ci.Update(lsetp1)
+        hasneg = ci.GetElementsOfType(HASNEG)
+        gpfacets = GetFacetsWithNeighborTypes(mesh,a=hasneg,b=ci.GetElementsOfType(IF))
+        for i in range(mesh.ne):
+            els[i] = hasneg[i]
+        for i in range(mesh.nfacet):
+            facets[i] = gpfacets[i]
+
+    def add_integrators(a):
+        a += SymbolicBFI(grad(u)*grad(v), definedonelements=els)
+        a += SymbolicFacetPatchBFI(form = 0.1/h/h*(u-u.Other())*(v-v.Other()),
+                                   skeleton=False, definedonelements=facets)
+
+    update_restrictions(0.5)
+    a = RestrictedBilinearForm(Vh,"a",els,facets,check_unused=False,flags={"reuse_graph" : True})
+    add_integrators(a)
+    a.Assemble()
+
+    for radius in [0.51, 0.53, 0.7, 0.4]:
+        update_restrictions(radius)
+        a.Assemble(reallocate=True)
+        a_ref = RestrictedBilinearForm(Vh,"a_ref",els,facets,check_unused=False)
+        add_integrators(a_ref)
+        a_ref.Assemble()
+
+        w = gfu.vec.CreateVector()
+        w_ref = gfu.vec.CreateVector()
+        w.data = a.mat * gfu.vec
+        w_ref.data = a_ref.mat * gfu.vec
+        w.data -= w_ref
+        assert Norm(w) < 1e-10 * Norm(w_ref)
+
+def test_restrictedblf_reuse_graph_symmetric():
+    mesh = MakeStructured2DMesh(quads=False,nx=8,ny=8)
+    Vh = H1(mesh,order=1)
+    u,v = Vh.TnT()
+    gfu = GridFunction(Vh)
+    gfu.Set(1+x*y)
+
+    # an interior element whose couplings are all couplings of its neighbors
+    els = BitArray(mesh.ne)
+    els.Set()
+    hole = mesh(0.5+1e-3,0.5+2e-3).nr
+    els[hole] = False
+
+    a = RestrictedBilinearForm(Vh,"a",els,None,check_unused=False,
+                               flags={"reuse_graph" : True, "symmetric" : True})
+    a += SymbolicBFI(grad(u)*grad(v), definedonelements=els)
+    a.Assemble()
+    assert not a.graph_reused
+
+    els[hole] = True
+    a.Assemble(reallocate=True)
+    assert a.graph_reused
+
+    a_ref = RestrictedBilinearForm(Vh,"a_ref",els,None,check_unused=False,flags={"symmetric" : True})
+    a_ref += SymbolicBFI(grad(u)*grad(v), definedonelements=els)
+    a_ref.Assemble()
+    w = gfu.vec.CreateVector()
+    w_ref = gfu.vec.CreateVector()
+    w.data = a.mat * gfu.vec
+    w_ref.data = a_ref.mat * gfu.vec
+    w.data -= w_ref
+    assert Norm(w) < 1e-10 * Norm(w_ref)
+
+def test_restrictedblf_reuse_graph_xfes():
+    mesh = MakeStructured2DMesh(quads=False,nx=10,ny=10,mapping=lambda x,y: (2*x-1,2*y-1))
+    lsetp1 = GridFunction(H1(mesh,order=1))
+    Vh = H1(mesh,order=1)
+    Vhx = XFESpace(Vh,lsetp1)
+    VhG = FESpace([Vh,Vhx])
+
+    # two radii with the same number of extended dofs but different cut elements,
+    # i.e. the same ndof with a different numbering of the extended dofs
+    found = {}
+    radii = None
+    for radius in [0.4+0.002*i for i in range(100)]:
+        InterpolateToP1(sqrt(x*x+y*y) - radius,lsetp1)
+        Vhx.Update()
+        ifels = CutInfo(mesh,lsetp1).GetElementsOfType(IF)
+        ifels = tuple(ifels[i] for i in range(mesh.ne))
+        if Vhx.ndof in found and found[Vhx.ndof][1] != ifels:
+            radii = [found[Vhx.ndof][0], radius]
+            break
+        found[Vhx.ndof] = (radius, ifels)
+    assert radii != None
+
+    (u_std, u_x), (v_std, v_x) = VhG.TnT()
+    u = [u_std + op(u_x) for op in [neg,pos]]
+    v = [v_std + op(v_x) for op in [neg,pos]]
+    gradu = [grad(u_std) + op(u_x) for op in [neg_grad,pos_grad]]
+    gradv = [grad(v_std) + op(v_x) for op in [neg_grad,pos_grad]]
+    lset_neg = { "levelset" : lsetp1, "domain_type" : NEG}
+    lset_pos = { "levelset" : lsetp1, "domain_type" : POS}
+
+    els = BitArray(mesh.ne)
+    def update_restrictions(radius):
+        InterpolateToP1(sqrt(x*x+y*y) - radius,lsetp1)
+        VhG.Update()
+        hasneg = CutInfo(mesh,lsetp1).GetElementsOfType(HASNEG)
+        for i in range(mesh.ne):
+            els[i] = hasneg[i]
+
+    def add_integrators(a):
+        a += SymbolicBFI(levelset_domain = lset_neg, form = gradu[0]*gradv[0] + u[0]*v[0], definedonelements=els)
+        a += SymbolicBFI(levelset_domain = lset_pos, form = gradu[1]*gradv[1] + u[1]*v[1], definedonelements=els)
+
+    update_restrictions(radii[0])
+    a = RestrictedBilinearForm(VhG,"a",els,None,check_unused=False,flags={"reuse_graph" : True})
+    add_integrators(a)
+    a.Assemble()
+
+    ndof = VhG.ndof
+    update_restrictions(radii[1])
+    assert VhG.ndof == ndof
+    a.Assemble(reallocate=True)
+
+    a_ref = RestrictedBilinearForm(VhG,"a_ref",els,None,check_unused=False)
+    add_integrators(a_ref)
+    a_ref.Assemble()
+
+    gfu = GridFunction(VhG)
+    gfu.components[0].Set(1+x*y)
+    gfu.components[1].Set(1+x)
+    w = gfu.vec.CreateVector()
+    w_ref = gfu.vec.CreateVector()
+    w.data = a.mat * gfu.vec
+    w_ref.data = a_ref.mat * gfu.vec
+    w.data -= w_ref
+    assert Norm(w) < 1e-10 * Norm(w_ref)
+
+def test_restrictedblf_reuse_graph_compressed_space():
+    mesh = MakeStructured2DMesh(quads=False,nx=10,ny=10,mapping=lambda x,y: (2*x-1,2*y-1))
+    lsetp1 = GridFunction(H1(mesh,order=1))
+    Vh = H1(mesh,order=1)
+
+    # a disc shifted by one mesh cell: the same number of active dofs
+    # with a different numbering of the compressed space
+    els = BitArray(mesh.ne)
+    def update_restrictions(shift):
+        InterpolateToP1(sqrt((x-shift)*(x-shift)+y*y) - 0.4,lsetp1)
+        hasneg = CutInfo(mesh,lsetp1).GetElementsOfType(HASNEG)
+        for i in range(mesh.ne):
+            els[i] = hasneg[i]
+        return GetDofsOfElements(Vh,els)
+
+    Vc = Compress(Vh,update_restrictions(0))
+    u,v = Vc.TnT()
+    def add_integrators(a):
+        a += SymbolicBFI(grad(u)*grad(v)+u*v, definedonelements=els)
+
+    a = RestrictedBilinearForm(Vc,"a",els,None,check_unused=False,flags={"reuse_graph" : True})
+    add_integrators(a)
+    a.Assemble()
+
+    ndof = Vc.ndof
+    Vc.SetActiveDofs(update_restrictions(0.2))
+    Vc.Update()
+    assert Vc.ndof == ndof
+    a.Assemble(reallocate=True)
+
+    a_ref = RestrictedBilinearForm(Vc,"a_ref",els,None,check_unused=False)
+    add_integrators(a_ref)
+    a_ref.Assemble()
+
+    gfu = GridFunction(Vc)
+    for i in range(Vc.ndof):
+        gfu.vec[i] = 1+i%7
+    w = gfu.vec.CreateVector()
+    w_ref = gfu.vec.CreateVector()
+    w.data = a.mat * gfu.vec
+    w_ref.data = a_ref.mat * gfu.vec
+    w.data -= w_ref
+    assert Norm(w) < 1e-10 * Norm(w_ref)
+
+def test_restrictedblf_compress():
+    mesh = MakeStructured2DMesh(quads=False,nx=10,ny=10,mapping=lambda x,y: (2*x-1,2*y-1))
+    lsetp1 = GridFunction(H1(mesh,order=1))
+    InterpolateToP1(sqrt(x*x+y*y) - 0.5,lsetp1)
+    ci = CutInfo(mesh,lsetp1)
+    els = ci.GetElementsOfType(HASNEG)
+    facets = GetFacetsWithNeighborTypes(mesh,a=els,b=ci.GetElementsOfType(IF))
+
+    Vh = H1(mesh,order=2,dgjumps=True)
+    u,v = Vh.TnT()
+    gfu = GridFunction(Vh)
+    gfu.Set(1+x*y)
+    h = 2.0/10.0
+
+    mats = []
+    for compress in [False, True]:
+        a = RestrictedBilinearForm(Vh,"a",els,facets,check_unused=False,flags={"compress" : compress})
+        a += SymbolicBFI(grad(u)*grad(v), definedonelements=els)
+        a += SymbolicFacetPatchBFI(form = 0.1/h/h*(u-u.Other())*(v-v.Other()),
+                                   skeleton=False, definedonelements=facets)
+        a.Assemble()
+        mats.append(a)
+
+    E = mats[1].Embedding()
+    assert mats[1].nactive == GetDofsOfElements(Vh,els).NumSet()
+    assert mats[1].mat.height == mats[1].nactive
+
+    w = gfu.vec.CreateVector()
+    w.data = mats[0].mat * gfu.vec
+    u_c = mats[1].mat.CreateColVector()
+    w_c = mats[1].mat.CreateColVector()
+    u_c.data = E.T * gfu.vec
+    w_c.data = mats[1].mat * u_c
+    w.data -= E * w_c
+    assert Norm(w) < 1e-10 * Norm(w_c)
+
+@pytest.mark.parametrize("order", [1,2,3])
+def test_facet_simd_vs_scalar(order):
+    mesh = MakeStructured2DMesh(quads=False,nx=8,ny=8,mapping=lambda x,y: (2*x-1,2*y-1))
+    lsetp1 = GridFunction(H1(mesh,order=1))
+    InterpolateToP1(sqrt(x*x+y*y) - 0.5,lsetp1)
+    ci = CutInfo(mesh,lsetp1)
+    ba_facets = GetFacetsWithNeighborTypes(mesh,a=ci.GetElementsOfType(HASNEG),b=ci.GetElementsOfType(IF))
+
+    Vh = L2(mesh,order=order,dgjumps=True)
+    u,v = Vh.TnT()
+    gfu = GridFunction(Vh)
+    gfu.Set(sin(3*x)*y+x*x)
+    n = specialcf.normal(2)
+    lset_neg = { "levelset" : lsetp1, "domain_type" : NEG}
+
+    # several integration orders, so that the rules are (mostly) no multiple of the SIMD width
+    def apply(simd):
+        a = BilinearForm(Vh,symmetric=False)
+        a += SymbolicFacetPatchBFI(form = (1+x*y)*(u-u.Other())*(v-v.Other())
+                                   + grad(u)*n*(v-v.Other()),
+                                   skeleton=True, definedonelements=ba_facets,
+                                   simd_evaluate=simd)
+        a += SymbolicFacetPatchBFI(form = (u-u.Other())*(v-v.Other()), force_intorder=2*order+1,
+                                   skeleton=True, definedonelements=ba_facets,
+                                   simd_evaluate=simd)
+        a += SymbolicBFI(levelset_domain = lset_neg,
+                         form = (1+x)*(u-u.Other())*(v-v.Other()) + 0.5*(grad(u)+grad(u.Other()))*n*(v-v.Other()),
+                         skeleton=True, simd_evaluate=simd)
+        a.Assemble()
+        w = gfu.vec.CreateVector()
+        w.data = a.mat * gfu.vec
+        return w
+
+    assert_same_for_flags(apply)
+
+@pytest.mark.parametrize("k", [2,3,4])
+@pytest.mark.parametrize("hdiv", [False,True])
+def test_dnk_affine_vs_fd(k, hdiv):
+    mesh = MakeStructured2DMesh(quads=False,nx=4,ny=4,mapping=lambda x,y: (2*x-1,2*y-1))
+    n = specialcf.normal(2)
+    # d^k/dn^k x^k = k! n_x^k
+    exact = factorial(k)
+    xk = 1
+    for i in range(k):
+        exact = exact * n[0]
+        xk = xk * x
+    W = L2(mesh,order=0)
+    w = W.TestFunction()
+
+    def element_boundary_sum(cf):
+        f = LinearForm(W)
+        f += SymbolicLFI(form = cf * w, element_boundary=True)
+        f.Assemble()
+        return sum(f.vec)
+
+    # affine elements use the exact derivatives, a tiny quadratic deformation
+    # switches back to the finite difference stencils
+    deform = GridFunction(VectorH1(mesh,order=2))
+    for eps, tol in [(0, 1e-8), (1e-6, 1e-4 if not hdiv else 1e-3)]:
+        mesh.UnsetDeformation()
+        deform.Set(CoefficientFunction((eps*x*x,0)))
+        mesh.SetDeformation(deform)
+        ref = element_boundary_sum(exact*exact)
+        if not hdiv:
+            gfu = GridFunction(H1(mesh,order=k))
+            gfu.Set(xk)
+            err = sqrt(element_boundary_sum((dn(gfu,k)-exact)*(dn(gfu,k)-exact)))
+            assert err < tol * sqrt(ref)
+        else:
+            # u = (x^k,0): sum over all elements of int_{dT} d^k/dn^k u * (k! n_x^k, 0)
+            Vh = HDiv(mesh,order=k)
+            gfu = GridFunction(Vh)
+            gfu.Set(CoefficientFunction((xk,0)))
+            f = LinearForm(Vh)
+            f += SymbolicLFI(form = InnerProduct(dn(Vh.TestFunction(),k,hdiv=True),
+                                                 CoefficientFunction((exact,0))),
+                             element_boundary=True)
+            f.Assemble()
+            assert abs(InnerProduct(f.vec,gfu.vec) - ref) < tol * ref
+    mesh.UnsetDeformation()
@@ -89,3 +89,143 @@ def test_intcurved(quad, order):
     assert sum(eoc_curved[IF][s:])/len(eoc_curved[IF][s:]) > order + 0.75
     assert sum(eoc_curved[NEG][s:])/len(eoc_curved[NEG][s:]) > order + 0.75
     assert sum(eoc_curved[POS][s:])/len(eoc_curved[POS][s:]) > order + 0.75
+
+@pytest.mark.parametrize("order", [1,2,3])
+
+def test_calcdeformation_band(order):
+    mesh = MakeStructured2DMesh(quads = False, nx=16, ny=16, mapping = lambda x,y : (2*x-1,2*y-1))
+    lsetmeshadap = LevelSetMeshAdaptation(mesh, order=order, threshold=0.2, discontinuous_qn=True)
+    for r in [0.5, 0.3]:
+        lsetmeshadap.CalcDeformation(sqrt(x*x+y*y)-r)
+        band = lsetmeshadap.band
+        assert band.NumSet() > 0
+        assert band.NumSet() < mesh.ne
+
+    # values of the old band are reset, i.e. the result is the same as on a new mesh adaptation
+    lsetmeshadap_new = LevelSetMeshAdaptation(mesh, order=order, threshold=0.2, discontinuous_qn=True)
+    lsetmeshadap_new.CalcDeformation(sqrt(x*x+y*y)-0.3)
+    for a, b in [(lsetmeshadap.deform, lsetmeshadap_new.deform),
+                 (lsetmeshadap.lset_ho, lsetmeshadap_new.lset_ho),
+                 (lsetmeshadap.qn, lsetmeshadap_new.qn)]:
+        diff = a.vec.CreateVector()
+        diff.data = a.vec - b.vec
+        assert Norm(diff) < 1e-12
+
+
+def test_refine_at_levelset_band():
+    mesh = MakeStructured2DMesh(quads = False, mapping = lambda x,y: (2*x-1,2*y-1), nx=16, ny=16)
+    lsetp1 = GridFunction(H1(mesh,order=1))
+    InterpolateToP1(sqrt(x*x+y*y)-0.5+1e-4,lsetp1)
+
+    ba = RefineAtLevelSet(gf=lsetp1)
+    ci = CutInfo(mesh, lsetp1)
+    ba_if = ci.GetElementsOfType(IF)
+    assert ba.NumSet() > 0
+    for i in range(mesh.ne):
+        assert ba[i] == ba_if[i]
+
+    ba_wide = RefineAtLevelSet(gf=lsetp1, lower=-0.2, upper=0.2)
+    assert ba_wide.NumSet() > ba.NumSet()
+
+    ne = mesh.ne
+    mesh.Refine()
+    assert mesh.ne > ne
+
+@pytest.mark.parametrize("order", [2,3])
+@pytest.mark.parametrize("discontinuous_qn", [False,True])
+
+def test_calcdeformation_band_vs_projectshift(order, discontinuous_qn):
+    # quadratic level set: lset_ho is exact, the P1 interpolation of levelset and of lset_ho agree
+    levelset = x*x+y*y-0.25
+    mesh = MakeStructured2DMesh(quads = False, nx=16, ny=16, mapping = lambda x,y : (2*x-1,2*y-1))
+    lsetmeshadap = LevelSetMeshAdaptation(mesh, order=order, threshold=0.2, discontinuous_qn=discontinuous_qn)
+    lsetmeshadap.CalcDeformation(levelset)
+    band = lsetmeshadap.band
+
+    # previous pipeline: Set, InterpolateToP1(lset_ho) and ProjectShift
+    lset_ho = GridFunction(lsetmeshadap.v_ho)
+    lset_p1 = GridFunction(lsetmeshadap.v_p1)
+    qn = GridFunction(lsetmeshadap.v_qn)
+    deform = GridFunction(lsetmeshadap.v_def)
+    lset_ho.Set(levelset)
+    qn.Set(lset_ho.Deriv())
+    InterpolateToP1(lset_ho,lset_p1)
+    ProjectShift(lset_ho, lset_p1, deform, qn, blending=CoefficientFunction(0.0),
+                 lower=0.0, upper=0.0, threshold=0.2)
+
+    diff = lset_p1.vec.CreateVector()
+    diff.data = lset_p1.vec - lsetmeshadap.lset_p1.vec
+    assert Norm(diff) < 1e-12
+
+    # the band-limited projections only agree on dofs of interior band elements
+    # (the ones that are not shared with elements outside the band)
+    outside = ~band
+    for a, b in [(lsetmeshadap.lset_ho, lset_ho), (lsetmeshadap.qn, qn), (lsetmeshadap.deform, deform)]:
+        interior = GetDofsOfElements(a.space, band) & ~GetDofsOfElements(a.space, outside)
+        assert interior.NumSet() > 0
+        dim = a.space.dim
+        avals = a.vec.FV().NumPy().reshape(-1, dim)
+        bvals = b.vec.FV().NumPy().reshape(-1, dim)
+        for d in range(a.space.ndof):
+            if interior[d]:
+                assert max(abs(avals[d]-bvals[d])) < 1e-10
+
+@pytest.mark.parametrize("order", [2,3])
+
+def test_calcdeformationerror_gradient_of_gridfunction(order):
+    mesh = MakeStructured2DMesh(quads = False, nx=16, ny=16, mapping = lambda x,y : (2*x-1,2*y-1))
+    lsetmeshadap = LevelSetMeshAdaptation(mesh, order=order, threshold=0.2, discontinuous_qn=True)
+    lsetmeshadap.CalcDeformation(sqrt(x*x+y*y)-0.5)
+    lset_ho = lsetmeshadap.lset_ho
+
+    def deformation_error(lset):
+        stats = StatisticContainer()
+        CalcDeformationError(lset_ho=lset, lset_p1=lsetmeshadap.lset_p1, deform=lsetmeshadap.deform,
+                             qn=lsetmeshadap.qn, stats=stats)
+        return [stats.ErrorL2Norm[-1], stats.ErrorMaxNorm[-1], stats.ErrorMisc[-1]]
+
+    def assert_close(a, b, tol):
+        for va, vb in zip(a, b):
+            assert abs(va - vb) <= tol * max(abs(va), 1e-14)
+
+    # gradient of the GridFunction (exact) and of the same function as a plain
+    # CoefficientFunction (central differences) in the point search
+    errors = deformation_error(lset_ho)
+    assert errors[0] > 0
+    assert_close(errors, deformation_error(1.0*lset_ho), 1e-6)
+
+    # level set as SpaceTimeFE GridFunction at a fixed time (linear in time,
+    # with the value 2*lset_ho at t=0.5)
+    st_fes = SpaceTimeFESpace(lsetmeshadap.v_ho, ScalarTimeFE(1))
+    lset_st = GridFunction(st_fes)
+    ndof = lsetmeshadap.v_ho.ndof
+    lset_st.vec[0:ndof].data = lset_ho.vec
+    lset_st.vec[ndof:2*ndof].data = 3 * lset_ho.vec
+    lset_ref = GridFunction(lsetmeshadap.v_ho)
+    lset_ref.vec.data = 2 * lset_ho.vec
+    errors_ref = deformation_error(lset_ref)
+    st_fes.SetTime(0.5)
+    assert_close(errors_ref, deformation_error(lset_st), 1e-10)
+    assert_close(errors_ref, deformation_error(1.0*lset_st), 1e-6)
+    st_fes.SetOverrideTime(False)
+
+@pytest.mark.parametrize("order", [2,3])
+
+def test_calcdeformationerror_batched_search(order):
+    mesh = MakeStructured2DMesh(quads = False, nx=16, ny=16, mapping = lambda x,y : (2*x-1,2*y-1))
+    lsetmeshadap = LevelSetMeshAdaptation(mesh, order=order, threshold=0.2, discontinuous_qn=True)
+    lsetmeshadap.CalcDeformation(sqrt(sqrt(x*x*x*x+y*y*y*y))-0.5)
+
+    # the point searches of all points of an element at once give the same points
+    # (and hence errors) and the same numbers of iterations as the single point searches
+    results = []
+    for batched in [False, True]:
+        stats = StatisticContainer()
+        its = CalcDeformationError(lset_ho=lsetmeshadap.lset_ho, lset_p1=lsetmeshadap.lset_p1,
+                                   deform=lsetmeshadap.deform, qn=lsetmeshadap.qn, stats=stats,
+                                   batched=batched)
+        results.append((stats.ErrorL2Norm[-1], stats.ErrorMaxNorm[-1], stats.ErrorMisc[-1], its))
+    assert results[0][3][0] > 0
+    assert results[1][3] == results[0][3]
+    for a, b in zip(results[0][0:3], results[1][0:3]):
+        assert abs(a - b) <= 1e-12 * abs(a)
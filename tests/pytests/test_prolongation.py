@@ -0,0 +1,402 @@
+import pytest
+from ngsolve import *
+from netgen.geom2d import unit_square
+from xfem import *
+import numpy as np
+
+@pytest.mark.parametrize("dim", [1,2])
+def test_p1prolongation(dim):
+    mesh = Mesh(unit_square.GenerateMesh(maxh=0.3))
+    Vh = H1(mesh, order=1, dim=dim)
+    prol = P1Prolongation(mesh)
+    prol.Update(Vh)
+
+    cf = x+2*y if dim == 1 else CoefficientFunction((x+2*y,3*x-y))
+    gfc = GridFunction(Vh)
+    gfc.Set(cf)
+    coarsevals = np.array(gfc.vec.FV().NumPy())
+    nc = len(coarsevals)
+
+    mesh.Refine()
+    Vh.Update()
+    prol.Update(Vh)
+    gff = GridFunction(Vh)
+    gff.Set(cf)
+
+    # prolongation of a linear function is exact, also for several vectors at once
+    vecs = [gff.vec.CreateVector() for i in range(2)]
+    for i, vec in enumerate(vecs):
+        vec.FV().NumPy()[:] = 0
+        vec.FV().NumPy()[0:nc] = (i+1) * coarsevals
+    prol.Prolongate(1, vecs)
+    for i, vec in enumerate(vecs):
+        vec.data -= (i+1) * gff.vec
+        assert Norm(vec) < 1e-12
+
+    # restriction is the transpose of the prolongation
+    uc = gff.vec.CreateVector()
+    uc.FV().NumPy()[:] = 0
+    uc.FV().NumPy()[0:nc] = np.random.rand(nc)
+    vf = gff.vec.CreateVector()
+    vf.FV().NumPy()[:] = np.random.rand(len(vf.FV().NumPy()))
+    puc = uc.CreateVector()
+    puc.data = uc
+    prol.Prolongate(1, puc)
+    rvf = vf.CreateVector()
+    rvf.data = vf
+    prol.Restrict(1, rvf)
+    assert abs(InnerProduct(puc, vf) - InnerProduct(uc, rvf)) < 1e-10
+
+@pytest.mark.parametrize("order", [1,2])
+def test_prolongation_matrix_and_galerkin(order):
+    mesh = Mesh(unit_square.GenerateMesh(maxh=0.3))
+    Vh = H1(mesh, order=order)
+    prol = P1Prolongation(mesh) if order == 1 else P2Prolongation(mesh)
+    prol.Update(Vh)
+    u,v = Vh.TnT()
+
+    cf = x+2*y if order == 1 else x*x+x*y-2*y
+    gfc = GridFunction(Vh)
+    gfc.Set(cf)
+    coarsevec = gfc.vec.CreateVector()
+    coarsevec.data = gfc.vec
+    ac = BilinearForm(Vh, symmetric=False)
+    ac += (grad(u)*grad(v)+u*v)*dx
+    ac.Assemble()
+    coarsemat = ac.mat
+
+    mesh.Refine()
+    Vh.Update()
+    prol.Update(Vh)
+    gff = GridFunction(Vh)
+    gff.Set(cf)
+
+    # the prolongation matrix reproduces the (piecewise polynomial) function
+    P = prol.CreateMatrix(1)
+    assert P.height == Vh.ndof and P.width == len(coarsevec)
+    pvec = P.CreateColVector()
+    pvec.data = P * coarsevec
+    pvec.data -= gff.vec
+    assert Norm(pvec) < 1e-12
+
+    # P^T A P is the coarse matrix (nested spaces)
+    af = BilinearForm(Vh, symmetric=False)
+    af += (grad(u)*grad(v)+u*v)*dx
+    af.Assemble()
+    galerkinmat = GalerkinProjection(af.mat, P)
+    w = coarsevec.CreateVector()
+    w.SetRandom()
+    diff = coarsevec.CreateVector()
+    diff.data = galerkinmat * w - coarsemat * w
+    assert Norm(diff) < 1e-10 * Norm(w)
+
+def test_p2cutprolongation():
+    mesh = Mesh(unit_square.GenerateMesh(maxh=0.3))
+    levelset = sqrt((x-0.5)*(x-0.5)+(y-0.5)*(y-0.5)) - 0.3
+    lsetp1 = GridFunction(H1(mesh,order=1))
+    Vh = H1(mesh, order=2)
+    prol = P2Prolongation(mesh)
+    prolcut = P2CutProlongation(mesh)
+
+    # cut space: only the dofs of the elements with a negative part are active
+    def cutspace():
+        lsetp1.space.Update()
+        lsetp1.Update()
+        InterpolateToP1(levelset,lsetp1)
+        els = CutInfo(mesh,lsetp1).GetElementsOfType(HASNEG)
+        Vc = Compress(Vh,GetDofsOfElements(Vh,els))
+        # active dof of the compressed space for every dof of Vh (or -1)
+        comp = np.full(Vh.ndof, -1)
+        for el in mesh.Elements(VOL):
+            for d, dc in zip(Vh.GetDofNrs(el), Vc.GetDofNrs(el)):
+                comp[d] = dc
+        return Vc, comp
+
+    Vcc, compc = cutspace()
+    prol.Update(Vh)
+    prolcut.Update(Vcc)
+    nc = Vcc.ndof
+    mesh.Refine()
+    Vh.Update()
+    Vcf, compf = cutspace()
+    prol.Update(Vh)
+    prolcut.Update(Vcf)
+    assert nc < len(compc) and Vcf.ndof < Vh.ndof
+
+    # the rows of the active dofs are the ones of the P2 prolongation (inactive
+    # coarse dofs are zero), the inactive dofs have no rows
+    P = prolcut.CreateMatrix(1)
+    Pfull = prol.CreateMatrix(1)
+    assert P.height == Vcf.ndof and P.width == nc
+    uc = P.CreateRowVector()
+    uc.SetRandom()
+    ucfull = Pfull.CreateRowVector()
+    ucfull.FV().NumPy()[:] = 0
+    ucfull.FV().NumPy()[compc >= 0] = uc.FV().NumPy()[compc[compc >= 0]]
+    uf = P.CreateColVector()
+    uf.data = P * uc
+    uffull = Pfull.CreateColVector()
+    uffull.data = Pfull * ucfull
+    diff = uf.FV().NumPy()[compf[compf >= 0]] - uffull.FV().NumPy()[compf >= 0]
+    assert np.linalg.norm(diff) < 1e-12 * Norm(uf)
+
+    # Prolongate and Restrict apply the matrix and its transpose
+    vec = P.CreateColVector()
+    vec.FV().NumPy()[:] = 0
+    vec.FV().NumPy()[0:nc] = uc.FV().NumPy()
+    prolcut.Prolongate(1, vec)
+    vec.data -= uf
+    assert Norm(vec) < 1e-12 * Norm(uf)
+
+    wf = P.CreateColVector()
+    wf.SetRandom()
+    wc = P.CreateRowVector()
+    wc.data = P.T * wf
+    vec.data = wf
+    prolcut.Restrict(1, vec)
+    assert np.linalg.norm(vec.FV().NumPy()[nc:]) == 0
+    diff = vec.FV().NumPy()[0:nc] - wc.FV().NumPy()
+    assert np.linalg.norm(diff) < 1e-12 * Norm(wc)
+
+@pytest.mark.parametrize("ifcorrection", [False,True])
+def test_cutmultigrid(ifcorrection):
+    mesh = Mesh(unit_square.GenerateMesh(maxh=0.3))
+    levelset = sqrt((x-0.5)*(x-0.5)+(y-0.5)*(y-0.5)) - 0.3
+    Vh = H1(mesh, order=1, dirichlet=".*")
+    prol = P1Prolongation(mesh)
+    u,v = Vh.TnT()
+    a = BilinearForm(Vh, symmetric=False)
+    a += (grad(u)*grad(v)+u*v)*dx
+    f = LinearForm(Vh)
+    f += v*dx
+    lsetp1 = GridFunction(H1(mesh,order=1))
+
+    mats, freedofs, ifdofs = [], [], []
+    for l in range(3):
+        if l > 0:
+            mesh.Refine()
+        Vh.Update()
+        lsetp1.space.Update()
+        lsetp1.Update()
+        InterpolateToP1(levelset,lsetp1)
+        ci = CutInfo(mesh,lsetp1)
+        prol.Update(Vh)
+        a.Assemble()
+        mats.append(a.mat)
+        freedofs.append(Vh.FreeDofs())
+        ifdofs.append(GetDofsOfElements(Vh,ci.GetElementsOfType(IF)) & Vh.FreeDofs())
+    f.Assemble()
+
+    mg = CutMultiGrid(matrices=mats, prol=prol, freedofs=freedofs,
+                      ifdofs=ifdofs if ifcorrection else None, nu=2)
+    assert mg.nlevels == 3
+    gfu = GridFunction(Vh)
+    proj = Projector(Vh.FreeDofs(), True)
+    res = gfu.vec.CreateVector()
+    res.data = proj * f.vec
+    norm0 = Norm(res)
+    for it in range(10):
+        gfu.vec.data += mg * res
+        res.data = f.vec - a.mat * gfu.vec
+        res.data = proj * res
+    # multigrid convergence rate (clearly) below 0.3
+    assert Norm(res) < 0.3**10 * norm0
+
+@pytest.mark.parametrize("useblocks", [False,True])
+def test_cutmultigrid_vs_multigridcl(useblocks):
+    from xfem.cutmg import MultiGridCL, CutFemSmoother
+    mesh = Mesh(unit_square.GenerateMesh(maxh=0.3))
+    levelset = sqrt((x-0.5)*(x-0.5)+(y-0.5)*(y-0.5)) - 0.3
+    Vh = H1(mesh, order=1)
+    prol = P1Prolongation(mesh)
+    lsetp1 = GridFunction(H1(mesh,order=1))
+
+    # cut space: H1 compressed to the dofs of the elements with a negative part
+    spaces, forms, mats, freedofs, ifdofs, blocks, smoothers = [], [], [], [], [], [], [None]
+    for l in range(3):
+        if l > 0:
+            mesh.Refine()
+        Vh.Update()
+        lsetp1.space.Update()
+        lsetp1.Update()
+        InterpolateToP1(levelset,lsetp1)
+        ci = CutInfo(mesh,lsetp1)
+        els = ci.GetElementsOfType(HASNEG)
+        Vc = Compress(Vh,GetDofsOfElements(Vh,els))
+        prol.Update(Vc)
+        u,v = Vc.TnT()
+        a = BilinearForm(Vc, symmetric=False)
+        a += SymbolicBFI(grad(u)*grad(v)+u*v, definedonelements=els)
+        a.Assemble()
+        spaces.append(Vc)
+        forms.append(a)
+        mats.append(a.mat)
+        freedofs.append(Vc.FreeDofs())
+        ifdofs.append(GetDofsOfElements(Vc,ci.GetElementsOfType(IF)) & Vc.FreeDofs())
+        blocks.append(PatchBlocks(Vc, "vert") if useblocks and l > 0 else None)
+        if l > 0:
+            if useblocks:
+                smoothers.append(CutFemSmoother(a=a, CutVh=Vc, ci=ci, ifsolver="direct",
+                                                blocks=blocks[l], ifcorr_only_once=True))
+            else:
+                smoothers.append(CutFemSmoother(a=a, CutVh=Vc, ci=ci, ifsolver="direct",
+                                                ifcorr_only_once=True))
+    assert Vc.ndof < Vh.ndof
+    coarseinv = mats[0].Inverse(freedofs[0], inverse="sparsecholesky")
+
+    # one application of the C++ cycle and of the python cycle with the same smoothers
+    mg = CutMultiGrid(matrices=mats, prol=prol, freedofs=freedofs, ifdofs=ifdofs,
+                      blocks=blocks if useblocks else None, coarsegridsolver=coarseinv,
+                      nu=2, ifcorr_only_once=True)
+    mg_ref = MultiGridCL(level=2, prol=prol, matrices=mats, smoothers=smoothers,
+                         nu=2, coarsegridsolver=coarseinv)
+    rhs = mats[-1].CreateColVector()
+    rhs.SetRandom()
+    w = mats[-1].CreateColVector()
+    w_ref = mats[-1].CreateColVector()
+    w.data = mg * rhs
+    w_ref[:] = 0
+    mg_ref.Mult(rhs, w_ref)
+    assert Norm(w) > 0
+    w_ref.data -= w
+    assert Norm(w_ref) < 1e-10 * Norm(w)
+
+def test_linearmgiterator_galerkin():
+    from xfem.cutmg import LinearMGIterator
+    mesh = Mesh(unit_square.GenerateMesh(maxh=0.3))
+    levelset = sqrt((x-0.5)*(x-0.5)+(y-0.5)*(y-0.5)) - 0.3
+    lsetp1 = GridFunction(H1(mesh,order=1))
+    InterpolateToP1(levelset,lsetp1)
+    ci = CutInfo(mesh,lsetp1)
+    Vh = H1(mesh, order=1, dirichlet=".*")
+    u,v = Vh.TnT()
+    a = BilinearForm(Vh, symmetric=False)
+    a += (grad(u)*grad(v)+u*v)*dx
+    a.Assemble()
+
+    mg = LinearMGIterator(a=a, mesh=mesh, ci=ci, lsetp1=lsetp1, ifsolver="direct",
+                          native=True, galerkin=True, nu=2, printinfo=False, tol=1e-10)
+    nlevels = 3
+    for l in range(1,nlevels):
+        mesh.Refine()
+        Vh.Update()
+        lsetp1.space.Update()
+        lsetp1.Update()
+        InterpolateToP1(levelset,lsetp1)
+        ci = CutInfo(mesh,lsetp1)
+        # only the finest level is assembled
+        if l == nlevels-1:
+            a.Assemble()
+            mg.Update(a, Vh, ci)
+        else:
+            mg.Update(None, Vh, ci)
+    assert mg.MGpre.nlevels == nlevels
+
+    f = LinearForm(Vh)
+    f += v*dx
+    f.Assemble()
+    gfu = GridFunction(Vh)
+    gfu.vec.data = mg * f.vec
+    sol = gfu.vec.CreateVector()
+    sol.data = a.mat.Inverse(Vh.FreeDofs()) * f.vec
+    sol.data -= gfu.vec
+    assert Norm(sol) < 1e-8 * Norm(gfu.vec)
+
+@pytest.mark.parametrize("patchtype", ["vert","edge","elem"])
+def test_patchblocks(patchtype):
+    mesh = Mesh(unit_square.GenerateMesh(maxh=0.2))
+    Vh = H1(mesh, order=2, dirichlet=".*")
+    freedofs = Vh.FreeDofs()
+
+    # reference: python version of the patches (on the elements marked in els)
+    def eldofs(el):
+        return set(d for d in Vh.GetDofNrs(el) if d >= 0 and freedofs[d])
+    def refblocks(els):
+        ref = []
+        if patchtype == "vert":
+            for v in mesh.vertices:
+                ref.append(set().union(*[eldofs(el) for el in mesh[v].elements if els[el.nr]]))
+        elif patchtype == "edge":
+            for edge in mesh.edges:
+                if len(Vh.GetDofNrs(edge)) > 0:
+                    ref.append(set().union(*[eldofs(el) for el in mesh[edge].elements if els[el.nr]]))
+        else:
+            for el in Vh.Elements():
+                if els[el.nr]:
+                    ref.append(eldofs(el))
+        return sorted([sorted(b) for b in ref if len(b) > 0])
+
+    allels = BitArray(mesh.ne)
+    allels.Set()
+    blocks = PatchBlocks(Vh, patchtype)
+    assert sorted([sorted(b) for b in blocks]) == refblocks(allels)
+
+    # restriction to a subset of elements
+    lsetp1 = GridFunction(H1(mesh,order=1))
+    InterpolateToP1(sqrt((x-0.5)*(x-0.5)+(y-0.5)*(y-0.5)) - 0.3,lsetp1)
+    ci = CutInfo(mesh,lsetp1)
+    band = ci.GetElementsOfType(IF)
+    bandblocks = PatchBlocks(Vh, patchtype, elements=band)
+    assert len(bandblocks) > 0
+    assert sorted([sorted(b) for b in bandblocks]) == refblocks(band)
+
+    # the C++ smoother equals the block smoother with the same blocks
+    u,v = Vh.TnT()
+    a = BilinearForm(Vh, symmetric=False)
+    a += grad(u)*grad(v)*dx
+    a.Assemble()
+    f = a.mat.CreateColVector()
+    f.SetRandom()
+    for els, blocks in [(None, blocks), (band, bandblocks)]:
+        smoother = PatchBlockSmoother(a.mat, Vh, patchtype, elements=els, parallel=False)
+        smoother_ref = a.mat.CreateBlockSmoother(blocks)
+        w = a.mat.CreateColVector()
+        w_ref = a.mat.CreateColVector()
+        w[:] = 0
+        w_ref[:] = 0
+        smoother.Smooth(w, f)
+        smoother_ref.Smooth(w_ref, f)
+        assert Norm(w) > 0
+        w_ref.data -= w
+        assert Norm(w_ref) < 1e-10 * Norm(w)
+
+def test_interfacecorrection():
+    mesh = Mesh(unit_square.GenerateMesh(maxh=0.1))
+    lsetp1 = GridFunction(H1(mesh,order=1))
+    InterpolateToP1(sqrt((x-0.5)*(x-0.5)+(y-0.5)*(y-0.5)) - 0.3,lsetp1)
+    ci = CutInfo(mesh,lsetp1)
+    Vh = H1(mesh, order=1, dirichlet=".*")
+    ifdofs = GetDofsOfElements(Vh,ci.GetElementsOfType(IF)) & Vh.FreeDofs()
+    u,v = Vh.TnT()
+    coef = Parameter(1)
+    a = BilinearForm(Vh, symmetric=False)
+    a += (coef*grad(u)*grad(v)+u*v)*dx
+    a.Assemble()
+
+    ifcorr = InterfaceCorrection(a.mat, ifdofs)
+    assert ifcorr.ndof == sum(ifdofs)
+
+    def check_interface_residual():
+        w = a.mat.CreateColVector()
+        f = a.mat.CreateColVector()
+        w.SetRandom()
+        f.SetRandom()
+        wold = w.CreateVector()
+        wold.data = w
+        ifcorr.Apply(w, f)
+        res = f.CreateVector()
+        res.data = f - a.mat * w
+        for i in range(len(res)):
+            if ifdofs[i]:
+                assert abs(res[i]) < 1e-10
+            else:
+                assert w[i] == wold[i]
+
+    check_interface_residual()
+    # same pattern, new values: numerical refactorization only
+    coef.Set(2)
+    a.Assemble()
+    assert ifcorr.Update(a.mat, ifdofs)
+    check_interface_residual()
+    # other subset: new extraction
+    assert not ifcorr.Update(a.mat, Vh.FreeDofs())
@@ -42,3 +42,34 @@ def test_shifteval():
   print ("L2-error(new):", error_new)
   assert error_old < 1e-3
   assert error_new < 1e-3
+
+def test_shifteval_spacetime():
+  mesh = MakeStructured2DMesh(quads = False, nx=4, ny=4)
+  tref = ReferenceTimeVariable()
+
+  fes_space = H1(mesh, order=2)
+  fes = SpaceTimeFESpace(fes_space, ScalarTimeFE(1))
+  fes_dfm = H1(mesh, order=1, dim=2)
+
+  # u = (1-t) x^2 + t y (exactly represented in space and time)
+  gfu_space = GridFunction(fes_space)
+  gfu = GridFunction(fes)
+  gfu_space.Set(x*x)
+  gfu.vec[0:fes_space.ndof].data = gfu_space.vec
+  gfu_space.Set(y)
+  gfu.vec[fes_space.ndof:2*fes_space.ndof].data = gfu_space.vec
+
+  dfm_forth = GridFunction(fes_dfm)
+  dfm_forth.Set(CoefficientFunction((0.1*y,0.05)))
+
+  xs = x + 0.1*y
+  ys = y + 0.05
+  exact = (1-tref)*xs*xs + tref*ys
+
+  lset = GridFunction(fes)
+  lset.vec[:] = -1
+  error = Integrate(levelset_domain = { "levelset" : lset, "domain_type" : NEG},
+                    cf=(shifted_eval(gfu,None,dfm_forth)-exact)**2,
+                    mesh=mesh, order=6, time_order=4)
+  print ("L2-error(spacetime):", sqrt(abs(error)))
+  assert sqrt(abs(error)) < 1e-10
@@ -428,3 +428,63 @@ def test_eb_cut_integrator_2d():
         eocs = [log(h1errors[i-1]/h1errors[i])/log(2) for i in range(1,len(h1errors))]
         print ("h1 eocs : ", eocs)
         assert sum(eocs)/len(eocs) > 4.5
+
+@pytest.mark.parametrize("domain", [NEG, IF])
+def test_restricted_integration_and_linearform(domain):
+    mesh = MakeStructured2DMesh(quads = False, nx=8, ny=8)
+    lset_approx = GridFunction(H1(mesh,order=1))
+    InterpolateToP1(sqrt(x*x+y*y)-0.6,lset_approx)
+    ci = CutInfo(mesh,lset_approx)
+    els = ci.GetElementsOfType(HASNEG if domain == NEG else IF)
+    lset_dom = { "levelset" : lset_approx, "domain_type" : domain}
+
+    integral = Integrate(levelset_domain = lset_dom, cf=x+y, mesh=mesh, order = 2)
+    integral_restr = Integrate(levelset_domain = lset_dom, cf=x+y, mesh=mesh, order = 2,
+                               definedonelements=els)
+    assert abs(integral - integral_restr) < 1e-12
+
+    V = H1(mesh,order=2)
+    v = V.TestFunction()
+    f = LinearForm(V)
+    f += SymbolicLFI(levelset_domain = lset_dom, form = (x+y) * v)
+    f.Assemble()
+    f_restr = RestrictedLinearForm(V,"f",els)
+    f_restr += SymbolicLFI(levelset_domain = lset_dom, form = (x+y) * v, definedonelements=els)
+    f_restr.Assemble()
+    f_restr.vec.data -= f.vec
+    assert Norm(f_restr.vec) < 1e-12
+
+@pytest.mark.parametrize("domain", [NEG, POS])
+def test_cutlfi_fastpath_and_simd(domain):
+    mesh = MakeStructured2DMesh(quads = False, nx=8, ny=8)
+    levelset = x+0.7*y-0.8
+    lset_approx = GridFunction(H1(mesh,order=1))
+    InterpolateToP1(levelset,lset_approx)
+
+    V = H1(mesh,order=2)
+    v = V.TestFunction()
+    vecs = []
+    # the P1 level set gridfunction uses the fast path on uncut elements, the
+    # (identical) linear coefficient function uses cut rules on all elements
+    for lset, simd in [(lset_approx, True), (lset_approx, False), (levelset, False)]:
+        f = LinearForm(V)
+        f += SymbolicLFI(levelset_domain = {"levelset" : lset, "domain_type" : domain},
+                         form = (1+x*y) * v, simd_evaluate = simd)
+        f.Assemble()
+        vecs.append(f.vec)
+    for vec in vecs[1:]:
+        diff = vec.CreateVector()
+        diff.data = vec - vecs[0]
+        assert Norm(diff) < 1e-12
+
+    # completely uncut: identical to the standard linear form
+    lset_approx.vec[:] = -1 if domain == NEG else 1
+    f = LinearForm(V)
+    f += SymbolicLFI(levelset_domain = {"levelset" : lset_approx, "domain_type" : domain},
+                     form = (1+x*y) * v)
+    f.Assemble()
+    f_ref = LinearForm(V)
+    f_ref += SymbolicLFI(form = (1+x*y) * v)
+    f_ref.Assemble()
+    f.vec.data -= f_ref.vec
+    assert Norm(f.vec) < 1e-12
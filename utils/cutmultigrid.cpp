@@ -0,0 +1,387 @@
+#include "../utils/cutmultigrid.hpp"
+#include "../utils/ngsxstd.hpp"
+
+using namespace ngcomp;
+
+namespace ngmg
+{
+
+  shared_ptr<Table<int>> CreatePatchBlocks (shared_ptr<FESpace> fes,
+                                            PATCH_TYPE patchtype,
+                                            shared_ptr<BitArray> freedofs,
+                                            shared_ptr<BitArray> elements)
+  {
+    static Timer t("CreatePatchBlocks"); RegionTimer r(t);
+    auto ma = fes->GetMeshAccess();
+    if (!freedofs)
+      freedofs = fes->GetFreeDofs();
+
+    Array<int> elnrs;
+    if (elements)
+      BitArrayToIndices(*elements, elnrs);
+    else
+    {
+      elnrs.SetSize(ma->GetNE(VOL));
+      for (auto i : Range(elnrs))
+        elnrs[i] = i;
+    }
+
+    size_t npatches = 0;
+    Array<bool> edge_has_dofs;
+    switch (patchtype)
+    {
+    case VERTEX_PATCH: npatches = ma->GetNV(); break;
+    case ELEMENT_PATCH: npatches = ma->GetNE(VOL); break;
+    case EDGE_PATCH:
+      npatches = ma->GetNEdges();
+      edge_has_dofs.SetSize(npatches);
+      ParallelForRange (npatches, [&] (IntRange myrange)
+      {
+        Array<DofId> dnums;
+        for (auto e : myrange)
+        {
+          fes->GetDofNrs(NodeId(NT_EDGE,e), dnums);
+          edge_has_dofs[e] = false;
+          for (auto d : dnums)
+            if (IsRegularDof(d))
+              edge_has_dofs[e] = true;
+        }
+      });
+      break;
+    }
+
+    // element dofs for all patches of the element (with duplicates)
+    TableCreator<int> creator(npatches);
+    for ( ; !creator.Done(); creator++)
+      ParallelForRange (elnrs.Size(), [&] (IntRange myrange)
+      {
+        Array<DofId> dnums;
+        for (auto k : myrange)
+        {
+          ElementId ei(VOL, elnrs[k]);
+          fes->GetDofNrs(ei, dnums);
+          auto ngel = ma->GetElement(ei);
+          auto AddDofs = [&] (size_t patch)
+          {
+            for (auto d : dnums)
+              if (IsRegularDof(d) && (!freedofs || freedofs->Test(d)))
+                creator.Add(patch, d);
+          };
+          switch (patchtype)
+          {
+          case VERTEX_PATCH:
+            for (auto v : ngel.Vertices())
+              AddDofs(v);
+            break;
+          case EDGE_PATCH:
+            for (auto e : ngel.Edges())
+              if (edge_has_dofs[e])
+                AddDofs(e);
+            break;
+          case ELEMENT_PATCH:
+            AddDofs(elnrs[k]);
+            break;
+          }
+        }
+      });
+    Table<int> dofs_with_duplicates = creator.MoveTable();
+
+    // sort, remove duplicates and empty patches
+    Array<int> nunique(npatches);
+    ParallelFor (npatches, [&] (size_t i)
+    {
+      FlatArray<int> row = dofs_with_duplicates[i];
+      QuickSort (row);
+      int cnt = 0;
+      for (auto j : Range(row))
+        if (j == 0 || row[j] != row[j-1])
+          row[cnt++] = row[j];
+      nunique[i] = cnt;
+    });
+
+    Array<int> nonempty;
+    for (auto i : Range(npatches))
+      if (nunique[i] > 0)
+        nonempty.Append(i);
+    Array<int> blocksizes(nonempty.Size());
+    for (auto k : Range(nonempty))
+      blocksizes[k] = nunique[nonempty[k]];
+
+    auto blocks = make_shared<Table<int>>(blocksizes);
+    ParallelFor (nonempty.Size(), [&] (size_t k)
+    {
+      (*blocks)[k] = dofs_with_duplicates[nonempty[k]].Range(0, blocksizes[k]);
+    });
+    return blocks;
+  }
+
+  InterfaceCorrection :: InterfaceCorrection (shared_ptr<SparseMatrix<double>> amat,
+                                              shared_ptr<BitArray> adofs)
+  {
+    Update (amat, adofs);
+  }
+
+
+  void InterfaceCorrection :: ExtractSubMatrix ()
+  {
+    static Timer t("InterfaceCorrection::ExtractSubMatrix"); RegionTimer r(t);
+    size_t nsub = dofs.Size();
+    Array<int> elsperrow(nsub);
+    ParallelFor (nsub, [&] (size_t k)
+    {
+      int cnt = 0;
+      for (auto j : mat->GetRowIndices(dofs[k]))
+        if (subnr[j] != -1)
+          cnt++;
+      elsperrow[k] = cnt;
+    });
+    submat = make_shared<SparseMatrix<double>>(elsperrow, nsub);
+    ParallelFor (nsub, [&] (size_t k)
+    {
+      auto cols = mat->GetRowIndices(dofs[k]);
+      auto vals = mat->GetRowValues(dofs[k]);
+      for (auto j : Range(cols))
+        if (subnr[cols[j]] != -1)
+          (*submat)(k, subnr[cols[j]]) = vals(j);
+    });
+  }
+
+
+  bool InterfaceCorrection :: CopySubMatrixValues ()
+  {
+    static Timer t("InterfaceCorrection::CopySubMatrixValues"); RegionTimer r(t);
+    atomic<bool> samepattern(true);
+    ParallelFor (dofs.Size(), [&] (size_t k)
+    {
+      auto cols = mat->GetRowIndices(dofs[k]);
+      auto vals = mat->GetRowValues(dofs[k]);
+      auto subcols = submat->GetRowIndices(k);
+      auto subvals = submat->GetRowValues(k);
+      size_t pos = 0;
+      for (auto j : Range(cols))
+        if (subnr[cols[j]] != -1)
+        {
+          if (pos >= subcols.Size() || subcols[pos] != subnr[cols[j]])
+          {
+            samepattern = false;
+            return;
+          }
+          subvals(pos++) = vals(j);
+        }
+      if (pos != subcols.Size())
+        samepattern = false;
+    });
+    return samepattern;
+  }
+
+
+  bool InterfaceCorrection :: Update (shared_ptr<SparseMatrix<double>> amat,
+                                      shared_ptr<BitArray> adofs)
+  {
+    static Timer t("InterfaceCorrection::Update"); RegionTimer r(t);
+    mat = amat;
+    symmetric_storage = dynamic_cast<SparseMatrixSymmetric<double>*>(mat.get()) != nullptr;
+
+    Array<int> newdofs;
+    BitArrayToIndices(*adofs, newdofs);
+    bool samedofs = inv && subnr.Size() == mat->Height() && newdofs.Size() == dofs.Size();
+    if (samedofs)
+      for (auto k : Range(newdofs))
+        if (newdofs[k] != dofs[k])
+        {
+          samedofs = false;
+          break;
+        }
+
+    bool reuse = samedofs && CopySubMatrixValues();
+    if (!samedofs)
+    {
+      dofs = std::move(newdofs);
+      subnr.SetSize(mat->Height());
+      subnr = -1;
+      for (auto k : Range(dofs))
+        subnr[dofs[k]] = k;
+      res = make_shared<VVector<double>>(dofs.Size());
+      corr = make_shared<VVector<double>>(dofs.Size());
+    }
+    fullres = nullptr;
+    if (symmetric_storage)
+      fullres = make_shared<VVector<double>>(mat->Height());
+
+    if (dofs.Size() == 0)
+    {
+      submat = nullptr;
+      inv = nullptr;
+      return false;
+    }
+
+    if (reuse)
+      inv->FactorNew(*submat);
+    else
+    {
+      ExtractSubMatrix();
+      inv = make_shared<SparseCholesky<double>>(*submat, nullptr, nullptr, true);
+    }
+    return reuse;
+  }
+
+
+  void InterfaceCorrection :: Apply (BaseVector & u, const BaseVector & rhs) const
+  {
+    if (dofs.Size() == 0)
+      return;
+    static Timer t("InterfaceCorrection::Apply"); RegionTimer r(t);
+    FlatVector<> fu = u.FV<double>();
+    FlatVector<> fres = res->FV<double>();
+    FlatVector<> fcorr = corr->FV<double>();
+    if (symmetric_storage)
+    {
+      // (the rows of the upper part are not available)
+      *fullres = rhs - (*mat) * u;
+      FlatVector<> ffullres = fullres->FV<double>();
+      ParallelFor (dofs.Size(), [&] (size_t k)
+      {
+        fres(k) = ffullres(dofs[k]);
+      });
+    }
+    else
+    {
+      // residual on the interface rows only
+      FlatVector<> frhs = rhs.FV<double>();
+      ParallelFor (dofs.Size(), [&] (size_t k)
+      {
+        fres(k) = frhs(dofs[k]) - mat->RowTimesVector(dofs[k], fu);
+      });
+    }
+    *corr = (*inv) * (*res);
+    ParallelFor (dofs.Size(), [&] (size_t k)
+    {
+      fu(dofs[k]) += fcorr(k);
+    });
+  }
+
+
+  CutMultiGrid :: CutMultiGrid (const Array<shared_ptr<SparseMatrix<double>>> & amats,
+                                shared_ptr<Prolongation> aprol,
+                                const Array<shared_ptr<BitArray>> & afreedofs,
+                                const Array<shared_ptr<InterfaceCorrection>> & aifcorrections,
+                                const Array<shared_ptr<Table<int>>> & blocks,
+                                shared_ptr<BaseMatrix> acoarseinv,
+                                int anu,
+                                bool aifcorr_only_once)
+    : mats(amats), prol(aprol), freedofs(afreedofs), coarseinv(acoarseinv),
+      nu(anu), ifcorr_only_once(aifcorr_only_once), ifcorrections(aifcorrections)
+  {
+    static Timer t("CutMultiGrid::CutMultiGrid"); RegionTimer r(t);
+    int nlevels = mats.Size();
+    if (nlevels == 0)
+      throw Exception("CutMultiGrid: no matrices given");
+    if (freedofs.Size() != nlevels)
+      throw Exception("CutMultiGrid: need freedofs for every level");
+    if (ifcorrections.Size() == 0)
+    {
+      ifcorrections.SetSize(nlevels);
+      ifcorrections = nullptr;
+    }
+    if (ifcorrections.Size() != nlevels)
+      throw Exception("CutMultiGrid: need interface corrections for every level (or none)");
+    if (blocks.Size() != 0 && blocks.Size() != nlevels)
+      throw Exception("CutMultiGrid: need blocks for every level (or none)");
+
+    if (!coarseinv)
+      coarseinv = mats[0]->InverseMatrix(freedofs[0]);
+
+    pointsmoothers.SetSize(nlevels);
+    blocksmoothers.SetSize(nlevels);
+    defects.SetSize(nlevels);
+    corrections.SetSize(nlevels);
+    coarse_rhs.SetSize(nlevels);
+    coarse_sol.SetSize(nlevels);
+
+    for (int l = 0; l < nlevels; l++)
+    {
+      if (l == 0)
+        continue;
+
+      if (blocks.Size() > 0 && blocks[l])
+        blocksmoothers[l] = mats[l]->CreateBlockJacobiPrecond(blocks[l], nullptr, true, freedofs[l]);
+      else
+        pointsmoothers[l] = mats[l]->CreateJacobiPrecond(freedofs[l]);
+
+      size_t n = mats[l]->Height();
+      size_t nc = mats[l-1]->Height();
+      defects[l] = make_shared<VVector<double>>(n);
+      corrections[l] = make_shared<VVector<double>>(n);
+      coarse_rhs[l] = make_shared<S_BaseVectorPtr<double>>(nc, 1, defects[l]->Memory());
+      coarse_sol[l] = make_shared<S_BaseVectorPtr<double>>(nc, 1, corrections[l]->Memory());
+    }
+    multadd_tmp = make_shared<VVector<double>>(mats.Last()->Height());
+  }
+
+
+  void CutMultiGrid :: Smooth (int level, BaseVector & u, const BaseVector & rhs) const
+  {
+    for (int k = 0; k < nu; k++)
+    {
+      if (blocksmoothers[level])
+        blocksmoothers[level]->GSSmooth(u, rhs);
+      else
+        pointsmoothers[level]->GSSmooth(u, rhs);
+      if (ifcorrections[level] && (!ifcorr_only_once || k == nu-1))
+        ifcorrections[level]->Apply(u, rhs);
+    }
+  }
+
+
+  void CutMultiGrid :: SmoothBack (int level, BaseVector & u, const BaseVector & rhs) const
+  {
+    for (int k = nu-1; k >= 0; k--)
+    {
+      if (ifcorrections[level] && (!ifcorr_only_once || k == nu-1))
+        ifcorrections[level]->Apply(u, rhs);
+      if (blocksmoothers[level])
+        blocksmoothers[level]->GSSmoothBack(u, rhs);
+      else
+        pointsmoothers[level]->GSSmoothBack(u, rhs);
+    }
+  }
+
+
+  void CutMultiGrid :: MGLevel (int level, const BaseVector & rhs, BaseVector & u) const
+  {
+    if (level == 0)
+    {
+      u = (*coarseinv) * rhs;
+      return;
+    }
+
+    Smooth (level, u, rhs);
+
+    BaseVector & defect = *defects[level];
+    BaseVector & correction = *corrections[level];
+    defect = rhs - (*mats[level]) * u;
+    prol->RestrictInline (level, defect);
+    correction = 0.0;
+    MGLevel (level-1, *coarse_rhs[level], *coarse_sol[level]);
+    prol->ProlongateInline (level, correction);
+    u += correction;
+
+    SmoothBack (level, u, rhs);
+  }
+
+
+  void CutMultiGrid :: Mult (const BaseVector & b, BaseVector & x) const
+  {
+    static Timer t("CutMultiGrid::Mult"); RegionTimer r(t);
+    x = 0.0;
+    MGLevel (mats.Size()-1, b, x);
+  }
+
+
+  void CutMultiGrid :: MultAdd (double s, const BaseVector & b, BaseVector & x) const
+  {
+    Mult (b, *multadd_tmp);
+    x += s * *multadd_tmp;
+  }
+
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+/// from ngsolve
+#include <multigrid.hpp>
+
+namespace ngmg
+{
+
+  enum PATCH_TYPE { VERTEX_PATCH, EDGE_PATCH, ELEMENT_PATCH };
+
+  /// Blocks (for block smoothers) of the free dofs of all elements around a
+  /// vertex/edge (edges with dofs only) or of an element. Only elements in
+  /// 'elements' are considered if given (e.g. a band of cut elements). Every
+  /// block is sorted, empty blocks are skipped. Built in parallel.
+  shared_ptr<Table<int>> CreatePatchBlocks (shared_ptr<FESpace> fes,
+                                            PATCH_TYPE patchtype,
+                                            shared_ptr<BitArray> freedofs = nullptr,
+                                            shared_ptr<BitArray> elements = nullptr);
+
+  /* ----------------------------------------
+     Correction u += A_II^{-1} (f - A u)_I on
+     a subset I of the dofs (interface dofs).
+     A_II is extracted once and factorized
+     (sparse Cholesky). Update with a matrix
+     of the same pattern on I only copies the
+     values and refactorizes numerically.
+     ---------------------------------------- */
+  class InterfaceCorrection
+  {
+    shared_ptr<SparseMatrix<double>> mat;
+    bool symmetric_storage = false;
+    Array<int> dofs;            // subset -> full numbering (sorted)
+    Array<int> subnr;           // full -> subset numbering (-1 outside)
+    shared_ptr<SparseMatrix<double>> submat;
+    shared_ptr<SparseCholesky<double>> inv;
+    shared_ptr<BaseVector> res, corr;
+    shared_ptr<BaseVector> fullres;   // (only for symmetric storage)
+
+    void ExtractSubMatrix ();
+    // copies the values of mat into submat, false if the pattern differs
+    bool CopySubMatrixValues ();
+  public:
+    InterfaceCorrection (shared_ptr<SparseMatrix<double>> amat, shared_ptr<BitArray> adofs);
+    /// returns true if the factorization pattern could be reused
+    bool Update (shared_ptr<SparseMatrix<double>> amat, shared_ptr<BitArray> adofs);
+    void Apply (BaseVector & u, const BaseVector & rhs) const;
+    size_t Size () const { return dofs.Size(); }
+  };
+
+  /* ----------------------------------------
+     Multigrid V-cycle for (cut) finite element
+     spaces (C++ version of MultiGridCL,
+     CutFemSmoother in python/cutmg.py):
+     Gauss-Seidel (block-)smoothers, an
+     interface correction with a factorization
+     of the matrix on the interface dofs and
+     preallocated vectors on every level.
+     ---------------------------------------- */
+  class CutMultiGrid : public BaseMatrix
+  {
+    /// level matrices (coarsest to finest)
+    Array<shared_ptr<SparseMatrix<double>>> mats;
+    shared_ptr<Prolongation> prol;
+    Array<shared_ptr<BitArray>> freedofs;
+    shared_ptr<BaseMatrix> coarseinv;
+    int nu;
+    bool ifcorr_only_once;
+
+    /// per level either a point or a block Gauss-Seidel smoother
+    Array<shared_ptr<BaseJacobiPrecond>> pointsmoothers;
+    Array<shared_ptr<BaseBlockJacobiPrecond>> blocksmoothers;
+
+    /// interface correction per level (nullptr: no correction)
+    Array<shared_ptr<InterfaceCorrection>> ifcorrections;
+
+    /// defect (restricted in place) and correction (prolongated in place) of a
+    /// level and the views on their first entries, i.e. the next coarser level
+    Array<shared_ptr<BaseVector>> defects, corrections;
+    Array<shared_ptr<BaseVector>> coarse_rhs, coarse_sol;
+    /// result of Mult in MultAdd (finest level)
+    shared_ptr<BaseVector> multadd_tmp;
+
+    void MGLevel (int level, const BaseVector & rhs, BaseVector & u) const;
+    void Smooth (int level, BaseVector & u, const BaseVector & rhs) const;
+    void SmoothBack (int level, BaseVector & u, const BaseVector & rhs) const;
+  public:
+    CutMultiGrid (const Array<shared_ptr<SparseMatrix<double>>> & amats,
+                  shared_ptr<Prolongation> aprol,
+                  const Array<shared_ptr<BitArray>> & afreedofs,
+                  const Array<shared_ptr<InterfaceCorrection>> & aifcorrections,
+                  const Array<shared_ptr<Table<int>>> & blocks,
+                  shared_ptr<BaseMatrix> acoarseinv,
+                  int anu = 2,
+                  bool aifcorr_only_once = true);
+
+    virtual ~CutMultiGrid () { ; }
+
+    virtual bool IsComplex () const override { return false; }
+    virtual int VHeight () const override { return mats.Last()->Height(); }
+    virtual int VWidth () const override { return mats.Last()->Width(); }
+    virtual AutoVector CreateVector () const override { return mats.Last()->CreateVector(); }
+    virtual AutoVector CreateRowVector () const override { return mats.Last()->CreateRowVector(); }
+    virtual AutoVector CreateColVector () const override { return mats.Last()->CreateColVector(); }
+
+    virtual void Mult (const BaseVector & b, BaseVector & x) const override;
+    virtual void MultAdd (double s, const BaseVector & b, BaseVector & x) const override;
+
+    int GetNLevels () const { return mats.Size(); }
+  };
+
+}
@@ -29,3 +29,91 @@ void IterateRange (int ne, LocalHeap & clh,
     }
   }
 }
+
+void IterateIndices (FlatArray<int> indices, LocalHeap & clh,
+                     const function<void(int,LocalHeap&)> & func)
+{
+  IterateRange (indices.Size(), clh,
+                [&] (int i, LocalHeap & lh)
+  {
+    func (indices[i], lh);
+  });
+}
+
+void BitArrayToIndices (const BitArray & ba, Array<int> & indices)
+{
+  // count per block, prefix sum, fill per block
+  constexpr size_t BS = 4096;
+  const size_t n = ba.Size();
+  const size_t nblocks = (n + BS - 1) / BS;
+  Array<int> first(nblocks+1);
+  ParallelFor (nblocks, [&] (size_t b)
+  {
+    int cnt = 0;
+    for (size_t i = b*BS; i < min2((b+1)*BS, n); i++)
+      if (ba.Test(i))
+        cnt++;
+    first[b+1] = cnt;
+  });
+  first[0] = 0;
+  for (size_t b = 0; b < nblocks; b++)
+    first[b+1] += first[b];
+
+  indices.SetSize(first[nblocks]);
+  ParallelFor (nblocks, [&] (size_t b)
+  {
+    int pos = first[b];
+    for (size_t i = b*BS; i < min2((b+1)*BS, n); i++)
+      if (ba.Test(i))
+        indices[pos++] = i;
+  });
+}
+
+template <int D>
+bool GetAffineElementMap (const ngfem::ElementTransformation & trafo, Mat<D,D> & A, Vec<D> & c)
+{
+  using namespace ngfem;
+  ELEMENT_TYPE et = trafo.GetElementType();
+  if (trafo.IsCurvedElement() || !(et == ET_TRIG || et == ET_TET) || ElementTopology::GetSpaceDim(et) != D)
+    return false;
+
+  IntegrationPoint ip0(0.,0.,0.);
+  MappedIntegrationPoint<D,D> mip0(ip0, trafo);
+  c = mip0.GetPoint();
+  for (int d = 0; d < D; d++)
+  {
+    IntegrationPoint ipd(0.,0.,0.);
+    ipd.Point()[d] = 1.;
+    MappedIntegrationPoint<D,D> mipd(ipd, trafo);
+    A.Col(d) = mipd.GetPoint() - c;
+  }
+
+  double ref = 0;
+  for (int i = 0; i < D; i++)
+    for (int j = 0; j < D; j++)
+      ref = max2(ref, abs(A(i,j)));
+  auto jacobian_is_A = [&] (const IntegrationPoint & ip)
+  {
+    MappedIntegrationPoint<D,D> mip(ip, trafo);
+    Mat<D,D> jac = mip.GetJacobian();
+    double diff = 0;
+    for (int i = 0; i < D; i++)
+      for (int j = 0; j < D; j++)
+        diff = max2(diff, abs(jac(i,j)-A(i,j)));
+    return diff <= 1e-12 * ref;
+  };
+
+  // a quadratic deformation which is symmetric in the barycentric coordinates has the Jacobian A
+  // in the barycenter, but not in the vertices
+  for (int v = 0; v < D+1; v++)
+  {
+    const double * p = ElementTopology::GetVertices(et)[v];
+    if (!jacobian_is_A(IntegrationPoint(p[0], p[1], p[2])))
+      return false;
+  }
+  const double bary = 1.0/(D+1);
+  return jacobian_is_A(IntegrationPoint(bary, bary, D==3 ? bary : 0.));
+}
+
+template bool GetAffineElementMap<2> (const ngfem::ElementTransformation & trafo, Mat<2,2> & A, Vec<2> & c);
+template bool GetAffineElementMap<3> (const ngfem::ElementTransformation & trafo, Mat<3,3> & A, Vec<3> & c);
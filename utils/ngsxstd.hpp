@@ -79,3 +79,24 @@ INLINE DOMAIN_TYPE INVERT( DOMAIN_TYPE dt)
 
 
 void IterateRange (int ne, LocalHeap & clh, const function<void(int,LocalHeap&)> & func);
+
+// IterateRange over the entries of indices, func is called with indices[i]
+void IterateIndices (FlatArray<int> indices, LocalHeap & clh, const function<void(int,LocalHeap&)> & func);
+
+// sorted list of the set bits of ba (built in parallel)
+void BitArrayToIndices (const BitArray & ba, Array<int> & indices);
+
+// affine map xhat -> A xhat + c of a straight simplex element (TRIG/TET). Returns false if the
+// transformation is not affine: curved elements, non-simplices and deformed elements (which may
+// not report to be curved). For the latter the Jacobian is compared with A in all vertices and in
+// the barycenter.
+template <int D>
+bool GetAffineElementMap (const ngfem::ElementTransformation & trafo, Mat<D,D> & A, Vec<D> & c);
+
+template <int D>
+INLINE bool IsAffineElement (const ngfem::ElementTransformation & trafo)
+{
+  Mat<D,D> A;
+  Vec<D> c;
+  return GetAffineElementMap<D> (trafo, A, c);
+}
@@ -5,6 +5,7 @@
 /*********************************************************************/
 
 #include "p1interpol.hpp"
+#include "../utils/ngsxstd.hpp"
 
 namespace ngcomp
 {
@@ -28,71 +29,103 @@ namespace ngcomp
     RegionTimer reg (time_fct);
 
     int nv=ma->GetNV();
-    gf_p1->GetVector() = 0.0;
+    int ne=ma->GetNE(VOL);
+    auto fes_p1 = gf_p1->GetFESpace();
+    FlatVector<> vec_p1 = gf_p1->GetVector().FVDouble();
+    vec_p1 = 0.0;
 
-    for (int vnr = 0; vnr < nv; ++vnr)
+    // avoid vertex cuts by introducing a small perturbation:
+    auto SetVertexValue = [&] (int vnr, double val)
     {
-      HeapReset hr(lh);
+      ArrayMem<int,1> dof;
+      fes_p1->GetVertexDofNrs(vnr,dof);
+      if (abs(val) < eps_perturbation)
+        val = eps_perturbation;
+      if (dof.Size() > 0 && dof[0] != -1)
+        vec_p1(dof[0]) = val;
+    };
 
-      double val_lset;
-      if (coef)
+    if (!coef)
+    {
+      auto fes = gf->GetFESpace();
+      FlatVector<> vec = gf->GetVector().FVDouble();
+      ParallelFor (nv, [&] (size_t vnr)
       {
-        Array<int> elnums;
-        ma -> GetVertexElements (vnr, elnums);
-        Ngs_Element ngel = ma -> GetElement (ElementId(VOL,elnums[0]));
-        auto & eltrans = ma -> GetTrafo (ngel, lh);
+        ArrayMem<int,1> dof;
+        fes->GetDofNrs(NodeId(NT_VERTEX,vnr), dof);
+        SetVertexValue (vnr, vec(dof[0]));
+      });
+      return;
+    }
 
-        if( ma -> GetDimension() == 2)
+    // every vertex is written once, by the element with the smallest number
+    Array<int> owner(nv);
+    owner = ne;
+    ParallelFor (ne, [&] (size_t elnr)
+    {
+      for (auto v : ma->GetElement(ElementId(VOL,elnr)).Vertices())
+      {
+        auto & own = AsAtomic(owner[v]);
+        int cur = own.load(memory_order_relaxed);
+        while (int(elnr) < cur && !own.compare_exchange_weak(cur, int(elnr)))
+          ;
+      }
+    });
+
+    atomic<bool> simd_evaluate(true);
+    IterateRange (ne, lh, [&] (int elnr, LocalHeap & lh)
+    {
+      ElementId ei(VOL,elnr);
+      Ngs_Element ngel = ma->GetElement(ei);
+      auto verts = ngel.Vertices();
+      bool owns_vertex = false;
+      for (auto v : verts)
+        if (owner[v] == elnr)
+          owns_vertex = true;
+      if (!owns_vertex)
+        return;
+
+      // the element vertices on the reference element
+      // In the space-time case, we set Weight = t to zero, since in the SpaceTimeInterpolateToP1 function told is varied...
+      // ... therefore time = 0 is the consistent choice.
+      const POINT3D * refverts = ElementTopology::GetVertices(ngel.GetType());
+      IntegrationRule ir(verts.Size(), lh);
+      for (auto k : Range(verts))
+        ir[k] = IntegrationPoint(refverts[k][0], refverts[k][1], refverts[k][2], 0.0);
+      auto & eltrans = ma->GetTrafo (ei, lh);
+
+      FlatVector<> vals(verts.Size(), lh);
+      bool done = false;
+      if (simd_evaluate)
+      {
+        try
         {
-          Vec<2> point;
-          ma->GetPoint<2>(vnr,point);
-          IntegrationPoint ip(0,0,0,0);
-          MappedIntegrationPoint<2,2> mip(ip,eltrans);
-          Vec<2> refpoint = mip.GetJacobianInverse() * (point - mip.GetPoint());
-          IntegrationPoint ip_f(refpoint[0],refpoint[1],0.0,0.0);
-          //In the space-time case, we set Weight = t to zero, since in the SpaceTimeInterpolateToP1 function told is varied...
-          //... therefore time = 0 is the consistent choice.
-          //ip_f.SetPrecomputedGeometry(true);
-          MappedIntegrationPoint<2,2> mip_f(ip_f,eltrans);
-          val_lset = coef->Evaluate(mip_f);
+          SIMD_IntegrationRule simd_ir(ir, lh);
+          auto & simd_mir = eltrans(simd_ir, lh);
+          FlatMatrix<SIMD<double>> simd_vals(1, simd_ir.Size(), lh);
+          coef->Evaluate(simd_mir, simd_vals);
+          FlatVector<> flat_vals(simd_ir.Size()*SIMD<double>::Size(),
+                                  reinterpret_cast<double*>(&simd_vals(0,0)));
+          vals = flat_vals.Range(0, verts.Size());
+          done = true;
         }
-        else if ( ma -> GetDimension() == 3)
+        catch (ExceptionNOSIMD e)
         {
-          Vec<3> point;
-          ma->GetPoint<3>(vnr,point);
-          IntegrationPoint ip(0,0,0,0);
-          MappedIntegrationPoint<3,3> mip(ip,eltrans);
-          Vec<3> refpoint = mip.GetJacobianInverse() * (point - mip.GetPoint());
-          IntegrationPoint ip_f(refpoint,0.0);
-          //In the space-time case, we set Weight = t to zero, since in the SpaceTimeInterpolateToP1 function told is varied...
-          //... therefore time = 0 is the consistent choice.
-          //ip_f.SetPrecomputedGeometry(true);
-          MappedIntegrationPoint<3,3> mip_f(ip_f,eltrans);
-          val_lset = coef->Evaluate(mip_f);
+          simd_evaluate = false;
         }
-        else
-          throw Exception ("D==0,D==1 not yet implemnted");
       }
-      else
+      if (!done)
       {
-        Array<int> dof;
-        // gf->GetFESpace()->GetVertexDofNrs(vnr, dof);
-        gf->GetFESpace()->GetDofNrs(NodeId(NT_VERTEX,vnr), dof); //vnr, dof);
-        FlatVector<> fval(1,&val_lset);
-        gf->GetVector().GetIndirect(dof,fval);
+        auto & mir = eltrans(ir, lh);
+        FlatMatrix<> mvals(verts.Size(), 1, lh);
+        coef->Evaluate(mir, mvals);
+        vals = mvals.Col(0);
       }
 
-      Array<int> dof;
-      gf_p1->GetFESpace()->GetVertexDofNrs(vnr,dof);
-      FlatVector<> val(1,&val_lset);
-      // avoid vertex cuts by introducing a small perturbation:
-      if (abs(val(0)) < eps_perturbation)
-        val(0) = eps_perturbation;
-      if (dof[0] != -1)
-        gf_p1->GetVector().SetIndirect(dof,val);
-    }
-
-
+      for (auto k : Range(verts))
+        if (owner[verts[k]] == elnr)
+          SetVertexValue (verts[k], vals(k));
+    });
   }
 
 }
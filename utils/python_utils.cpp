@@ -9,6 +9,7 @@
 #include "../utils/restrictedblf.hpp"
 #include "../utils/p1interpol.hpp"
 #include "../utils/xprolongation.hpp"
+#include "../utils/cutmultigrid.hpp"
 
 using namespace ngcomp;
 
@@ -21,7 +22,7 @@ void ExportNgsx_utils(py::module &m)
   m.def("InterpolateToP1",  [] (PyGF gf_ho, PyGF gf_p1, double eps_perturbation, int heapsize)
         {
           InterpolateP1 interpol(gf_ho, gf_p1);
-          LocalHeap lh (heapsize, "InterpolateP1-Heap");
+          LocalHeap lh (heapsize, "InterpolateP1-Heap", true);
           interpol.Do(lh,eps_perturbation);
         } ,
         py::arg("gf_ho")=NULL,py::arg("gf_p1")=NULL,
@@ -52,7 +53,7 @@ heapsize : int
   m.def("InterpolateToP1",  [] (PyCF coef, PyGF gf_p1, double eps_perturbation, int heapsize)
         {
           InterpolateP1 interpol(coef, gf_p1);
-          LocalHeap lh (heapsize, "InterpolateP1-Heap");
+          LocalHeap lh (heapsize, "InterpolateP1-Heap", true);
           interpol.Do(lh,eps_perturbation);
         } ,
         py::arg("coef"),py::arg("gf"),
@@ -83,6 +84,38 @@ heapsize : int
   
   typedef shared_ptr<BitArray> PyBA;
 
+  py::class_<RestrictedBilinearForm, shared_ptr<RestrictedBilinearForm>, BilinearForm>
+    (m, "RestrictedBilinearFormType",R"raw(
+Bilinear form that is set up by RestrictedBilinearForm(...), see there.
+)raw")
+    .def_property_readonly("compressed", &RestrictedBilinearForm::IsCompressed,
+                           "is the matrix set up in the compressed numbering of the active dofs")
+    .def_property_readonly("nactive", &RestrictedBilinearForm::GetNActiveDofs,
+                           "number of active dofs (only for compress=True)")
+    .def_property_readonly("graph_reused", &RestrictedBilinearForm::GraphReused,
+                           "did the last (re)allocation reuse the matrix graph (only for reuse_graph=True)")
+    .def("Embedding", [](RestrictedBilinearForm & self)
+         {
+           return self.CreateEmbedding();
+         },docu_string(R"raw_string(
+Returns the sparse embedding matrix E (ndof x nactive) from the compressed numbering of the active
+dofs into the numbering of the finite element space (only for compress=True). Vectors of the full
+space are restricted with E.T, e.g. 
+
+  f_c.data = E.T * f.vec
+  u_c.data = a.mat.Inverse(a.CompressBitArray(V.FreeDofs())) * f_c
+  gfu.vec.data = E * u_c
+)raw_string"))
+    .def("CompressBitArray", [](RestrictedBilinearForm & self, PyBA ba)
+         {
+           return self.CompressBitArray(*ba);
+         },
+         py::arg("ba"),docu_string(R"raw_string(
+Restricts a BitArray of the finite element space (e.g. FreeDofs) to the compressed numbering of the
+active dofs (only for compress=True).
+)raw_string"))
+    ;
+
   m.def("RestrictedBilinearForm",
         [](shared_ptr<FESpace> fes,
            const string & aname,
@@ -149,7 +182,59 @@ check_unused : boolean
   Check if some degrees of freedoms are not considered during assembly
 
 flags : ngsolve.Flags
-  additional bilinear form flags
+  additional bilinear form flags. With "reuse_graph" : True the matrix of the previous assembly is
+  kept when the restriction BitArrays are changed (in place) and Assemble(reallocate=True) is
+  called: If the couplings of all elements/facets that entered the restrictions are already in
+  the matrix graph, no new graph and matrix are set up. Entries of elements/facets that left the
+  restriction stay in the graph (as zeros) until they make up more than 25% of the active ones.
+  With "compress" : True only the dofs of the elements in element_restriction (and of the
+  couplings of the facets in facet_restriction) are rows/columns of the matrix. The matrix is set
+  up in this compressed numbering, see Embedding() and CompressBitArray() for the transfer to the
+  full space. This can not be combined with "eliminate_internal".
+)raw_string"));
+
+  m.def("RestrictedLinearForm",
+        [](shared_ptr<FESpace> fes,
+           const string & aname,
+           py::object ael_restriction,
+           py::dict bpflags)
+        {
+          Flags flags = py::extract<Flags> (bpflags)();
+
+          shared_ptr<BitArray> el_restriction = nullptr;
+          if (py::extract<PyBA> (ael_restriction).check())
+            el_restriction = py::extract<PyBA>(ael_restriction)();
+
+          if (fes->IsComplex())
+            throw Exception("RestrictedLinearForm not implemented for complex fespace");
+
+          shared_ptr<LinearForm> lf = make_shared<RestrictedLinearForm> (fes, aname, el_restriction, flags);
+          return lf;
+        },
+        py::arg("space"),
+        py::arg("name") = "lff",
+        py::arg("element_restriction") = DummyArgument(),
+        py::arg("flags") = py::dict(),
+        docu_string(R"raw_string(
+A restricted linear form is a (so far real-valued) linear form that is only assembled on the
+elements marked in a BitArray. Elements outside the restriction are not visited at all (in
+particular no cut integration rules are generated there). Integrators on boundary elements are
+assembled on all boundary elements. If the form contains skeleton integrators the standard
+assembly is used.
+
+Parameters
+
+space : ngsolve.FESpace
+  finite element space on which the linear form is defined.
+
+name : string
+  name of the linear form
+
+element_restriction : ngsolve.BitArray
+  BitArray defining the 'active mesh' element-wise
+
+flags : ngsolve.Flags
+  additional linear form flags
 )raw_string"));
 
   m.def("CompoundBitArray",
@@ -209,9 +294,10 @@ Similar functionality (also for facets) can be obtained with IndicatorCF.
     (m, "P1Prolongation",
         docu_string(R"raw_string(
 Prolongation for P1-type spaces (with possibly inactive dofs) --- 
-As is asks the fespace for dofs to vertices at several occasions the 
-current implementation is not very fast and should be primarily used
-for prototype and testing...
+The vertex-to-dof maps and the parent vertices are stored in Update,
+prolongation and restriction run in parallel. Vectors with block entries
+(dim>1) and lists of vectors (prolongated/restricted in one sweep) are
+supported.
 )raw_string"))
     .def("__init__",
          [](P1Prolongation *instance, shared_ptr<MeshAccess> ma)
@@ -225,7 +311,47 @@ for prototype and testing...
            p1p -> Update(*fes);
          },
          py::arg("space")
-      );
+      )
+    .def("Prolongate",
+         [](shared_ptr<P1Prolongation> p1p, int finelevel, BaseVector & vec)
+         {
+           p1p -> ProlongateInline(finelevel, vec);
+         },
+         py::arg("finelevel"), py::arg("vec"))
+    .def("Prolongate",
+         [](shared_ptr<P1Prolongation> p1p, int finelevel, py::list vecs)
+         {
+           Array<shared_ptr<BaseVector>> avecs;
+           for (auto v : vecs)
+             avecs.Append(py::cast<shared_ptr<BaseVector>>(v));
+           p1p -> ProlongateInline(finelevel, avecs);
+         },
+         py::arg("finelevel"), py::arg("vecs"))
+    .def("Restrict",
+         [](shared_ptr<P1Prolongation> p1p, int finelevel, BaseVector & vec)
+         {
+           p1p -> RestrictInline(finelevel, vec);
+         },
+         py::arg("finelevel"), py::arg("vec"))
+    .def("Restrict",
+         [](shared_ptr<P1Prolongation> p1p, int finelevel, py::list vecs)
+         {
+           Array<shared_ptr<BaseVector>> avecs;
+           for (auto v : vecs)
+             avecs.Append(py::cast<shared_ptr<BaseVector>>(v));
+           p1p -> RestrictInline(finelevel, avecs);
+         },
+         py::arg("finelevel"), py::arg("vecs"))
+    .def("CreateMatrix",
+         [](shared_ptr<P1Prolongation> prol, int finelevel)
+         {
+           return shared_ptr<SparseMatrix<double>>(prol -> CreateProlongationMatrix(finelevel));
+         },
+         py::arg("finelevel"),
+         docu_string(R"raw_string(
+Creates the prolongation matrix (ndof fine level x ndof coarse level)
+from level finelevel-1 to finelevel. Inactive dofs have no entries.
+)raw_string"));
 
       typedef shared_ptr<P2Prolongation> PyP2P;
   py::class_<P2Prolongation, PyP2P, Prolongation>
@@ -247,8 +373,17 @@ for prototype and testing...
          {
            p2p -> Update(*fes);
          },
-         py::arg("space")
-      );
+         py::arg("space"))
+    .def("CreateMatrix",
+         [](shared_ptr<P2Prolongation> prol, int finelevel)
+         {
+           return shared_ptr<SparseMatrix<double>>(prol -> CreateProlongationMatrix(finelevel));
+         },
+         py::arg("finelevel"),
+         docu_string(R"raw_string(
+Creates the prolongation matrix (ndof fine level x ndof coarse level)
+from level finelevel-1 to finelevel. Inactive dofs have no entries.
+)raw_string"));
 
 
       typedef shared_ptr<P2CutProlongation> PyP2CutP;
@@ -271,8 +406,35 @@ for prototype and testing...
          {
            p2p -> Update(*fes);
          },
-         py::arg("space")
-      );
+         py::arg("space"))
+    .def("CreateMatrix",
+         [](shared_ptr<P2CutProlongation> prol, int finelevel)
+         {
+           return shared_ptr<SparseMatrix<double>>(prol -> CreateProlongationMatrix(finelevel));
+         },
+         py::arg("finelevel"),
+         docu_string(R"raw_string(
+Creates the prolongation matrix (ndof fine level x ndof coarse level)
+from level finelevel-1 to finelevel. Inactive dofs have no entries.
+)raw_string"));
+
+  m.def("GalerkinProjection",
+        [](shared_ptr<SparseMatrix<double>> A, shared_ptr<SparseMatrix<double>> P)
+        {
+          return GalerkinProjection(*A, *P);
+        },
+        py::arg("mat"), py::arg("prol"),
+        docu_string(R"raw_string(
+Computes the Galerkin (coarse grid) matrix P^T A P in parallel.
+
+Parameters
+
+mat : ngsolve.la.SparseMatrixd
+  (fine) matrix A, non-symmetric storage
+
+prol : ngsolve.la.SparseMatrixd
+  prolongation matrix P, e.g. from P1Prolongation.CreateMatrix
+)raw_string"));
 
     typedef shared_ptr<CompoundProlongation> PyCProl;
     py::class_< CompoundProlongation, PyCProl, Prolongation>
@@ -292,5 +454,220 @@ for prototype and testing...
           );
       //.def ("AddProlongation" &CompoundProlongation::AddProlongation, py::arg("prol"));
 
+  auto ToPatchType = [](const string & patchtype)
+    {
+      if (patchtype == "vert" || patchtype == "vertex")
+        return VERTEX_PATCH;
+      else if (patchtype == "edge")
+        return EDGE_PATCH;
+      else if (patchtype == "elem" || patchtype == "element")
+        return ELEMENT_PATCH;
+      else
+        throw Exception("Unknown patchtype "+patchtype+", choose between 'edge', 'vert' and 'elem'");
+    };
+
+  m.def("PatchBlocks",
+        [ToPatchType](shared_ptr<FESpace> fes, const string & patchtype, PyBA freedofs, PyBA elements)
+        {
+          auto table = CreatePatchBlocks(fes, ToPatchType(patchtype), freedofs, elements);
+          py::list blocks;
+          for (auto i : Range(table->Size()))
+          {
+            py::set block;
+            for (auto d : (*table)[i])
+              block.add(py::cast(d));
+            blocks.append(block);
+          }
+          return blocks;
+        },
+        py::arg("space"), py::arg("patchtype")="vert", py::arg("freedofs")=nullptr,
+        py::arg("elements")=nullptr,
+        docu_string(R"raw_string(
+Builds (in C++, in parallel) the blocks of dofs for block smoothers, e.g. for
+CreateBlockSmoother or CutMultiGrid. A block consists of the free dofs of all
+elements around a vertex ('vert'), around an edge that has dofs ('edge') or of
+one element ('elem'). Returns a list of sets, empty blocks are skipped.
+
+Parameters
+
+space : ngsolve.FESpace
+  finite element space
+
+patchtype : str
+  'vert', 'edge' or 'elem'
+
+freedofs : ngsolve.BitArray
+  dofs that are used (default: FreeDofs of the space)
+
+elements : ngsolve.BitArray
+  only elements marked here are used (e.g. a band of elements from a CutInfo), all
+  elements if None
+)raw_string"));
+
+  m.def("PatchBlockSmoother",
+        [ToPatchType](shared_ptr<BaseMatrix> mat, shared_ptr<FESpace> fes, const string & patchtype,
+                      PyBA freedofs, PyBA elements, bool parallel) -> shared_ptr<BaseMatrix>
+        {
+          auto spmat = dynamic_pointer_cast<BaseSparseMatrix>(mat);
+          if (!spmat)
+            throw Exception("PatchBlockSmoother: need a sparse matrix");
+          auto table = CreatePatchBlocks(fes, ToPatchType(patchtype), freedofs, elements);
+          return spmat->CreateBlockJacobiPrecond(table, nullptr, parallel, freedofs);
+        },
+        py::arg("mat"), py::arg("space"), py::arg("patchtype")="vert", py::arg("freedofs")=nullptr,
+        py::arg("elements")=nullptr, py::arg("parallel")=true,
+        docu_string(R"raw_string(
+Block (Gauss-Seidel/Jacobi) smoother of the matrix with the blocks of PatchBlocks(...).
+The blocks are passed on in C++ without the detour over python sets. Same arguments as
+PatchBlocks (plus the matrix mat and the flag parallel).
+)raw_string"));
+
+  py::class_<InterfaceCorrection, shared_ptr<InterfaceCorrection>>
+    (m, "InterfaceCorrection",
+     docu_string(R"raw_string(
+Correction u += A_II^{-1} (f - A u)_I on a subset I of the dofs, e.g. the (free) interface dofs,
+as used in the smoothers of the cut multigrid methods. The submatrix A_II is extracted once
+and factorized (sparsecholesky). The residual is only computed on the rows of I.
+
+Parameters
+
+mat : ngsolve.la.SparseMatrixd
+  matrix A
+
+dofs : ngsolve.BitArray
+  the subset I
+)raw_string"))
+    .def("__init__",
+         [](InterfaceCorrection *instance, shared_ptr<BaseMatrix> mat, PyBA dofs)
+         {
+           auto spmat = dynamic_pointer_cast<SparseMatrix<double>>(mat);
+           if (!spmat)
+             throw Exception("InterfaceCorrection: need a real sparse matrix");
+           new (instance) InterfaceCorrection (spmat, dofs);
+         },
+         py::arg("mat"), py::arg("dofs"))
+    .def("Update",
+         [](InterfaceCorrection & self, shared_ptr<BaseMatrix> mat, PyBA dofs)
+         {
+           auto spmat = dynamic_pointer_cast<SparseMatrix<double>>(mat);
+           if (!spmat)
+             throw Exception("InterfaceCorrection: need a real sparse matrix");
+           return self.Update(spmat, dofs);
+         },
+         py::arg("mat"), py::arg("dofs"),
+         docu_string(R"raw_string(
+Updates the correction for a new matrix (e.g. in the next time step). If the subset and the
+pattern of A_II are unchanged, only the values are copied and the factorization is redone
+numerically (the symbolic factorization is reused). Returns True in this case.
+)raw_string"))
+    .def("Apply", &InterfaceCorrection::Apply, py::arg("u"), py::arg("rhs"),
+         "u += A_II^{-1} (rhs - A u)_I")
+    .def_property_readonly("ndof", &InterfaceCorrection::Size, "size of the subset")
+    ;
+
+  py::class_<CutMultiGrid, shared_ptr<CutMultiGrid>, BaseMatrix>
+    (m, "CutMultiGrid",
+     docu_string(R"raw_string(
+Multigrid V-cycle (as a preconditioner) for (cut) finite element spaces, the C++ version of
+MultiGridCL with CutFemSmoother from xfem.cutmg. Vectors of all levels are allocated once.
+On every level but the coarsest, nu (block) Gauss-Seidel steps are applied before and
+(backwards) after the coarse grid correction. If interface dofs are given, a correction with a
+factorization (sparsecholesky) of the matrix on the interface dofs follows the smoothing
+steps. Its residual is only computed on the interface rows.
+
+Parameters
+
+matrices : list of ngsolve.la.SparseMatrixd
+  matrices of all levels (coarsest to finest)
+
+prol : ngsolve.Prolongation
+  prolongation between the levels, e.g. P1Prolongation, CompoundProlongation
+
+freedofs : list of ngsolve.BitArray
+  free dofs of all levels
+
+ifdofs : list of ngsolve.BitArray or InterfaceCorrection
+  interface dofs (restricted to the free dofs here) or interface corrections of all levels
+  (entries may be None), no interface correction if None
+
+blocks : list
+  blocks (list of sets of dofs) for block Gauss-Seidel of all levels (entries may be None
+  for point Gauss-Seidel), point Gauss-Seidel on all levels if None
+
+coarsegridsolver : ngsolve.BaseMatrix
+  inverse of the coarsest matrix, (sparse) direct solver on freedofs[0] if None
+
+nu : int
+  number of smoothing steps
+
+ifcorr_only_once : bool
+  apply the interface correction only once (after the last/before the first smoothing step)
+)raw_string"))
+    .def("__init__",
+         [](CutMultiGrid *instance, py::list pymats, shared_ptr<Prolongation> prol,
+            py::list pyfreedofs, py::object pyifdofs, py::object pyblocks,
+            shared_ptr<BaseMatrix> coarseinv, int nu, bool ifcorr_only_once)
+         {
+           Array<shared_ptr<SparseMatrix<double>>> mats;
+           for (auto pymat : pymats)
+           {
+             auto mat = dynamic_pointer_cast<SparseMatrix<double>>(py::cast<shared_ptr<BaseMatrix>>(pymat));
+             if (!mat)
+               throw Exception("CutMultiGrid: matrices have to be real sparse matrices");
+             mats.Append(mat);
+           }
+           Array<shared_ptr<BitArray>> freedofs;
+           for (auto fd : pyfreedofs)
+             freedofs.Append(py::cast<PyBA>(fd));
+           Array<shared_ptr<InterfaceCorrection>> ifcorrections;
+           if (!pyifdofs.is_none())
+             for (auto ifd : pyifdofs)
+             {
+               size_t l = ifcorrections.Size();
+               if (ifd.is_none())
+                 ifcorrections.Append(nullptr);
+               else if (py::isinstance<InterfaceCorrection>(ifd))
+                 ifcorrections.Append(py::cast<shared_ptr<InterfaceCorrection>>(ifd));
+               else
+               {
+                 if (l >= mats.Size() || l >= freedofs.Size())
+                   throw Exception("CutMultiGrid: more interface dofs than levels");
+                 auto ba = make_shared<BitArray>(*py::cast<PyBA>(ifd));
+                 ba->And(*freedofs[l]);
+                 ifcorrections.Append(make_shared<InterfaceCorrection>(mats[l], ba));
+               }
+             }
+           Array<shared_ptr<Table<int>>> blocks;
+           if (!pyblocks.is_none())
+             for (auto pyblock : pyblocks)
+             {
+               if (pyblock.is_none())
+               {
+                 blocks.Append(nullptr);
+                 continue;
+               }
+               TableCreator<int> creator(py::len(pyblock));
+               for ( ; !creator.Done(); creator++)
+               {
+                 size_t i = 0;
+                 for (auto block : pyblock)
+                 {
+                   for (auto d : block)
+                     creator.Add(i, py::cast<int>(d));
+                   i++;
+                 }
+               }
+               blocks.Append(make_shared<Table<int>>(creator.MoveTable()));
+             }
+           new (instance) CutMultiGrid (mats, prol, freedofs, ifcorrections, blocks, coarseinv,
+                                        nu, ifcorr_only_once);
+         },
+         py::arg("matrices"), py::arg("prol"), py::arg("freedofs"),
+         py::arg("ifdofs")=py::none(), py::arg("blocks")=py::none(),
+         py::arg("coarsegridsolver")=nullptr, py::arg("nu")=2,
+         py::arg("ifcorr_only_once")=true)
+    .def_property_readonly("nlevels", &CutMultiGrid::GetNLevels, "number of levels")
+    ;
+
 
 }
@@ -1,9 +1,22 @@
 #include "restrictedblf.hpp"
+#include "ngsxstd.hpp"
 #include <comp.hpp>
 
 namespace ngcomp
 {
 
+  // numbers of the set bits of a restriction, 0..n-1 without restriction
+  static void RestrictionToIndices (shared_ptr<BitArray> restriction, size_t n, Array<int> & indices)
+  {
+    if (restriction)
+      BitArrayToIndices(*restriction, indices);
+    else
+    {
+      indices.SetSize(n);
+      ParallelFor (n, [&] (size_t i) { indices[i] = i; });
+    }
+  }
+
   RestrictedBilinearForm :: 
   RestrictedBilinearForm (shared_ptr<FESpace> afespace,
                           const string & aname,
@@ -14,7 +27,283 @@ namespace ngcomp
       el_restriction(ael_restriction),
       fac_restriction(afac_restriction)
   {
-    ;
+    reuse_graph = flags.GetDefineFlag("reuse_graph");
+    compress = flags.GetDefineFlag("compress");
+    if (compress && eliminate_internal)
+      throw Exception("RestrictedBilinearForm: compress and eliminate_internal can not be combined");
+  }
+
+  bool RestrictedBilinearForm :: UpdateCompressedNumbering ()
+  {
+    static Timer timer ("RestrictedBilinearForm::UpdateCompressedNumbering");
+    RegionTimer reg (timer);
+
+    size_t ndof = fespace->GetNDof();
+    int ne = ma->GetNE(VOL);
+    BitArray active(ndof);
+    active.Clear();
+
+    Array<int> vol_elements;
+    RestrictionToIndices(el_restriction, ne, vol_elements);
+    ParallelForRange (Range(vol_elements.Size()), [&](IntRange r)
+    {
+      Array<DofId> dnums;
+      for (auto k : r)
+      {
+        auto eid = ElementId(VOL,vol_elements[k]);
+        if (!fespace->DefinedOn (VOL,ma->GetElIndex(eid)))
+          continue;
+        fespace->GetDofNrs (eid, dnums);
+        for (auto d : dnums)
+          if (IsRegularDof(d)) active.SetBitAtomic(d);
+      }
+    });
+
+    if (fespace->UsesDGCoupling())
+    {
+      Array<int> dg_facets;
+      RestrictionToIndices(fac_restriction, ma->GetNFacets(), dg_facets);
+      ParallelForRange (Range(dg_facets.Size()), [&](IntRange r)
+      {
+        Array<DofId> dnums_dg;
+        for (auto k : r)
+        {
+          GetDofNrsOfFacetCoupling(dg_facets[k], dnums_dg);
+          for (auto d : dnums_dg)
+            if (IsRegularDof(d)) active.SetBitAtomic(d);
+        }
+      });
+    }
+
+    Array<int> new_list;
+    BitArrayToIndices(active, new_list);
+
+    bool changed = compressed_dof_nr.Size() != ndof || new_list.Size() != active_dof_list.Size();
+    for (size_t i = 0; !changed && i < new_list.Size(); i++)
+      if (new_list[i] != active_dof_list[i])
+        changed = true;
+    if (!changed)
+      return false;
+
+    active_dof_list = std::move(new_list);
+    compressed_dof_nr.SetSize(ndof);
+    compressed_dof_nr = -1;
+    ParallelFor (active_dof_list.Size(), [&] (size_t i)
+    {
+      compressed_dof_nr[active_dof_list[i]] = i;
+    });
+    return true;
+  }
+
+  void RestrictedBilinearForm :: AddElementMatrix (FlatArray<int> dnums1,
+                                                   FlatArray<int> dnums2,
+                                                   BareSliceMatrix<double> elmat,
+                                                   ElementId id,
+                                                   LocalHeap & lh)
+  {
+    if (!compress)
+    {
+      T_BilinearForm<double,double>::AddElementMatrix (dnums1, dnums2, elmat, id, lh);
+      return;
+    }
+    FlatArray<int> cdnums1(dnums1.Size(), lh);
+    FlatArray<int> cdnums2(dnums2.Size(), lh);
+    for (size_t i = 0; i < dnums1.Size(); i++)
+      cdnums1[i] = CompressedDofNr(dnums1[i]);
+    for (size_t i = 0; i < dnums2.Size(); i++)
+      cdnums2[i] = CompressedDofNr(dnums2[i]);
+    T_BilinearForm<double,double>::AddElementMatrix (cdnums1, cdnums2, elmat, id, lh);
+  }
+
+  shared_ptr<SparseMatrix<double>> RestrictedBilinearForm :: CreateEmbedding () const
+  {
+    if (!compress)
+      throw Exception("RestrictedBilinearForm::CreateEmbedding: only for compressed forms");
+    size_t ndof = compressed_dof_nr.Size();
+    Array<int> elsperrow(ndof);
+    for (size_t i = 0; i < ndof; i++)
+      elsperrow[i] = compressed_dof_nr[i] != -1 ? 1 : 0;
+    auto embedding = make_shared<SparseMatrix<double>>(elsperrow, active_dof_list.Size());
+    ParallelFor (active_dof_list.Size(), [&] (size_t i)
+    {
+      (*embedding)(active_dof_list[i], i) = 1.0;
+    });
+    return embedding;
+  }
+
+  shared_ptr<BitArray> RestrictedBilinearForm :: CompressBitArray (const BitArray & ba) const
+  {
+    if (!compress)
+      throw Exception("RestrictedBilinearForm::CompressBitArray: only for compressed forms");
+    auto ret = make_shared<BitArray>(active_dof_list.Size());
+    ret->Clear();
+    for (size_t i = 0; i < active_dof_list.Size(); i++)
+      if (ba.Test(active_dof_list[i]))
+        ret->Set(i);
+    return ret;
+  }
+
+  void RestrictedBilinearForm :: GetDofNrsOfFacetCoupling (int facnr, Array<DofId> & dnums_dg) const
+  {
+    ArrayMem<DofId,100> dnums;
+    ArrayMem<int,2> elnums, elnums_per, nbelems;
+    ma->GetFacetElements(facnr,elnums);
+    for (int k=0; k<elnums.Size(); k++)
+      nbelems.Append(elnums[k]);
+
+    if(nbelems.Size() < 2)
+    {
+      int facet2 = ma->GetPeriodicFacet(facnr);
+      if(facet2 != facnr)
+      {
+        ma->GetFacetElements (facet2, elnums_per);
+        nbelems.Append(elnums_per[0]);
+      }
+    }
+    dnums_dg.SetSize(0);
+    for (int k=0;k<nbelems.Size();k++){
+      int elnr=nbelems[k];
+      if (!fespace->DefinedOn (VOL,ma->GetElIndex(ElementId(VOL,elnr)))) continue;
+      fespace->GetDofNrs (ElementId(VOL,elnr), dnums);
+      dnums_dg.Append(dnums);
+    }
+  }
+
+  // cols is a sorted row of a matrix graph
+  static bool SortedContains (FlatArray<int> cols, int col)
+  {
+    size_t first = 0, last = cols.Size();
+    while (first < last)
+    {
+      size_t mid = (first + last) / 2;
+      if (cols[mid] < col)
+        first = mid + 1;
+      else
+        last = mid;
+    }
+    return first < cols.Size() && cols[first] == col;
+  }
+
+  bool RestrictedBilinearForm :: GraphCoversRestrictions ()
+  {
+    static Timer timer ("RestrictedBilinearForm::GraphCoversRestrictions");
+    RegionTimer reg (timer);
+
+    if (fespace->GetNDof() != last_ndof)
+      return false;
+    if (bool(el_restriction) != bool(covered_el) || bool(fac_restriction) != bool(covered_fac))
+      return false;
+    const MatrixGraph * graph = dynamic_cast<const MatrixGraph*> (last_mat.get());
+    if (!graph)
+      return false;
+
+    // all couplings of dnums are already entries of the graph
+    // (a symmetric graph only stores the lower triangle)
+    const bool sym = IsSymmetric();
+    auto covers = [&] (FlatArray<DofId> dnums)
+    {
+      for (auto d1 : dnums)
+        if (IsRegularDof(CompressedDofNr(d1)))
+        {
+          const int cd1 = CompressedDofNr(d1);
+          FlatArray<int> cols = graph->GetRowIndices(cd1);
+          for (auto d2 : dnums)
+          {
+            const int cd2 = CompressedDofNr(d2);
+            if (!IsRegularDof(cd2) || (sym && cd2 > cd1)) continue;
+            if (!SortedContains(cols, cd2))
+              return false;
+          }
+        }
+      return true;
+    };
+
+    // all elements/facets of the restriction are checked (not only the ones that enter it):
+    // spaces may renumber their dofs with the same ndof, e.g. XFESpaces or compressed spaces
+    // after a change of the active dofs
+    if (el_restriction && el_restriction->Size() != covered_el->Size())
+      return false;
+    if (fac_restriction && fac_restriction->Size() != covered_fac->Size())
+      return false;
+    atomic<bool> covered(true);
+    {
+      Array<int> elnrs;
+      RestrictionToIndices(el_restriction, ma->GetNE(VOL), elnrs);
+      ParallelForRange (Range(elnrs.Size()), [&](IntRange r)
+      {
+        Array<DofId> dnums;
+        for (auto i : r)
+        {
+          if (!covered) return;
+          auto eid = ElementId(VOL,elnrs[i]);
+          if (!fespace->DefinedOn (VOL,ma->GetElIndex(eid)))
+            continue;
+          if (eliminate_internal)
+            fespace->GetDofNrs (eid, dnums, EXTERNAL_DOF);
+          else
+            fespace->GetDofNrs (eid, dnums);
+          if (!covers(dnums))
+            covered = false;
+        }
+      });
+    }
+    if (covered && fespace->UsesDGCoupling())
+    {
+      Array<int> facnrs;
+      RestrictionToIndices(fac_restriction, ma->GetNFacets(), facnrs);
+      ParallelForRange (Range(facnrs.Size()), [&](IntRange r)
+      {
+        Array<DofId> dnums_dg;
+        for (auto i : r)
+        {
+          if (!covered) return;
+          GetDofNrsOfFacetCoupling(facnrs[i], dnums_dg);
+          if (!covers(dnums_dg))
+            covered = false;
+        }
+      });
+    }
+    if (!covered)
+      return false;
+
+    // rebuild if too many elements that left the restriction are still in the graph
+    if (el_restriction)
+    {
+      auto new_covered_el = make_shared<BitArray>(*covered_el | *el_restriction);
+      if (new_covered_el->NumSet() - el_restriction->NumSet() > 0.25 * el_restriction->NumSet())
+        return false;
+      covered_el = new_covered_el;
+    }
+    if (fac_restriction)
+      covered_fac = make_shared<BitArray>(*covered_fac | *fac_restriction);
+    return true;
+  }
+
+  void RestrictedBilinearForm :: AllocateMatrix ()
+  {
+    if (mats.Size() == ma->GetNLevels())
+      return;
+
+    // a new compressed numbering requires a new graph
+    bool new_numbering = compress && UpdateCompressedNumbering();
+
+    graph_reused = reuse_graph && last_mat && !new_numbering && GraphCoversRestrictions();
+    if (graph_reused)
+    {
+      cout << IM(3) << "RestrictedBilinearForm: reusing matrix graph" << endl;
+      mats.Append (last_mat);
+      return;
+    }
+
+    T_BilinearForm<double,double>::AllocateMatrix();
+
+    if (reuse_graph)
+    {
+      last_mat = mats.Last();
+      last_ndof = fespace->GetNDof();
+      covered_el = el_restriction ? make_shared<BitArray>(*el_restriction) : nullptr;
+      covered_fac = fac_restriction ? make_shared<BitArray>(*fac_restriction) : nullptr;
+    }
   }
   
   
@@ -24,7 +313,7 @@ namespace ngcomp
     static Timer timer ("BilinearForm::GetGraph");
     RegionTimer reg (timer);
 
-    int ndof = fespace->GetNDof();
+    int ndof = compress ? active_dof_list.Size() : fespace->GetNDof();
     int nf = ma->GetNFacets();
     int neV = ma->GetNE(VOL);
     int neB = ma->GetNE(BND);
@@ -33,31 +322,32 @@ namespace ngcomp
     int nspe = specialelements.Size();
 
     Array<DofId> dnums;
-    Array<int> fnums; //facets of one element
-    Array<int> elnums; //elements neighbouring one facet
-    Array<int> nbelems; //neighbour elements
 
 
     int maxind = neV + neB + neBB + specialelements.Size();
     if (fespace->UsesDGCoupling()) maxind += nf;
 
+    // volume elements of the restriction
+    Array<int> vol_elements;
+    RestrictionToIndices(el_restriction, neV, vol_elements);
+
+    // facets with DG couplings
+    Array<int> dg_facets;
+    if (fespace->UsesDGCoupling())
+      RestrictionToIndices(fac_restriction, nf, dg_facets);
+
     TableCreator<int> creator(maxind);
     for ( ; !creator.Done(); creator++)
       {
 	for(VorB vb : {VOL, BND, BBND})
 	  {
-	    int nre = ma->GetNE(vb);
+	    int nre = (vb == VOL) ? vol_elements.Size() : ma->GetNE(vb);
 	    ParallelForRange (Range(nre), [&](IntRange r)
 			      {
 				Array<DofId> dnums;
-				for (auto i : r)
+				for (auto k : r)
 				  {
-                                    // if (vb == VOL)
-                                    //   if (el_restriction && (! el_restriction->Test(i)))
-                                    //     continue;
-                                    if (vb == VOL)
-                                      if (el_restriction && (! el_restriction->Test(i)))
-                                        continue;
+				    int i = (vb == VOL) ? vol_elements[k] : k;
 				    auto eid = ElementId(vb,i);
 				    if (!fespace->DefinedOn (vb,ma->GetElIndex(eid)))
                                       continue;
@@ -68,7 +358,7 @@ namespace ngcomp
 				      fespace->GetDofNrs (eid, dnums);
 				    int shift = (vb==VOL) ? 0 : ((vb==BND) ? neV : neV+neB);
 				    for (int d : dnums)
-				      if (d != -1) creator.Add (shift+i, d);
+				      if (IsRegularDof(CompressedDofNr(d))) creator.Add (shift+i, CompressedDofNr(d));
                               }
 			      });
 	  }
@@ -78,45 +368,25 @@ namespace ngcomp
           {
             specialelements[i]->GetDofNrs (dnums);
             for (int d : dnums)
-              if (d != -1) creator.Add (neV+neB+neBB+i, d);
+              if (IsRegularDof(CompressedDofNr(d))) creator.Add (neV+neB+neBB+i, CompressedDofNr(d));
           }
 
         if (fespace->UsesDGCoupling())
         {
           //add dofs of neighbour elements as well
-          Array<DofId> dnums_dg;
-          Array<int> elnums_per;
-
-          for (int i = 0; i < nf; i++)
-            {
-              if (fac_restriction && (! fac_restriction->Test(i)))
-                continue;
-              nbelems.SetSize(0);
-              ma->GetFacetElements(i,elnums);
-              for (int k=0; k<elnums.Size(); k++)
-                nbelems.Append(elnums[k]);
-
-              if(nbelems.Size() < 2)
-              {
-                int facet2 = ma->GetPeriodicFacet(i);
-                if(facet2 != i)
-                {
-                  ma->GetFacetElements (facet2, elnums_per);
-                  nbelems.Append(elnums_per[0]);
-                }
-              }
-              dnums_dg.SetSize(0);
-              for (int k=0;k<nbelems.Size();k++){
-                int elnr=nbelems[k];
-                if (!fespace->DefinedOn (VOL,ma->GetElIndex(ElementId(VOL,elnr)))) continue;
-                fespace->GetDofNrs (ElementId(VOL,elnr), dnums);
-                dnums_dg.Append(dnums);
-              }
-              QuickSort (dnums_dg);
-              for (int j = 0; j < dnums_dg.Size(); j++)
-                if (dnums_dg[j] != -1 && (j==0 || (dnums_dg[j] != dnums_dg[j-1]) ))
-                  creator.Add (neV+neB+neBB+nspe+i, dnums_dg[j]);
-            }
+          ParallelForRange (Range(dg_facets.Size()), [&](IntRange r)
+                            {
+                              Array<DofId> dnums_dg;
+                              for (auto k : r)
+                                {
+                                  int i = dg_facets[k];
+                                  GetDofNrsOfFacetCoupling(i, dnums_dg);
+                                  QuickSort (dnums_dg);
+                                  for (int j = 0; j < dnums_dg.Size(); j++)
+                                    if (IsRegularDof(dnums_dg[j]) && (j==0 || (dnums_dg[j] != dnums_dg[j-1]) ))
+                                      creator.Add (neV+neB+neBB+nspe+i, CompressedDofNr(dnums_dg[j]));
+                                }
+                            });
         }
 
       }
@@ -136,4 +406,83 @@ namespace ngcomp
     graph -> FindSameNZE();
     return graph;
   }
+
+  RestrictedLinearForm ::
+  RestrictedLinearForm (shared_ptr<FESpace> afespace,
+                        const string & aname,
+                        shared_ptr<BitArray> ael_restriction,
+                        const Flags & flags)
+    : T_LinearForm<double>(afespace, aname, flags),
+      el_restriction(ael_restriction)
+  {
+    ;
+  }
+
+  void RestrictedLinearForm :: Assemble (LocalHeap & clh)
+  {
+    bool has_skeleton_parts = false;
+    for (auto & lfi : parts)
+      if (lfi->SkeletonForm())
+        has_skeleton_parts = true;
+    if (!el_restriction || has_skeleton_parts)
+    {
+      if (has_skeleton_parts && el_restriction)
+        cout << IM(3) << "RestrictedLinearForm: form has skeleton integrators, element restriction not used (full assembly)." << endl;
+      T_LinearForm<double>::Assemble(clh);
+      return;
+    }
+
+    static Timer timer ("RestrictedLinearForm::Assemble");
+    RegionTimer reg (timer);
+
+    if (!GetVectorPtr() || GetVector().Size() != fespace->GetNDof())
+      AllocateVector();
+    else
+      GetVector() = 0.0;
+
+    Array<int> elnrs;
+    BitArrayToIndices(*el_restriction, elnrs);
+
+    for (VorB vb : {VOL, BND})
+    {
+      bool has_parts = false;
+      for (auto & lfi : parts)
+        if (lfi->VB() == vb)
+          has_parts = true;
+      if (!has_parts)
+        continue;
+
+      // elements of the restriction are not colored, hence atomic adds
+      auto assemble_element = [&] (int elnr, LocalHeap & lh)
+      {
+        ElementId ei(vb,elnr);
+        if (!fespace->DefinedOn (ei))
+          return;
+        const FiniteElement & fel = fespace->GetFE (ei, lh);
+        ElementTransformation & eltrans = ma->GetTrafo (ei, lh);
+        Array<DofId> dnums(fel.GetNDof(), lh);
+        fespace->GetDofNrs (ei, dnums);
+
+        FlatVector<double> elvec(dnums.Size() * fespace->GetDimension(), lh);
+        FlatVector<double> elvec1(dnums.Size() * fespace->GetDimension(), lh);
+        elvec = 0.0;
+        for (auto & lfi : parts)
+        {
+          if (lfi->VB() != vb) continue;
+          if (!lfi->DefinedOn (ma->GetElIndex (ei))) continue;
+          if (!lfi->DefinedOnElement (elnr)) continue;
+          lfi->CalcElementVector (fel, eltrans, elvec1, lh);
+          elvec += elvec1;
+        }
+        fespace->TransformVec (ei, elvec, TRANSFORM_RHS);
+        GetVector().AddIndirect (dnums, elvec, true);
+      };
+
+      if (vb == VOL)
+        IterateIndices (elnrs, clh, assemble_element);
+      else
+        IterateRange (ma->GetNE(BND), clh, assemble_element);
+    }
+    assembled = true;
+  }
 }
@@ -8,6 +8,35 @@ namespace ngcomp
   {
     shared_ptr<BitArray> el_restriction = nullptr;
     shared_ptr<BitArray> fac_restriction = nullptr;
+
+    // reuse of the matrix (graph) if the restrictions change (flag "reuse_graph"):
+    // the pattern of last_mat contains the couplings of all elements/facets in
+    // covered_el/covered_fac. Elements that leave the restriction keep their
+    // (zero) entries until too many of them are collected.
+    bool reuse_graph = false;
+    shared_ptr<BaseMatrix> last_mat = nullptr;
+    shared_ptr<BitArray> covered_el = nullptr;
+    shared_ptr<BitArray> covered_fac = nullptr;
+    size_t last_ndof = 0;
+    bool graph_reused = false;   // last AllocateMatrix reused last_mat
+
+    // compressed numbering of the active dofs (flag "compress"): only dofs of
+    // elements in el_restriction and of the DG couplings of facets in
+    // fac_restriction are rows/columns of the matrix
+    bool compress = false;
+    Array<int> active_dof_list;     // compressed -> full numbering
+    Array<int> compressed_dof_nr;   // full -> compressed numbering (-1 if inactive)
+
+    bool GraphCoversRestrictions ();
+    void GetDofNrsOfFacetCoupling (int facnr, Array<DofId> & dnums_dg) const;
+    // returns true if the set of active dofs changed
+    bool UpdateCompressedNumbering ();
+    int CompressedDofNr (DofId d) const
+    {
+      if (!compress || !IsRegularDof(d))
+        return d;
+      return compressed_dof_nr[d];
+    }
   public:
     /// generate a bilinear-form
     // RestrictedBilinearForm () ;
@@ -27,6 +56,37 @@ namespace ngcomp
     //     	  const Flags & flags);
 
     virtual MatrixGraph * GetGraph (int level, bool symmetric);
+    virtual void AllocateMatrix ();
+    virtual void AddElementMatrix (FlatArray<int> dnums1,
+                                   FlatArray<int> dnums2,
+                                   BareSliceMatrix<double> elmat,
+                                   ElementId id,
+                                   LocalHeap & lh);
+
+    bool IsCompressed () const { return compress; }
+    bool GraphReused () const { return graph_reused; }
+    size_t GetNActiveDofs () const { return active_dof_list.Size(); }
+    FlatArray<int> GetActiveDofList () const { return active_dof_list; }
+    // embedding E (ndof x nactive) from the compressed into the full numbering,
+    // the restriction of a vector in the full numbering is E^T
+    shared_ptr<SparseMatrix<double>> CreateEmbedding () const;
+    // restriction of a BitArray (e.g. freedofs) to the compressed numbering
+    shared_ptr<BitArray> CompressBitArray (const BitArray & ba) const;
+  };
+
+  // Linear form that only visits the volume elements marked in el_restriction
+  // (in parallel). Integrators on boundary elements are assembled on all boundary
+  // elements. Forms with skeleton integrators fall back to the standard assembly.
+  class RestrictedLinearForm : public T_LinearForm<double>
+  {
+    shared_ptr<BitArray> el_restriction = nullptr;
+  public:
+    RestrictedLinearForm (shared_ptr<FESpace> afespace,
+                          const string & aname,
+                          shared_ptr<BitArray> el_restriction,
+                          const Flags & flags);
+
+    virtual void Assemble (LocalHeap & lh);
   };
 
 }
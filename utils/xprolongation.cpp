@@ -7,6 +7,190 @@ using namespace ngcomp;
 namespace ngmg
 {
 
+  // dof of every vertex (NO_DOF_NR if there is none)
+  static void GetVertexDofs (const MeshAccess & ma, const FESpace & fes, Array<int> & vert2dof)
+  {
+    vert2dof.SetSize(ma.GetNV());
+    ParallelForRange (vert2dof.Size(), [&] (IntRange myrange)
+    {
+      Array<int> dnums(1);
+      for (auto i : myrange)
+      {
+        fes.GetDofNrs(NodeId(NT_VERTEX,i),dnums);    
+        if (dnums.Size() > 0 && IsRegularDof(dnums[0]))
+          vert2dof[i] = dnums[0];
+        else
+          vert2dof[i] = NO_DOF_NR;
+      }
+    });
+  }
+
+  // vertices and (first) dof of every edge (NO_DOF_NR if there is none)
+  static void GetEdgeDofs (const MeshAccess & ma, const FESpace & fes,
+                           Array<INT<2>> & edges, Array<int> & edge2dof)
+  {
+    size_t ne = ma.GetNEdges();
+    edges.SetSize(ne);
+    edge2dof.SetSize(ne);
+    ParallelForRange (ne, [&] (IntRange myrange)
+    {
+      Array<int> dnums(1);
+      for (auto i : myrange)
+      {
+        auto pnums = ma.GetEdgePNums(i);
+        edges[i] = INT<2>(pnums[0], pnums[1]);
+        fes.GetDofNrs(NodeId(NT_EDGE,i),dnums);
+        if (dnums.Size() > 0 && IsRegularDof(dnums[0]))
+          edge2dof[i] = dnums[0];
+        else
+          edge2dof[i] = NO_DOF_NR;
+      }
+    });
+  }
+
+  // Sets up the prolongation matrix row by row. GetRow(i, cols, vals) returns the
+  // fine dof of node i (or NO_DOF_NR) and the coarse dofs/weights of its row.
+  template <typename TFUNC>
+  static SparseMatrix<double> * CreateMatrixFromRows (size_t ndof_fine, size_t ndof_coarse,
+                                                       size_t nnodes, TFUNC GetRow)
+  {
+    Array<int> elsperrow(ndof_fine);
+    elsperrow = 0;
+    ParallelForRange (nnodes, [&] (IntRange myrange)
+    {
+      ArrayMem<int,12> cols;
+      ArrayMem<double,12> vals;
+      for (auto i : myrange)
+      {
+        int row = GetRow(i, cols, vals);
+        if (IsRegularDof(row))
+          elsperrow[row] = cols.Size();
+      }
+    });
+
+    auto mat = new SparseMatrix<double>(elsperrow, ndof_coarse);
+    ParallelForRange (nnodes, [&] (IntRange myrange)
+    {
+      ArrayMem<int,12> cols;
+      ArrayMem<double,12> vals;
+      for (auto i : myrange)
+      {
+        int row = GetRow(i, cols, vals);
+        if (IsRegularDof(row))
+          for (auto j : Range(cols))
+            (*mat)(row, cols[j]) = vals[j];
+      }
+    });
+    return mat;
+  }
+
+  // P2 prolongation matrix for NGSolve's hierarchical H1 basis (simplices): the
+  // vertex dofs are vertex values, the edge dof of edge (a,b) belongs to a multiple
+  // of lam_a*lam_b. A fine edge dof is the (negative) second derivative of the
+  // coarse function along the edge, which only involves the coarse edge dofs.
+  static SparseMatrix<double> * CreateP2ProlongationMatrix (const MeshAccess & ma, size_t nc, size_t nf,
+                                                            FlatArray<int> vert2dof_coarse,
+                                                            FlatArray<int> vert2dof_fine,
+                                                            FlatArray<INT<2>> edges_coarse,
+                                                            FlatArray<int> edge2dof_coarse,
+                                                            FlatArray<INT<2>> edges_fine,
+                                                            FlatArray<int> edge2dof_fine,
+                                                            size_t ndof_coarse, size_t ndof_fine)
+  {
+    // value of the edge shape function in the edge midpoint
+    H1HighOrderFE<ET_SEGM> segm(2);
+    Vector<> shape(segm.GetNDof());
+    segm.CalcShape(IntegrationPoint(0.5), shape);
+    double edgemid = shape(2);
+
+    TableCreator<int> creator(nc);
+    for ( ; !creator.Done(); creator++)
+      for (auto i : Range(edges_coarse))
+        creator.Add(edges_coarse[i][0], i);
+    Table<int> vert2edges = creator.MoveTable();
+
+    auto CoarseEdgeDof = [&] (int v1, int v2)
+    {
+      for (int v : { v1, v2 })
+        for (auto e : vert2edges[v])
+          if ( (edges_coarse[e][0] == v1 && edges_coarse[e][1] == v2)
+               || (edges_coarse[e][0] == v2 && edges_coarse[e][1] == v1) )
+            return edge2dof_coarse[e];
+      return int(NO_DOF_NR);
+    };
+
+    // barycentric coordinates of a fine vertex w.r.t. coarse vertices
+    auto AddBarycentric = [&] (int v, double fac, Array<int> & verts, Array<double> & lam)
+    {
+      ArrayMem<int,2> parents;
+      if (size_t(v) < nc)
+        parents.Append(v);
+      else
+      {
+        auto pnodes = ma.GetParentNodes(v);
+        parents.Append(pnodes[0]);
+        parents.Append(pnodes[1]);
+      }
+      for (auto p : parents)
+      {
+        auto pos = verts.Pos(p);
+        if (pos == -1)
+        {
+          verts.Append(p);
+          lam.Append(0.0);
+          pos = verts.Size()-1;
+        }
+        lam[pos] += fac / parents.Size();
+      }
+    };
+
+    auto GetRow = [&] (size_t i, Array<int> & cols, Array<double> & vals)
+    {
+      cols.SetSize0();
+      vals.SetSize0();
+      auto Add = [&] (int d, double val)
+      {
+        if (IsRegularDof(d) && val != 0.0)
+        {
+          cols.Append(d);
+          vals.Append(val);
+        }
+      };
+
+      if (i < nf)
+      {
+        int d = vert2dof_fine[i];
+        if (!IsRegularDof(d))
+          return d;
+        if (i < nc)
+          Add(vert2dof_coarse[i], 1.0);
+        else
+        {
+          auto pnodes = ma.GetParentNodes(i);
+          Add(vert2dof_coarse[pnodes[0]], 0.5);
+          Add(vert2dof_coarse[pnodes[1]], 0.5);
+          Add(CoarseEdgeDof(pnodes[0], pnodes[1]), edgemid);
+        }
+        return d;
+      }
+
+      int d = edge2dof_fine[i-nf];
+      if (!IsRegularDof(d))
+        return d;
+      // difference of barycentric coordinates between the edge vertices
+      ArrayMem<int,4> verts;
+      ArrayMem<double,4> dlam;
+      AddBarycentric(edges_fine[i-nf][0], -1.0, verts, dlam);
+      AddBarycentric(edges_fine[i-nf][1], 1.0, verts, dlam);
+      for (auto j : Range(verts))
+        for (size_t k = j+1; k < verts.Size(); k++)
+          Add(CoarseEdgeDof(verts[j], verts[k]), -dlam[j]*dlam[k]);
+      return d;
+    };
+
+    return CreateMatrixFromRows (ndof_fine, ndof_coarse, nf + edges_fine.Size(), GetRow);
+  }
+
   void P1Prolongation :: Update (const FESpace & afes)
   {
     fes = &afes;
@@ -18,95 +202,235 @@ namespace ngmg
     else
       return;
 
+    static Timer t("P1Prolongation::Update"); RegionTimer r(t);
+    ndoflevel.Append (fes->GetNDof());
     int nv = ma->GetNV();
     shared_ptr<Array<int>> vert2dof = make_shared<Array<int>>(nv);
+    GetVertexDofs (*ma, *fes, *vert2dof);
+    v2d_on_lvl.Append(vert2dof);
+    //cout << "vert2dof : " << *vert2dof << endl;
 
-    tmp_vecs.Append(make_shared<VVector<double>>(fes->GetNDof()));
+    // parents of the new vertices and (transposed) children of the coarse vertices
+    // (nothing to prolongate to the coarsest level)
+    size_t nf = nv;
+    size_t nc = nvlevel.Size() > 1 ? nvlevel[nvlevel.Size()-2] : nf;
+    auto parents = make_shared<Array<INT<2>>>(nf-nc);
+    ParallelFor (nf-nc, [&] (size_t i)
+    {
+      auto pnodes = ma->GetParentNodes (nc+i);
+      (*parents)[i] = INT<2>(pnodes[0], pnodes[1]);
+    });
 
-    Array<int> dnums(1);
-    for (auto i : Range(nv))
+    TableCreator<int> creator(nc);
+    for ( ; !creator.Done(); creator++)
+      for (size_t i = 0; i < nf-nc; i++)
+        for (auto j : Range(2))
+          creator.Add ((*parents)[i][j], nc+i);
+    parents_on_lvl.Append(parents);
+    children_on_lvl.Append(make_shared<Table<int>>(creator.MoveTable()));
+  }
+
+
+  SparseMatrix< double >* P1Prolongation :: CreateProlongationMatrix( int finelevel ) const
+  {
+    if (fes == nullptr)
+      throw Exception("call Update before creating the prolongation matrix");
+    static Timer t("P1Prolongation::CreateProlongationMatrix"); RegionTimer r(t);
+    FlatArray<int> vert2dof_fine = *(v2d_on_lvl[finelevel]);
+    FlatArray<int> vert2dof_coarse = *(v2d_on_lvl[finelevel-1]);
+    FlatArray<INT<2>> parents = *(parents_on_lvl[finelevel]);
+    size_t nc = nvlevel[finelevel-1];
+    size_t nf = nvlevel[finelevel];
+
+    auto GetRow = [&] (size_t i, Array<int> & cols, Array<double> & vals)
     {
-      fes->GetDofNrs(NodeId(NT_VERTEX,i),dnums);    
-      if (dnums.Size() > 0 && IsRegularDof(dnums[0]))
-        (*vert2dof)[i] = dnums[0];
+      cols.SetSize0();
+      vals.SetSize0();
+      int d = vert2dof_fine[i];
+      if (!IsRegularDof(d))
+        return d;
+      if (i < nc)
+      {
+        if (IsRegularDof(vert2dof_coarse[i]))
+        {
+          cols.Append(vert2dof_coarse[i]);
+          vals.Append(1.0);
+        }
+      }
       else
-        (*vert2dof)[i] = NO_DOF_NR;
-    }
-    v2d_on_lvl.Append(vert2dof);
-    //cout << "vert2dof : " << *vert2dof << endl;
+        for (auto j : Range(2))
+          if (IsRegularDof(vert2dof_coarse[parents[i-nc][j]]))
+          {
+            cols.Append(vert2dof_coarse[parents[i-nc][j]]);
+            vals.Append(0.5);
+          }
+      return d;
+    };
+    return CreateMatrixFromRows (ndoflevel[finelevel], ndoflevel[finelevel-1], nf, GetRow);
   }
 
 
-  void P1Prolongation :: ProlongateInline (int finelevel, BaseVector & v) const
+  void P1Prolongation :: ProlongateVectors (int finelevel, FlatArray<BaseVector*> vecs) const
   {
     if (fes == nullptr)
       throw Exception("call Update before prolongating");
-    if (v.EntrySize() > 1)
-      throw Exception("no dim>1 yet");    
     static Timer t("Prolongate"); RegionTimer r(t);
-    Array<int> & vert2dof_fine = *(v2d_on_lvl[finelevel]);
-    Array<int> & vert2dof_coarse = *(v2d_on_lvl[finelevel-1]);
+    FlatArray<int> vert2dof_fine = *(v2d_on_lvl[finelevel]);
+    FlatArray<int> vert2dof_coarse = *(v2d_on_lvl[finelevel-1]);
+    FlatArray<INT<2>> parents = *(parents_on_lvl[finelevel]);
 
     size_t nc = nvlevel[finelevel-1];
     size_t nf = nvlevel[finelevel];
 
-    FlatVector<> fv = v.FV<double>();
-    FlatVector<> fw = tmp_vecs[finelevel-1]->FV<double>();
-    fw = fv;
-    fv = 0.0;
-    for (size_t i = 0; i < nc; i++)
-      if (IsRegularDof(vert2dof_fine[i]))
-        fv(vert2dof_fine[i]) = fw(vert2dof_coarse[i]);
+    // coarse vertex values of all vectors: vector j at offset nc*offset[j]
+    Array<size_t> offset(vecs.Size()+1);
+    offset[0] = 0;
+    for (auto j : Range(vecs))
+      offset[j+1] = offset[j] + vecs[j]->EntrySize();
+    tmp_vals.SetSize(nc*offset.Last());
+    FlatVector<> fw = tmp_vals;
 
-    for (size_t i = nc; i < nf; i++)
+    // gather coarse vertex values (inactive dofs are zero)
+    ParallelFor (nc, [&] (size_t i)
+    {
+      int d = vert2dof_coarse[i];
+      for (auto j : Range(vecs))
       {
-        if (!IsRegularDof(vert2dof_fine[i]))
-          continue;
-
-        auto parents = ma->GetParentNodes (i);
-        for (auto j : Range(2))
-          //if (IsRegularDof(vert2dof_coarse[parents[j]])) //not necessary
-          fv(vert2dof_fine[i]) += 0.5 * fw(vert2dof_coarse[parents[j]]);
+        FlatVector<> fv = vecs[j]->FV<double>();
+        size_t es = vecs[j]->EntrySize();
+        for (size_t k = 0; k < es; k++)
+          fw(nc*offset[j]+i*es+k) = IsRegularDof(d) ? fv(d*es+k) : 0.0;
       }
+    });
+
+    for (auto vp : vecs)
+    {
+      FlatVector<> fv = vp->FV<double>();
+      ParallelForRange (fv.Size(), [&] (IntRange myrange)
+      {
+        fv.Range(myrange) = 0.0;
+      });
+    }
 
+    ParallelFor (nf, [&] (size_t i)
+    {
+      int d = vert2dof_fine[i];
+      if (!IsRegularDof(d))
+        return;
+      for (auto j : Range(vecs))
+      {
+        FlatVector<> fv = vecs[j]->FV<double>();
+        FlatVector<> fwj = fw.Range(nc*offset[j], nc*offset[j+1]);
+        size_t es = vecs[j]->EntrySize();
+        if (i < nc)
+          for (size_t k = 0; k < es; k++)
+            fv(d*es+k) = fwj(i*es+k);
+        else
+        {
+          auto p = parents[i-nc];
+          for (size_t k = 0; k < es; k++)
+            fv(d*es+k) = 0.5 * (fwj(p[0]*es+k) + fwj(p[1]*es+k));
+        }
+      }
+    });
   }
 
 
-  void P1Prolongation :: RestrictInline (int finelevel, BaseVector & v) const
+  void P1Prolongation :: RestrictVectors (int finelevel, FlatArray<BaseVector*> vecs) const
   {
     if (fes == nullptr)
       throw Exception("call Update before restricting");
-    if (v.EntrySize() > 1)
-      throw Exception("no dim>1 yet");
     static Timer t("Restrict"); RegionTimer r(t);
 
-    Array<int> & vert2dof_fine = *(v2d_on_lvl[finelevel]);
-    Array<int> & vert2dof_coarse = *(v2d_on_lvl[finelevel-1]);
+    FlatArray<int> vert2dof_fine = *(v2d_on_lvl[finelevel]);
+    FlatArray<int> vert2dof_coarse = *(v2d_on_lvl[finelevel-1]);
+    const Table<int> & children = *(children_on_lvl[finelevel]);
 
     size_t nc = nvlevel[finelevel-1];
     size_t nf = nvlevel[finelevel];
 
-    FlatVector<> fv = v.FV<double>();
-    FlatVector<> fw = tmp_vecs[finelevel]->FV<double>();
-    fw = fv;
-    fv = 0;
-    for (size_t i = 0; i < nc; i++)
+    // fine vertex values of all vectors: vector j at offset nf*offset[j]
+    Array<size_t> offset(vecs.Size()+1);
+    offset[0] = 0;
+    for (auto j : Range(vecs))
+      offset[j+1] = offset[j] + vecs[j]->EntrySize();
+    tmp_vals.SetSize(nf*offset.Last());
+    FlatVector<> fw = tmp_vals;
+
+    // gather fine vertex values (inactive dofs are zero)
+    ParallelFor (nf, [&] (size_t i)
     {
-      if (!IsRegularDof(vert2dof_coarse[i]))
-        continue;
-      if (IsRegularDof(vert2dof_fine[i]))
-        fv(vert2dof_coarse[i]) = fw(vert2dof_fine[i]);
+      int d = vert2dof_fine[i];
+      for (auto j : Range(vecs))
+      {
+        FlatVector<> fv = vecs[j]->FV<double>();
+        size_t es = vecs[j]->EntrySize();
+        for (size_t k = 0; k < es; k++)
+          fw(nf*offset[j]+i*es+k) = IsRegularDof(d) ? fv(d*es+k) : 0.0;
+      }
+    });
+
+    for (auto vp : vecs)
+    {
+      FlatVector<> fv = vp->FV<double>();
+      ParallelForRange (fv.Size(), [&] (IntRange myrange)
+      {
+        fv.Range(myrange) = 0.0;
+      });
     }
 
-    for (size_t i = nf; i-- > nc; )
+    // transposed prolongation: every coarse dof collects from its children
+    ParallelFor (nc, [&] (size_t i)
     {
-      auto parents = ma->GetParentNodes (i);
-      if (!IsRegularDof(vert2dof_fine[i]))
-        continue;
-      for (auto j : Range(2))
-        if (IsRegularDof(vert2dof_coarse[parents[j]])) // not necessary... apperently it is!
-        	fv(vert2dof_coarse[parents[j]]) += 0.5 * fw(vert2dof_fine[i]);
-    } 
+      int d = vert2dof_coarse[i];
+      if (!IsRegularDof(d))
+        return;
+      for (auto j : Range(vecs))
+      {
+        FlatVector<> fv = vecs[j]->FV<double>();
+        FlatVector<> fwj = fw.Range(nf*offset[j], nf*offset[j+1]);
+        size_t es = vecs[j]->EntrySize();
+        for (size_t k = 0; k < es; k++)
+        {
+          double sum = fwj(i*es+k);
+          for (auto child : children[i])
+            sum += 0.5 * fwj(child*es+k);
+          fv(d*es+k) = sum;
+        }
+      }
+    });
+  }
+
+
+  void P1Prolongation :: ProlongateInline (int finelevel, BaseVector & v) const
+  {
+    BaseVector * vp = &v;
+    ProlongateVectors (finelevel, FlatArray<BaseVector*>(1, &vp));
+  }
+
+
+  void P1Prolongation :: RestrictInline (int finelevel, BaseVector & v) const
+  {
+    BaseVector * vp = &v;
+    RestrictVectors (finelevel, FlatArray<BaseVector*>(1, &vp));
+  }
+
+
+  void P1Prolongation :: ProlongateInline (int finelevel, FlatArray<shared_ptr<BaseVector>> vecs) const
+  {
+    Array<BaseVector*> vps(vecs.Size());
+    for (auto i : Range(vecs))
+      vps[i] = vecs[i].get();
+    ProlongateVectors (finelevel, vps);
+  }
+
+
+  void P1Prolongation :: RestrictInline (int finelevel, FlatArray<shared_ptr<BaseVector>> vecs) const
+  {
+    Array<BaseVector*> vps(vecs.Size());
+    for (auto i : Range(vecs))
+      vps[i] = vecs[i].get();
+    RestrictVectors (finelevel, vps);
   }
 
   void P2Prolongation :: Update (const FESpace & afes)
@@ -116,32 +440,34 @@ namespace ngmg
     {
       nVertLevel.Append (ma->GetNV());
       nEdgeLevel.Append( ma->GetNEdges() );
-      
-      //ndoflevel.Append (fes->GetNDof());
+      ndoflevel.Append (fes->GetNDof());
     }
     else
       return;
 
     tmp_vecs.Append(make_shared<VVector<double>>(fes->GetNDof()));
 
-    /*
-    int nv = ma->GetNV();
-    // shared_ptr<Array<int>> vert2dof = make_shared<Array<int>>(nv);
+    auto vert2dof = make_shared<Array<int>>();
+    GetVertexDofs (*ma, *fes, *vert2dof);
+    v2d_on_lvl.Append(vert2dof);
 
-    // tmp_vecs.Append(make_shared<VVector<double>>(fes->GetNDof()));
+    auto edges = make_shared<Array<INT<2>>>();
+    auto edge2dof = make_shared<Array<int>>();
+    GetEdgeDofs (*ma, *fes, *edges, *edge2dof);
+    edges_on_lvl.Append(edges);
+    e2d_on_lvl.Append(edge2dof);
+  }
 
-    Array<int> dnums(1);
-    for (auto i : Range(nv))
-    {
-      fes->GetDofNrs(NodeId(NT_VERTEX,i),dnums);    
-      if (dnums.Size() > 0 && IsRegularDof(dnums[0]))
-        (*vert2dof)[i] = dnums[0];
-      else
-        (*vert2dof)[i] = NO_DOF_NR;
-    }
-    // v2d_on_lvl.Append(vert2dof);
-    //cout << "vert2dof : " << *vert2dof << endl;
-    */
+  SparseMatrix< double >* P2Prolongation :: CreateProlongationMatrix( int finelevel ) const
+  {
+    if (fes == nullptr)
+      throw Exception("call Update before creating the prolongation matrix");
+    static Timer t("P2Prolongation::CreateProlongationMatrix"); RegionTimer r(t);
+    return CreateP2ProlongationMatrix (*ma, nVertLevel[finelevel-1], nVertLevel[finelevel],
+                                       *v2d_on_lvl[finelevel-1], *v2d_on_lvl[finelevel],
+                                       *edges_on_lvl[finelevel-1], *e2d_on_lvl[finelevel-1],
+                                       *edges_on_lvl[finelevel], *e2d_on_lvl[finelevel],
+                                       ndoflevel[finelevel-1], ndoflevel[finelevel]);
   }
 
   void P2Prolongation :: ProlongateInline (int finelevel, BaseVector & v) const
@@ -338,6 +664,33 @@ namespace ngmg
 
     v2d_on_lvl.Append(vert2dof);
     // cout << "vert2dof : " << *vert2dof << endl;
+
+    ndoflevel.Append (fes->GetNDof());
+    auto edges = make_shared<Array<INT<2>>>();
+    auto edge2dof = make_shared<Array<int>>();
+    GetEdgeDofs (*ma, *fes, *edges, *edge2dof);
+    edges_on_lvl.Append(edges);
+    e2d_on_lvl.Append(edge2dof);
+
+    // matrix for the inline prolongation/restriction (nothing to prolongate to the coarsest level)
+    if (nlvl > 1)
+      prol_mats.Append(shared_ptr<SparseMatrix<double>>(CreateProlongationMatrix(nlvl-1)));
+    else
+      prol_mats.Append(nullptr);
+  }
+
+  SparseMatrix< double >* P2CutProlongation :: CreateProlongationMatrix( int finelevel ) const
+  {
+    if (fes == nullptr)
+      throw Exception("call Update before creating the prolongation matrix");
+    static Timer t("P2CutProlongation::CreateProlongationMatrix"); RegionTimer r(t);
+    // (the first nVertLevel entries of v2d_on_lvl are the vertex dofs)
+    return CreateP2ProlongationMatrix (*ma, nVertLevel[finelevel-1], nVertLevel[finelevel],
+                                       v2d_on_lvl[finelevel-1]->Range(0,nVertLevel[finelevel-1]),
+                                       v2d_on_lvl[finelevel]->Range(0,nVertLevel[finelevel]),
+                                       *edges_on_lvl[finelevel-1], *e2d_on_lvl[finelevel-1],
+                                       *edges_on_lvl[finelevel], *e2d_on_lvl[finelevel],
+                                       ndoflevel[finelevel-1], ndoflevel[finelevel]);
   }
 
   void P2CutProlongation :: ProlongateInline (int finelevel, BaseVector & v) const
@@ -408,6 +761,21 @@ namespace ngmg
         for (auto j: Range(3) )        
           fv( vert2dof_fine[unk] ) += fac[j] * fw( vert2dof_coarse[ edgeconn[j] ] );
     }
+    #else
+    if (fes == nullptr)
+      throw Exception("call Update before prolongating");
+    if (v.EntrySize() > 1)
+      throw Exception("no dim>1 yet");
+    static Timer t("Prolongate"); RegionTimer r(t);
+    // (the inline version above does not fit to the hierarchical basis, the
+    // prolongation matrix is applied instead)
+    FlatVector<> fv = v.FV<double>();
+    FlatVector<> fc = tmp_vecs[finelevel-1]->FV<double>();
+    FlatVector<> ff = tmp_vecs[finelevel]->FV<double>();
+    fc = fv.Range(0, fc.Size());
+    prol_mats[finelevel]->Mult(*tmp_vecs[finelevel-1], *tmp_vecs[finelevel]);
+    fv = 0.0;
+    fv.Range(0, ff.Size()) = ff;
     #endif
 
   }
@@ -486,9 +854,110 @@ void P2CutProlongation :: RestrictInline (int finelevel, BaseVector & v) const
         }
 
     }
+    #else
+    if (fes == nullptr)
+      throw Exception("call Update before restricting");
+    if (v.EntrySize() > 1)
+      throw Exception("no dim>1 yet");
+    static Timer t("Restrict"); RegionTimer r(t);
+    // transpose of the prolongation matrix
+    FlatVector<> fv = v.FV<double>();
+    FlatVector<> fc = tmp_vecs[finelevel-1]->FV<double>();
+    FlatVector<> ff = tmp_vecs[finelevel]->FV<double>();
+    ff = fv.Range(0, ff.Size());
+    prol_mats[finelevel]->MultTrans(*tmp_vecs[finelevel], *tmp_vecs[finelevel-1]);
+    fv = 0.0;
+    fv.Range(0, fc.Size()) = fc;
     #endif
   }
-  
 
-}
 
+  shared_ptr<SparseMatrix<double>> GalerkinProjection (const SparseMatrix<double> & A,
+                                                       const SparseMatrix<double> & P)
+  {
+    static Timer t("GalerkinProjection"); RegionTimer r(t);
+    if (dynamic_cast<const SparseMatrixSymmetric<double>*>(&A))
+      throw Exception("GalerkinProjection: symmetric matrix storage not supported");
+    if (A.Height() != P.Height() || A.Width() != P.Height())
+      throw Exception("GalerkinProjection: dimensions of A and P do not fit");
+    size_t nf = P.Height();
+    size_t nc = P.Width();
+
+    // transpose of P: fine dofs that contribute to a coarse dof
+    TableCreator<int> creator(nc);
+    for ( ; !creator.Done(); creator++)
+      ParallelFor (nf, [&] (size_t k)
+      {
+        for (auto i : P.GetRowIndices(k))
+          creator.Add(i, k);
+      });
+    Table<int> pt = creator.MoveTable();
+    ParallelFor (nc, [&] (size_t i)
+    {
+      QuickSort (pt[i]);
+    });
+
+    // row i of P^T A P: sum_k P(k,i) sum_l A(k,l) P(l,:)
+    Array<int> elsperrow(nc);
+    ParallelForRange (nc, [&] (IntRange myrange)
+    {
+      Array<int> marker(nc);
+      marker = -1;
+      for (auto i : myrange)
+      {
+        int cnt = 0;
+        for (auto k : pt[i])
+          for (auto l : A.GetRowIndices(k))
+            for (auto j : P.GetRowIndices(l))
+              if (marker[j] != int(i))
+              {
+                marker[j] = i;
+                cnt++;
+              }
+        elsperrow[i] = cnt;
+      }
+    });
+
+    auto C = make_shared<SparseMatrix<double>>(elsperrow, nc);
+    ParallelForRange (nc, [&] (IntRange myrange)
+    {
+      Array<int> marker(nc);
+      marker = -1;
+      Vector<> sums(nc);
+      Array<int> cols;
+      for (auto i : myrange)
+      {
+        cols.SetSize0();
+        for (auto k : pt[i])
+        {
+          double pki = P(k,i);
+          auto acols = A.GetRowIndices(k);
+          auto avals = A.GetRowValues(k);
+          for (auto jl : Range(acols))
+          {
+            int l = acols[jl];
+            double pa = pki * avals(jl);
+            auto pcols = P.GetRowIndices(l);
+            auto pvals = P.GetRowValues(l);
+            for (auto jj : Range(pcols))
+            {
+              int j = pcols[jj];
+              if (marker[j] != int(i))
+              {
+                marker[j] = i;
+                sums(j) = 0.0;
+                cols.Append(j);
+              }
+              sums(j) += pa * pvals(jj);
+            }
+          }
+        }
+        QuickSort (cols);
+        for (auto j : cols)
+          (*C)(i,j) = sums(j);
+      }
+    });
+    return C;
+  }
+
+}
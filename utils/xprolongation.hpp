@@ -14,29 +14,41 @@ namespace ngmg
   {
     shared_ptr<MeshAccess> ma;
     Array<size_t> nvlevel;
-    //Array<size_t> ndoflevel;
-    Array<shared_ptr<VVector<double> > > tmp_vecs;
+    Array<size_t> ndoflevel;
     const FESpace* fes;
     Array<shared_ptr<Array<int>>> v2d_on_lvl;
+    // parent vertices of the vertices that are new on a level (offset nvlevel[level-1])
+    Array<shared_ptr<Array<INT<2>>>> parents_on_lvl;
+    // new vertices of a level that have the coarse vertex as parent (for restriction)
+    Array<shared_ptr<Table<int>>> children_on_lvl;
+    // values on the vertices of the coarse (prolongation) / fine (restriction) level
+    mutable Vector<double> tmp_vals;
+
+    void ProlongateVectors (int finelevel, FlatArray<BaseVector*> vecs) const;
+    void RestrictVectors (int finelevel, FlatArray<BaseVector*> vecs) const;
   public:
     P1Prolongation(shared_ptr<MeshAccess> ama)
       : ma(ama), fes(nullptr) 
       { 
-        tmp_vecs.SetSize(0); 
         nvlevel.SetSize(0);
+        ndoflevel.SetSize(0);
         v2d_on_lvl.SetSize(0);
+        parents_on_lvl.SetSize(0);
+        children_on_lvl.SetSize(0);
       }
     
     virtual ~P1Prolongation() { ; }
 
     virtual void Update (const FESpace & fes) override;
 
-    virtual SparseMatrix< double >* CreateProlongationMatrix( int finelevel ) const override
-    {
-      throw Exception("P1Prolongation::CreateProlongationMatrix not implemented!");
-    }
+    /// prolongation matrix (fine ndof x coarse ndof), inactive dofs have no entries
+    virtual SparseMatrix< double >* CreateProlongationMatrix( int finelevel ) const override;
     virtual void ProlongateInline (int finelevel, BaseVector & v) const override;
     virtual void RestrictInline (int finelevel, BaseVector & v) const override;
+
+    /// prolongate/restrict several vectors (same entry size) in one sweep
+    void ProlongateInline (int finelevel, FlatArray<shared_ptr<BaseVector>> vecs) const;
+    void RestrictInline (int finelevel, FlatArray<shared_ptr<BaseVector>> vecs) const;
   };
 
   class P2Prolongation : public Prolongation
@@ -44,10 +56,13 @@ namespace ngmg
     shared_ptr<MeshAccess> ma;
     Array<size_t> nVertLevel;
     Array<size_t> nEdgeLevel;
-    //Array<size_t> ndoflevel;
+    Array<size_t> ndoflevel;
     Array<shared_ptr<BaseVector>> tmp_vecs;
     const FESpace* fes;
-    // Array<shared_ptr<Array<int>>> v2d_on_lvl;
+    Array<shared_ptr<Array<int>>> v2d_on_lvl;
+    // vertices and dofs of all edges of a level (for the prolongation matrix)
+    Array<shared_ptr<Array<INT<2>>>> edges_on_lvl;
+    Array<shared_ptr<Array<int>>> e2d_on_lvl;
   public:
     P2Prolongation(shared_ptr<MeshAccess> ama)
       : ma(ama), fes(nullptr) 
@@ -61,10 +76,8 @@ namespace ngmg
 
     virtual void Update (const FESpace & fes) override;
 
-    virtual SparseMatrix< double >* CreateProlongationMatrix( int finelevel ) const override
-    {
-      throw Exception("P2Prolongation::CreateProlongationMatrix not implemented!");
-    }
+    /// prolongation matrix (fine ndof x coarse ndof), inactive dofs have no entries
+    virtual SparseMatrix< double >* CreateProlongationMatrix( int finelevel ) const override;
     virtual void ProlongateInline (int finelevel, BaseVector & v) const override;
     virtual void RestrictInline (int finelevel, BaseVector & v) const override;
   };
@@ -75,10 +88,15 @@ namespace ngmg
     shared_ptr<MeshAccess> ma;
     Array<size_t> nVertLevel;
     Array<size_t> nEdgeLevel;
-    //Array<size_t> ndoflevel;
+    Array<size_t> ndoflevel;
     Array<shared_ptr<BaseVector>> tmp_vecs;
     const FESpace* fes;
     Array<shared_ptr<Array<int>>> v2d_on_lvl;
+    // vertices and dofs of all edges of a level (for the prolongation matrix)
+    Array<shared_ptr<Array<INT<2>>>> edges_on_lvl;
+    Array<shared_ptr<Array<int>>> e2d_on_lvl;
+    // prolongation matrices (to level i), used by Prolongate/RestrictInline
+    Array<shared_ptr<SparseMatrix<double>>> prol_mats;
   public:
     P2CutProlongation(shared_ptr<MeshAccess> ama)
       : ma(ama), fes(nullptr) 
@@ -92,12 +110,15 @@ namespace ngmg
 
     virtual void Update (const FESpace & fes) override;
 
-    virtual SparseMatrix< double >* CreateProlongationMatrix( int finelevel ) const override
-    {
-      throw Exception("P2Prolongation::CreateProlongationMatrix not implemented!");
-    }
+    /// prolongation matrix (fine ndof x coarse ndof), inactive dofs have no entries
+    virtual SparseMatrix< double >* CreateProlongationMatrix( int finelevel ) const override;
     virtual void ProlongateInline (int finelevel, BaseVector & v) const override;
     virtual void RestrictInline (int finelevel, BaseVector & v) const override;
   };
 
+
+  /// Galerkin product P^T A P (A with non-symmetric storage), computed in parallel
+  shared_ptr<SparseMatrix<double>> GalerkinProjection (const SparseMatrix<double> & A,
+                                                       const SparseMatrix<double> & P);
+
 }
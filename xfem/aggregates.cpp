@@ -0,0 +1,332 @@
+/// from ngxfem
+#include "../xfem/aggregates.hpp"
+#include "../utils/ngsxstd.hpp"
+using namespace ngsolve;
+using namespace ngfem;
+
+namespace ngcomp
+{
+
+  ElementAggregation::ElementAggregation (shared_ptr<MeshAccess> ama)
+    : ma(ama)
+  {
+    int ne = ma->GetNE(VOL);
+    root_elements = make_shared<BitArray>(ne);
+    bad_elements = make_shared<BitArray>(ne);
+    root_elements->Clear();
+    bad_elements->Clear();
+    element_to_root.SetSize(ne);
+    element_to_root = -1;
+  }
+
+  void ElementAggregation::Update (shared_ptr<CutInformation> cutinfo, DOMAIN_TYPE dt,
+                                   double threshold, LocalHeap & lh)
+  {
+    static Timer t("ElementAggregation::Update");
+    RegionTimer reg(t);
+
+    if (dt == IF)
+      throw Exception("ElementAggregation: domain type has to be NEG or POS");
+
+    int ne = ma->GetNE(VOL);
+    root_elements->SetSize(ne);
+    bad_elements->SetSize(ne);
+    element_to_root.SetSize(ne);
+    element_to_root = -1;
+
+    shared_ptr<BitArray> cut_elements = cutinfo->GetElementsOfDomainType(IF,VOL);
+    shared_ptr<BitArray> active_elements = cutinfo->GetElementsOfDomainType(dt == NEG ? CDOM_HASNEG : CDOM_HASPOS,VOL);
+    FlatVector<> cut_ratios = cutinfo->GetCutRatios(VOL)->FV<double>();
+
+    // ratio of the element in the domain dt
+    auto ratio = [&] (int elnr) { return dt == NEG ? cut_ratios(elnr) : 1.0 - cut_ratios(elnr); };
+
+    ParallelFor (ne, [&] (size_t elnr)
+    {
+      if (active_elements->Test(elnr) && (!cut_elements->Test(elnr) || ratio(elnr) >= threshold))
+        element_to_root[elnr] = elnr;
+    });
+
+    // attach bad elements layer by layer to the root of the best cut neighbor
+    // that already has a root
+    Array<int> bad_elnrs;
+    for (int elnr = 0; elnr < ne; elnr++)
+      if (active_elements->Test(elnr) && element_to_root[elnr] == -1)
+        bad_elnrs.Append(elnr);
+
+    Array<int> new_root(bad_elnrs.Size());
+    n_layers = 0;
+    bool changed = true;
+    while (changed)
+    {
+      changed = false;
+      IterateRange
+        (bad_elnrs.Size(), lh,
+        [&] (int i, LocalHeap & lh)
+      {
+        int elnr = bad_elnrs[i];
+        new_root[i] = element_to_root[elnr];
+        if (new_root[i] != -1)
+          return;
+        double best_ratio = -1.0;
+        Array<int> fanums(0,lh);
+        Array<int> elnums(0,lh);
+        fanums = ma->GetElFacets (ElementId(VOL,elnr));
+        for (int fanr : fanums)
+        {
+          ma->GetFacetElements (fanr, elnums);
+          for (int elnr2 : elnums)
+            if (elnr2 != elnr && element_to_root[elnr2] != -1 && ratio(elnr2) > best_ratio)
+            {
+              best_ratio = ratio(elnr2);
+              new_root[i] = element_to_root[elnr2];
+            }
+        }
+      });
+      for (int i : Range(bad_elnrs))
+        if (new_root[i] != element_to_root[bad_elnrs[i]])
+        {
+          element_to_root[bad_elnrs[i]] = new_root[i];
+          changed = true;
+        }
+      if (changed)
+        n_layers++;
+    }
+
+    root_elements->Clear();
+    bad_elements->Clear();
+    int n_isolated = 0;
+    for (int elnr = 0; elnr < ne; elnr++)
+    {
+      if (!active_elements->Test(elnr))
+        continue;
+      if (element_to_root[elnr] == -1)
+      {
+        // no well cut element in the connected component: element is its own root
+        element_to_root[elnr] = elnr;
+        n_isolated++;
+      }
+      if (element_to_root[elnr] == elnr)
+        root_elements->Set(elnr);
+      else
+        bad_elements->Set(elnr);
+    }
+    if (n_isolated > 0)
+      cout << IM(3) << "ElementAggregation: " << n_isolated << " badly cut elements without well cut neighbors" << endl;
+  }
+
+  // maps the reference point ip of trafo_from to the reference coordinates
+  // w.r.t. trafo_to (the point can be outside of the element of trafo_to)
+  template <int D>
+  IntegrationPoint MapToNeighborElement(const IntegrationPoint & ip,
+                                        const ElementTransformation & trafo_from,
+                                        const ElementTransformation & trafo_to)
+  {
+    MappedIntegrationPoint<D,D> mip(ip, trafo_from);
+    Vec<D> x = mip.GetPoint();
+
+    // initial guess from the affine map of the vertices (exact for straight elements)
+    IntegrationPoint ip0(0.,0.,0.);
+    MappedIntegrationPoint<D,D> mip0(ip0, trafo_to);
+    Mat<D,D> A;
+    for (int d = 0; d < D; d++)
+    {
+      IntegrationPoint ipd(0.,0.,0.);
+      ipd(d) = 1.0;
+      MappedIntegrationPoint<D,D> mipd(ipd, trafo_to);
+      A.Col(d) = mipd.GetPoint() - mip0.GetPoint();
+    }
+    Vec<D> xhat = Inv(A) * (x - mip0.GetPoint());
+    IntegrationPoint ip_to(0.,0.,0.);
+    for (int d = 0; d < D; d++)
+      ip_to(d) = xhat(d);
+
+    // Newton for curved elements
+    const double h = pow(abs(Det(A)),1.0/D);
+    for (int its = 0; its < 20; its++)
+    {
+      MappedIntegrationPoint<D,D> mip_to(ip_to, trafo_to);
+      Vec<D> diff = x - mip_to.GetPoint();
+      if (L2Norm(diff) <= 1e-12 * h)
+        break;
+      Vec<D> update = mip_to.GetJacobianInverse() * diff;
+      for (int d = 0; d < D; d++)
+        ip_to(d) += update(d);
+    }
+    return ip_to;
+  }
+
+  // extension matrix E of the root element to the bad element: the coefficients of the
+  // function sum_j c_j phi_j^root (extended to the bad element) w.r.t. the basis
+  // of the bad element are E c (L2 projection on the bad element, exact for polynomials)
+  template <int D>
+  void CalcExtensionMatrix(const BaseScalarFiniteElement & fel_bad, const ElementTransformation & trafo_bad,
+                           const BaseScalarFiniteElement & fel_root, const ElementTransformation & trafo_root,
+                           FlatMatrix<> ext, LocalHeap & lh)
+  {
+    HeapReset hr(lh);
+    const int ndof_bad = fel_bad.GetNDof();
+    const int ndof_root = fel_root.GetNDof();
+    IntegrationRule ir(trafo_bad.GetElementType(), 2*max2(fel_bad.Order(),fel_root.Order()));
+
+    FlatMatrix<> mass(ndof_bad, ndof_bad, lh);
+    FlatMatrix<> mixed(ndof_bad, ndof_root, lh);
+    FlatVector<> shape_bad(ndof_bad, lh);
+    FlatVector<> shape_root(ndof_root, lh);
+    mass = 0.0;
+    mixed = 0.0;
+    for (auto & ip : ir)
+    {
+      IntegrationPoint ip_root = MapToNeighborElement<D>(ip, trafo_bad, trafo_root);
+      fel_bad.CalcShape(ip, shape_bad);
+      fel_root.CalcShape(ip_root, shape_root);
+      mass += ip.Weight() * shape_bad * Trans(shape_bad);
+      mixed += ip.Weight() * shape_bad * Trans(shape_root);
+    }
+    CalcInverse(mass);
+    ext = mass * mixed;
+  }
+
+  shared_ptr<SparseMatrix<double>> AggregationEmbedding(shared_ptr<FESpace> fes,
+                                                        const ElementAggregation & aggregation,
+                                                        shared_ptr<BitArray> freedofs,
+                                                        LocalHeap & lh)
+  {
+    static Timer t("AggregationEmbedding");
+    RegionTimer reg(t);
+
+    shared_ptr<MeshAccess> ma = fes->GetMeshAccess();
+    const int D = ma->GetDimension();
+    const int ne = ma->GetNE(VOL);
+    const size_t ndof = fes->GetNDof();
+    shared_ptr<BitArray> root_elements = aggregation.GetRootElements();
+    shared_ptr<BitArray> bad_elements = aggregation.GetBadElements();
+
+    // well-posed dofs: free dofs of root elements
+    shared_ptr<BitArray> wellposed = GetDofsOfElements(fes, root_elements, lh);
+    if (freedofs)
+      wellposed->And(*freedofs);
+
+    Array<int> reduced_nr(ndof);
+    int nreduced = 0;
+    for (size_t dof = 0; dof < ndof; dof++)
+      reduced_nr[dof] = wellposed->Test(dof) ? nreduced++ : -1;
+
+    // ill-posed dofs: free dofs that are only supported on bad elements. Every
+    // such dof is extended from the bad element with smallest number.
+    Array<int> owner(ndof);
+    owner = -1;
+    Array<int> bad_elnrs;
+    {
+      Array<DofId> dnums;
+      for (int elnr = 0; elnr < ne; elnr++)
+      {
+        if (!bad_elements->Test(elnr))
+          continue;
+        bool owns_dofs = false;
+        fes->GetDofNrs(ElementId(VOL,elnr), dnums);
+        for (auto dof : dnums)
+          if (IsRegularDof(dof) && !wellposed->Test(dof) && owner[dof] == -1
+              && (!freedofs || freedofs->Test(dof)))
+          {
+            owner[dof] = elnr;
+            owns_dofs = true;
+          }
+        if (owns_dofs)
+          bad_elnrs.Append(elnr);
+      }
+    }
+
+    // extension matrices of the bad elements that own ill-posed dofs
+    Array<int> cnt_ext(bad_elnrs.Size());
+    IterateRange
+      (bad_elnrs.Size(), lh,
+      [&] (int i, LocalHeap & lh)
+    {
+      ElementId ei_bad(VOL,bad_elnrs[i]);
+      ElementId ei_root(VOL,aggregation.GetRootOfElement(bad_elnrs[i]));
+      cnt_ext[i] = fes->GetFE(ei_bad,lh).GetNDof() * fes->GetFE(ei_root,lh).GetNDof();
+    });
+    Table<double> extensions(cnt_ext);
+
+    IterateRange
+      (bad_elnrs.Size(), lh,
+      [&] (int i, LocalHeap & lh)
+    {
+      ElementId ei_bad(VOL,bad_elnrs[i]);
+      ElementId ei_root(VOL,aggregation.GetRootOfElement(bad_elnrs[i]));
+      const FiniteElement & fel_bad = fes->GetFE(ei_bad,lh);
+      const FiniteElement & fel_root = fes->GetFE(ei_root,lh);
+      auto scafe_bad = dynamic_cast<const BaseScalarFiniteElement*>(&fel_bad);
+      auto scafe_root = dynamic_cast<const BaseScalarFiniteElement*>(&fel_root);
+      if (!scafe_bad || !scafe_root)
+        throw Exception("AggregationEmbedding: only scalar finite element spaces are supported");
+      ElementTransformation & trafo_bad = ma->GetTrafo(ei_bad,lh);
+      ElementTransformation & trafo_root = ma->GetTrafo(ei_root,lh);
+      FlatMatrix<> ext(fel_bad.GetNDof(), fel_root.GetNDof(), &extensions[i][0]);
+      if (D == 2)
+        CalcExtensionMatrix<2>(*scafe_bad, trafo_bad, *scafe_root, trafo_root, ext, lh);
+      else
+        CalcExtensionMatrix<3>(*scafe_bad, trafo_bad, *scafe_root, trafo_root, ext, lh);
+    });
+
+    // assemble the embedding matrix: identity rows for the well-posed dofs, the
+    // rows of the ill-posed dofs are set up per owning bad element
+    Array<int> elsperrow(ndof);
+    ParallelFor (ndof, [&] (size_t dof)
+    {
+      elsperrow[dof] = reduced_nr[dof] != -1 ? 1 : 0;
+    });
+
+    // calls f(elnr, dnums_bad, dnums_root, ext) for all bad elements owning ill-posed dofs
+    auto IterateBadElements = [&] (auto f)
+    {
+      IterateRange
+        (bad_elnrs.Size(), lh,
+        [&] (int i, LocalHeap & lh)
+      {
+        int elnr = bad_elnrs[i];
+        Array<DofId> dnums_bad(0,lh), dnums_root(0,lh);
+        fes->GetDofNrs(ElementId(VOL,elnr), dnums_bad);
+        fes->GetDofNrs(ElementId(VOL,aggregation.GetRootOfElement(elnr)), dnums_root);
+        FlatMatrix<> ext(dnums_bad.Size(), dnums_root.Size(), &extensions[i][0]);
+        f(elnr, dnums_bad, dnums_root, ext);
+      });
+    };
+
+    IterateBadElements([&] (int elnr, FlatArray<DofId> dnums_bad, FlatArray<DofId> dnums_root,
+                            FlatMatrix<> ext)
+    {
+      int cnt = 0;
+      for (auto rdof : dnums_root)
+        if (IsRegularDof(rdof) && reduced_nr[rdof] != -1)
+          cnt++;
+      for (auto dof : dnums_bad)
+        if (IsRegularDof(dof) && owner[dof] == elnr)
+          elsperrow[dof] = cnt;
+    });
+
+    auto embedding = make_shared<SparseMatrix<double>>(elsperrow, nreduced);
+    ParallelFor (ndof, [&] (size_t dof)
+    {
+      if (reduced_nr[dof] != -1)
+        (*embedding)(dof, reduced_nr[dof]) = 1.0;
+    });
+    // (every ill-posed dof has exactly one owner, so the rows are written once)
+    IterateBadElements([&] (int elnr, FlatArray<DofId> dnums_bad, FlatArray<DofId> dnums_root,
+                            FlatMatrix<> ext)
+    {
+      for (int row : Range(dnums_bad))
+      {
+        DofId dof = dnums_bad[row];
+        if (!IsRegularDof(dof) || owner[dof] != elnr)
+          continue;
+        for (int j : Range(dnums_root))
+          if (IsRegularDof(dnums_root[j]) && reduced_nr[dnums_root[j]] != -1)
+            (*embedding)(dof, reduced_nr[dnums_root[j]]) = ext(row,j);
+      }
+    });
+    return embedding;
+  }
+
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+/// from ngsolve
+#include <solve.hpp>
+#include <comp.hpp>
+#include <fem.hpp>
+
+/// from ngxfem
+#include "../xfem/cutinfo.hpp"
+
+using namespace ngsolve;
+
+namespace ngcomp
+{
+
+  // Cell aggregation as an alternative to ghost penalty stabilization:
+  // Elements of the active mesh (elements with a part in the domain) with a
+  // small cut ratio ("bad" elements) are agglomerated with a (not necessarily
+  // direct) neighbor that is well cut ("root" element). The unknowns that
+  // are only supported on bad elements are then constrained by the extension
+  // of the finite element function from the root element, see
+  // AggregationEmbedding.
+  class ElementAggregation
+  {
+  protected:
+    shared_ptr<MeshAccess> ma;
+    // well cut (or uncut) elements of the active mesh
+    shared_ptr<BitArray> root_elements = nullptr;
+    // badly cut elements that are attached to a root element
+    shared_ptr<BitArray> bad_elements = nullptr;
+    // root element of every element (-1 for elements not in the active mesh)
+    Array<int> element_to_root;
+    int n_layers = 0;
+  public:
+    ElementAggregation (shared_ptr<MeshAccess> ama);
+    void Update (shared_ptr<CutInformation> cutinfo, DOMAIN_TYPE dt,
+                 double threshold, LocalHeap & lh);
+
+    shared_ptr<MeshAccess> GetMesh () const { return ma; }
+    shared_ptr<BitArray> GetRootElements () const { return root_elements; }
+    shared_ptr<BitArray> GetBadElements () const { return bad_elements; }
+    int GetRootOfElement (int elnr) const { return element_to_root[elnr]; }
+    FlatArray<int> GetElementToRoot () const { return element_to_root; }
+    // number of neighbor layers that were needed to attach all bad elements
+    int GetNLayers () const { return n_layers; }
+  };
+
+  // Sparse embedding (prolongation) P from the reduced space to the full space fes.
+  // The reduced unknowns are the free dofs of root elements. Free dofs that are only
+  // supported on bad elements are expressed by the extension of the finite element
+  // function of the corresponding root element. Other dofs get a zero row.
+  // The reduced problem is P^T A P x = P^T f with the solution u = P x.
+  // Only scalar spaces are supported.
+  shared_ptr<SparseMatrix<double>> AggregationEmbedding(shared_ptr<FESpace> fes,
+                                                        const ElementAggregation & aggregation,
+                                                        shared_ptr<BitArray> freedofs,
+                                                        LocalHeap & lh);
+
+}
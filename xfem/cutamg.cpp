@@ -0,0 +1,488 @@
+/// from ngxfem
+#include "../xfem/cutamg.hpp"
+#include "../utils/xprolongation.hpp"
+#include "../utils/ngsxstd.hpp"
+using namespace ngsolve;
+using namespace ngfem;
+
+namespace ngcomp
+{
+
+  // dof data of the dofs of an XFESpace (offset in the system). If the base space is part of the
+  // system (at base_offset), the extended dofs are attached to their base dofs and the base dofs
+  // get the side that they represent.
+  static void GetXFESpaceDofData (XFESpace & xfes, size_t offset, int base_offset, int tag,
+                                  FlatArray<int> tags, FlatArray<double> weights,
+                                  FlatArray<int> basedofs, FlatArray<DOMAIN_TYPE> sides)
+  {
+    size_t ndof = xfes.GetNDof();
+    auto cutinfo = xfes.GetCutInfo();
+    if (base_offset >= 0 && cutinfo)
+    {
+      // base dofs without extended dof are on uncut elements only
+      Array<int> dnums;
+      for (DOMAIN_TYPE dt : { NEG, POS })
+        for (auto elnr : cutinfo->GetElementIndicesOfDomainType(TO_CDT(dt), VOL))
+        {
+          xfes.GetBaseFESpace()->GetDofNrs(ElementId(VOL,elnr), dnums);
+          for (auto d : dnums)
+            if (IsRegularDof(d) && xfes.GetXDofOfBaseDof(d) == -1)
+              sides[base_offset+d] = dt;
+        }
+    }
+
+    for (size_t i = 0; i < ndof; i++)
+    {
+      tags[offset+i] = tag;
+      sides[offset+i] = xfes.GetDomOfDof(i);
+      weights[offset+i] = cutinfo ? 0.0 : 1.0;
+      if (base_offset >= 0)
+      {
+        // u = u_base + u_x on the side of the extended dof, so the base dof represents the other side
+        basedofs[offset+i] = base_offset + xfes.GetBaseDofOfXDof(i);
+        sides[basedofs[offset+i]] = INVERT(xfes.GetDomOfDof(i));
+      }
+    }
+    if (!cutinfo)
+      return;
+
+    // cut ratio of an element is the ratio of the NEG part
+    auto ratios = cutinfo->GetCutRatios(VOL)->FVDouble();
+    Array<int> dnums;
+    for (auto elnr : cutinfo->GetElementIndicesOfDomainType(CDOM_IF, VOL))
+    {
+      xfes.GetDofNrs(ElementId(VOL,elnr), dnums);
+      for (auto d : dnums)
+      {
+        if (!IsRegularDof(d)) continue;
+        double r = xfes.GetDomOfDof(d) == NEG ? ratios(elnr) : 1.0 - ratios(elnr);
+        weights[offset+d] = max2(weights[offset+d], r);
+      }
+    }
+  }
+
+  void GetCutAMGDofData (shared_ptr<FESpace> fes, Array<int> & tags, Array<double> & weights,
+                         Array<int> & basedofs, Array<DOMAIN_TYPE> & sides)
+  {
+    size_t ndof = fes->GetNDof();
+    tags.SetSize(ndof);
+    weights.SetSize(ndof);
+    basedofs.SetSize(ndof);
+    sides.SetSize(ndof);
+    tags = 0;
+    weights = 1.0;
+    basedofs = -1;
+    sides = NEG;
+
+    auto compound = dynamic_pointer_cast<CompoundFESpace>(fes);
+    if (!compound)
+    {
+      if (auto xfes = dynamic_pointer_cast<XFESpace>(fes))
+        GetXFESpaceDofData (*xfes, 0, -1, 0, tags, weights, basedofs, sides);
+      return;
+    }
+
+    for (int c = 0; c < compound->GetNSpaces(); c++)
+    {
+      IntRange r = compound->GetRange(c);
+      if (auto xfes = dynamic_pointer_cast<XFESpace>((*compound)[c]))
+      {
+        // extended dofs get the tag of their base space component (if it is part of the system)
+        int cbase = -1;
+        for (int cb = 0; cb < compound->GetNSpaces(); cb++)
+          if ((*compound)[cb] == xfes->GetBaseFESpace())
+            cbase = cb;
+        if (cbase == -1)
+          GetXFESpaceDofData (*xfes, r.First(), -1, c, tags, weights, basedofs, sides);
+        else
+          GetXFESpaceDofData (*xfes, r.First(), compound->GetRange(cbase).First(), cbase,
+                              tags, weights, basedofs, sides);
+      }
+      else
+        for (auto i : r)
+          tags[i] = c;
+    }
+  }
+
+
+  // values of the near-nullspace vectors, the constants on the NEG and on the POS side,
+  // in a dof. An extended dof (with base dof) corrects the value of its base dof on its side.
+  INLINE void NearNullspaceValues (bool xdof, DOMAIN_TYPE side, double & negval, double & posval)
+  {
+    if (xdof)
+    {
+      negval = side == NEG ? 1.0 : -1.0;
+      posval = -negval;
+    }
+    else
+    {
+      negval = side == NEG ? 1.0 : 0.0;
+      posval = 1.0 - negval;
+    }
+  }
+
+
+  // Aggregation of the free dofs in four phases:
+  // 1. dofs (with a weight >= weak_threshold) whose strong neighbours are all
+  //    unaggregated form an aggregate with these neighbours,
+  // 2. unaggregated dofs join the aggregate of their strongest (strong)
+  //    neighbour from phase 1,
+  // 3. the remaining dofs form new aggregates with their unaggregated strong
+  //    neighbours,
+  // 4. dofs with a base dof (extended dofs) join the aggregate of their base dof.
+  // Phases 1 and 3 are greedy and serial, phases 2 and 4 run in parallel.
+  // Returns the number of aggregates, agg[i] = -1 for non-free dofs.
+  template <typename TSTRONG>
+  static size_t Aggregate (const SparseMatrix<double> & A, const BitArray & free,
+                           FlatArray<double> weights, FlatArray<int> basedofs,
+                           double weak_threshold, TSTRONG IsStrong, Array<int> & agg)
+  {
+    static Timer t("CutAMG::Aggregate"); RegionTimer r(t);
+    size_t n = A.Height();
+    agg.SetSize(n);
+    agg = -1;
+    size_t nagg = 0;
+
+    auto Aggregated = [&] (size_t i) { return !free.Test(i) || basedofs[i] != -1; };
+    auto IsStrongAgg = [&] (size_t i, int j, double aij) { return basedofs[j] == -1 && IsStrong(i,j,aij); };
+
+    // phase 1
+    for (size_t i = 0; i < n; i++)
+    {
+      if (Aggregated(i) || weights[i] < weak_threshold) continue;
+      auto cols = A.GetRowIndices(i);
+      auto vals = A.GetRowValues(i);
+      bool has_strong = false, all_free = true;
+      for (auto k : Range(cols))
+        if (IsStrongAgg(i,cols[k],vals(k)))
+        {
+          has_strong = true;
+          if (agg[cols[k]] != -1) { all_free = false; break; }
+        }
+      if (!has_strong || !all_free) continue;
+      agg[i] = nagg;
+      for (auto k : Range(cols))
+        if (IsStrongAgg(i,cols[k],vals(k)))
+          agg[cols[k]] = nagg;
+      nagg++;
+    }
+
+    // phase 2
+    Array<int> agg1(agg);
+    ParallelFor (n, [&] (size_t i)
+    {
+      if (Aggregated(i) || agg1[i] != -1) return;
+      auto cols = A.GetRowIndices(i);
+      auto vals = A.GetRowValues(i);
+      double maxval = 0;
+      int best = -1;
+      for (auto k : Range(cols))
+      {
+        int j = cols[k];
+        if (agg1[j] != -1 && IsStrongAgg(i,j,vals(k)) && fabs(vals(k)) > maxval)
+        {
+          maxval = fabs(vals(k));
+          best = j;
+        }
+      }
+      if (best != -1)
+        agg[i] = agg1[best];
+    });
+
+    // phase 3
+    for (size_t i = 0; i < n; i++)
+    {
+      if (Aggregated(i) || agg[i] != -1) continue;
+      agg[i] = nagg;
+      auto cols = A.GetRowIndices(i);
+      auto vals = A.GetRowValues(i);
+      for (auto k : Range(cols))
+        if (agg[cols[k]] == -1 && IsStrongAgg(i,cols[k],vals(k)))
+          agg[cols[k]] = nagg;
+      nagg++;
+    }
+
+    // phase 4 (extended dofs of non-free base dofs form their own aggregates)
+    ParallelFor (n, [&] (size_t i)
+    {
+      if (free.Test(i) && basedofs[i] != -1)
+        agg[i] = agg[basedofs[i]];
+    });
+    for (size_t i = 0; i < n; i++)
+      if (free.Test(i) && basedofs[i] != -1 && agg[i] == -1)
+        agg[i] = nagg++;
+    return nagg;
+  }
+
+
+  CutAMG :: CutAMG (shared_ptr<SparseMatrix<double>> amat,
+                    shared_ptr<BitArray> afreedofs,
+                    FlatArray<int> atags,
+                    FlatArray<double> aweights,
+                    FlatArray<int> abasedofs,
+                    FlatArray<DOMAIN_TYPE> asides,
+                    double theta,
+                    double weak_threshold,
+                    size_t coarsesize,
+                    int maxlevels,
+                    int anu)
+    : nu(anu)
+  {
+    static Timer t("CutAMG::CutAMG"); RegionTimer r(t);
+    if (dynamic_pointer_cast<SparseMatrixSymmetric<double>>(amat))
+      throw Exception("CutAMG: symmetric matrix storage not supported");
+    size_t ndof = amat->Height();
+    if (atags.Size() != ndof || aweights.Size() != ndof || abasedofs.Size() != ndof || asides.Size() != ndof)
+      throw Exception("CutAMG: dof data does not fit to the matrix");
+    if (!afreedofs)
+    {
+      afreedofs = make_shared<BitArray>(ndof);
+      afreedofs->Set();
+    }
+
+    mats.Append(amat);
+    freedofs.Append(afreedofs);
+    Array<int> tags(ndof);
+    Array<double> weights(ndof);
+    Array<int> basedofs(ndof);
+    Array<DOMAIN_TYPE> sides(ndof);
+    for (size_t i = 0; i < ndof; i++)
+    {
+      tags[i] = atags[i];
+      weights[i] = aweights[i];
+      basedofs[i] = abasedofs[i];
+      sides[i] = asides[i];
+    }
+    Array<double> diag, dfilt, rho;
+    Array<int> agg, cnr;
+
+    while (mats.Size() < size_t(maxlevels) && mats.Last()->Height() > coarsesize)
+    {
+      const SparseMatrix<double> & A = *mats.Last();
+      const BitArray & free = *freedofs.Last();
+      size_t n = A.Height();
+
+      diag.SetSize(n);
+      ParallelFor (n, [&] (size_t i)
+      {
+        diag[i] = 0.0;
+        auto cols = A.GetRowIndices(i);
+        auto vals = A.GetRowValues(i);
+        for (auto k : Range(cols))
+          if (size_t(cols[k]) == i)
+            diag[i] = vals(k);
+      });
+
+      // couplings of free dofs with the same tag; all couplings of weak dofs
+      // (small cut ratio) are strong, so that they are attached to and
+      // interpolated from their (e.g. ghost penalty) neighbours
+      auto IsStrong = [&] (size_t i, int j, double aij)
+      {
+        if (size_t(j) == i || !free.Test(j) || tags[j] != tags[i] || aij == 0.0)
+          return false;
+        if (weights[i] < weak_threshold || weights[j] < weak_threshold)
+          return true;
+        return fabs(aij) >= theta * sqrt(fabs(diag[i]*diag[j]));
+      };
+
+      size_t nagg = Aggregate (A, free, weights, basedofs, weak_threshold, IsStrong, agg);
+
+      // tentative prolongation: the near-nullspace vectors restricted to the aggregates,
+      // coarse dof cnr[2*a+s] for aggregate a and side s if the restriction is non-zero
+      cnr.SetSize(2*nagg);
+      cnr = -1;
+      for (size_t i = 0; i < n; i++)
+      {
+        if (agg[i] == -1) continue;
+        double negval, posval;
+        NearNullspaceValues (basedofs[i] != -1, sides[i], negval, posval);
+        if (negval != 0.0) cnr[2*agg[i]] = 0;
+        if (posval != 0.0) cnr[2*agg[i]+1] = 0;
+      }
+      size_t nc = 0;
+      for (auto & c : cnr)
+        if (c != -1)
+          c = nc++;
+      if (nc == 0 || nc >= 0.9 * n)
+        break;
+      auto P0Row = [&] (size_t i, auto func)
+      {
+        double vals[2];
+        NearNullspaceValues (basedofs[i] != -1, sides[i], vals[0], vals[1]);
+        for (int k = 0; k < 2; k++)
+          if (vals[k] != 0.0)
+            func (cnr[2*agg[i]+k], vals[k]);
+      };
+
+      // filtered matrix: strong couplings only, the weak free couplings are lumped
+      // into the diagonal; Gershgorin bound for the spectral radius of D_F^{-1} A_F
+      dfilt.SetSize(n);
+      rho.SetSize(n);
+      ParallelFor (n, [&] (size_t i)
+      {
+        dfilt[i] = diag[i];
+        rho[i] = 0.0;
+        if (!free.Test(i)) return;
+        auto cols = A.GetRowIndices(i);
+        auto vals = A.GetRowValues(i);
+        double offdiag = 0;
+        for (auto k : Range(cols))
+        {
+          int j = cols[k];
+          if (size_t(j) == i || !free.Test(j)) continue;
+          if (IsStrong(i, j, vals(k)))
+            offdiag += fabs(vals(k));
+          else
+            dfilt[i] += vals(k);
+        }
+        if (dfilt[i] <= 0)
+          dfilt[i] = diag[i];
+        rho[i] = 1.0 + offdiag / fabs(dfilt[i]);
+      });
+      double maxrho = 0;
+      for (auto val : rho)
+        maxrho = max2(maxrho, val);
+      double omega = 4.0 / (3.0 * maxrho);
+
+      // smoothed prolongation P = (I - omega D_F^{-1} A_F) P_0
+      Array<int> elsperrow(n);
+      auto GetRow = [&] (size_t i, Array<int> & pcols, Array<double> & pvals)
+      {
+        pcols.SetSize0();
+        pvals.SetSize0();
+        if (agg[i] == -1) return;
+        auto Add = [&] (int c, double v)
+        {
+          int pos = pcols.Pos(c);
+          if (pos == -1)
+          {
+            pcols.Append(c);
+            pvals.Append(v);
+          }
+          else
+            pvals[pos] += v;
+        };
+        P0Row (i, [&] (int c, double v) { Add (c, (1.0 - omega) * v); });
+        auto cols = A.GetRowIndices(i);
+        auto vals = A.GetRowValues(i);
+        for (auto k : Range(cols))
+        {
+          int j = cols[k];
+          if (agg[j] != -1 && IsStrong(i, j, vals(k)))
+          {
+            double fac = -omega * vals(k) / dfilt[i];
+            P0Row (j, [&] (int c, double v) { Add (c, fac * v); });
+          }
+        }
+      };
+
+      ParallelForRange (n, [&] (IntRange myrange)
+      {
+        Array<int> pcols;
+        Array<double> pvals;
+        for (auto i : myrange)
+        {
+          GetRow(i, pcols, pvals);
+          elsperrow[i] = pcols.Size();
+        }
+      });
+      auto P = make_shared<SparseMatrix<double>>(elsperrow, nc);
+      ParallelForRange (n, [&] (IntRange myrange)
+      {
+        Array<int> pcols;
+        Array<double> pvals;
+        for (auto i : myrange)
+        {
+          GetRow(i, pcols, pvals);
+          for (auto k : Range(pcols))
+            (*P)(i, pcols[k]) = pvals[k];
+        }
+      });
+
+      // the near-nullspace vectors of the coarse level are the unit vectors of the sides
+      Array<int> ctags(nc);
+      Array<DOMAIN_TYPE> csides(nc);
+      for (size_t i = 0; i < n; i++)
+        if (agg[i] != -1)
+          for (int k = 0; k < 2; k++)
+            if (cnr[2*agg[i]+k] != -1)
+            {
+              ctags[cnr[2*agg[i]+k]] = tags[i];
+              csides[cnr[2*agg[i]+k]] = k == 0 ? NEG : POS;
+            }
+
+      prols.Append(P);
+      mats.Append(ngmg::GalerkinProjection(A, *P));
+      auto cfree = make_shared<BitArray>(nc);
+      cfree->Set();
+      freedofs.Append(cfree);
+      tags = std::move(ctags);
+      sides = std::move(csides);
+      weights.SetSize(nc);
+      weights = 1.0;
+      basedofs.SetSize(nc);
+      basedofs = -1;
+    }
+
+    int nlevels = mats.Size();
+    smoothers.SetSize(nlevels);
+    res.SetSize(nlevels);
+    rhs.SetSize(nlevels);
+    sol.SetSize(nlevels);
+    for (int l = 0; l < nlevels; l++)
+    {
+      size_t n = mats[l]->Height();
+      if (l < nlevels-1)
+      {
+        smoothers[l] = mats[l]->CreateJacobiPrecond(freedofs[l]);
+        res[l] = make_shared<VVector<double>>(n);
+      }
+      if (l > 0)
+      {
+        rhs[l] = make_shared<VVector<double>>(n);
+        sol[l] = make_shared<VVector<double>>(n);
+      }
+    }
+    coarseinv = mats.Last()->InverseMatrix(freedofs.Last());
+    multadd_tmp = make_shared<VVector<double>>(mats[0]->Height());
+  }
+
+
+  void CutAMG :: Cycle (int level, const BaseVector & f, BaseVector & u) const
+  {
+    if (level == int(mats.Size())-1)
+    {
+      u = (*coarseinv) * f;
+      return;
+    }
+
+    for (int k = 0; k < nu; k++)
+      smoothers[level]->GSSmooth(u, f);
+
+    BaseVector & r = *res[level];
+    r = f - (*mats[level]) * u;
+    prols[level]->MultTrans(r, *rhs[level+1]);
+    *sol[level+1] = 0.0;
+    Cycle (level+1, *rhs[level+1], *sol[level+1]);
+    prols[level]->MultAdd(1.0, *sol[level+1], u);
+
+    for (int k = 0; k < nu; k++)
+      smoothers[level]->GSSmoothBack(u, f);
+  }
+
+
+  void CutAMG :: Mult (const BaseVector & b, BaseVector & x) const
+  {
+    static Timer t("CutAMG::Mult"); RegionTimer r(t);
+    x = 0.0;
+    Cycle (0, b, x);
+  }
+
+
+  void CutAMG :: MultAdd (double s, const BaseVector & b, BaseVector & x) const
+  {
+    Mult (b, *multadd_tmp);
+    x += s * *multadd_tmp;
+  }
+
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+/// from ngsolve
+#include <solve.hpp>
+#include <comp.hpp>
+#include <fem.hpp>
+
+/// from ngxfem
+#include "../xfem/cutinfo.hpp"
+#include "../xfem/xFESpace.hpp"
+
+using namespace ngsolve;
+
+namespace ngcomp
+{
+
+  // Dof data for the aggregation of CutAMG. Dofs are only aggregated with dofs
+  // of the same tag, the tag is the index of the component of a (compound) space.
+  // Extended dofs of an XFESpace whose base space is a component of the system
+  // get the tag of the base component and their base dof (xdof2basedof) in
+  // basedofs (-1 for all other dofs), they are aggregated with their base dof.
+  // sides are the sides (NEG/POS) of the near-nullspace, i.e. the constants on
+  // each side: the side of an extended dof (domofdof) and the side that a base
+  // dof represents (the other side of its extended dof). The weight of an
+  // extended dof is the largest cut ratio (w.r.t. its side) of the cut elements
+  // it is supported on, all other dofs have weight 1.
+  void GetCutAMGDofData (shared_ptr<FESpace> fes, Array<int> & tags, Array<double> & weights,
+                         Array<int> & basedofs, Array<DOMAIN_TYPE> & sides);
+
+  /* ----------------------------------------
+     Smoothed aggregation AMG for (X)FEM and
+     ghost penalty systems on a single mesh:
+     strongly coupled free dofs of the same
+     tag are aggregated, extended dofs join
+     the aggregate of their base dof. The
+     tentative prolongation carries the
+     constants of both sides (one or two
+     coarse dofs per aggregate). All
+     couplings of dofs with a small weight
+     (small cut ratio) count as strong in
+     the prolongation smoother.
+     Level 0 is the finest level.
+     ---------------------------------------- */
+  class CutAMG : public BaseMatrix
+  {
+    Array<shared_ptr<SparseMatrix<double>>> mats;
+    /// prols[l] : level l+1 -> level l
+    Array<shared_ptr<SparseMatrix<double>>> prols;
+    Array<shared_ptr<BitArray>> freedofs;
+    Array<shared_ptr<BaseJacobiPrecond>> smoothers;
+    shared_ptr<BaseMatrix> coarseinv;
+    int nu;
+
+    /// preallocated vectors: residual (levels 0..L-1), rhs and solution (levels 1..L)
+    Array<shared_ptr<BaseVector>> res, rhs, sol;
+    /// result of Mult in MultAdd (level 0)
+    shared_ptr<BaseVector> multadd_tmp;
+
+    void Cycle (int level, const BaseVector & f, BaseVector & u) const;
+  public:
+    CutAMG (shared_ptr<SparseMatrix<double>> amat,
+            shared_ptr<BitArray> afreedofs,
+            FlatArray<int> tags,
+            FlatArray<double> weights,
+            FlatArray<int> basedofs,
+            FlatArray<DOMAIN_TYPE> sides,
+            double theta = 0.08,
+            double weak_threshold = 0.1,
+            size_t coarsesize = 500,
+            int maxlevels = 20,
+            int anu = 1);
+
+    virtual ~CutAMG () { ; }
+
+    virtual bool IsComplex () const override { return false; }
+    virtual int VHeight () const override { return mats[0]->Height(); }
+    virtual int VWidth () const override { return mats[0]->Width(); }
+    virtual AutoVector CreateVector () const override { return mats[0]->CreateVector(); }
+    virtual AutoVector CreateRowVector () const override { return mats[0]->CreateRowVector(); }
+    virtual AutoVector CreateColVector () const override { return mats[0]->CreateColVector(); }
+
+    virtual void Mult (const BaseVector & b, BaseVector & x) const override;
+    virtual void MultAdd (double s, const BaseVector & b, BaseVector & x) const override;
+
+    int GetNLevels () const { return mats.Size(); }
+    size_t GetNDof (int level) const { return mats[level]->Height(); }
+    shared_ptr<SparseMatrix<double>> GetMatrix (int level) const { return mats[level]; }
+  };
+
+}
@@ -17,6 +17,9 @@ namespace ngcomp
       elems_of_domain_type[cdt] = make_shared<BitArray>(ma->GetNE(VOL));
       selems_of_domain_type[cdt] = make_shared<BitArray>(ma->GetNE(BND));
       facets_of_domain_type[cdt] = make_shared<BitArray>(ma->GetNFacets());
+      elems_of_domain_type[cdt]->Clear();
+      selems_of_domain_type[cdt]->Clear();
+      facets_of_domain_type[cdt]->Clear();
     }
     facets_of_domain_type[NEG]->Set();
     facets_of_domain_type[POS]->Clear();
@@ -49,6 +52,19 @@ namespace ngcomp
       int ne = ma->GetNE(vb);
       cut_ratio_of_element[vb] = make_shared<VVector<double>>(ne);
     }
+    UpdateIndexLists();
+  }
+
+  void CutInformation::UpdateIndexLists()
+  {
+    static Timer t("CutInformation::UpdateIndexLists");
+    RegionTimer reg(t);
+    for (auto cdt : all_cdts)
+    {
+      BitArrayToIndices(*elems_of_domain_type[cdt], elems_of_domain_type_idx[cdt]);
+      BitArrayToIndices(*selems_of_domain_type[cdt], selems_of_domain_type_idx[cdt]);
+      BitArrayToIndices(*facets_of_domain_type[cdt], facets_of_domain_type_idx[cdt]);
+    }
   }
 
   void CutInformation::Update(shared_ptr<CoefficientFunction> cf_lset,int time_order, LocalHeap & lh)
@@ -93,21 +109,21 @@ namespace ngcomp
         {
           if (part_vol[NEG] > 0.0)
             if (part_vol[POS] > 0.0)
-              (*elems_of_domain_type[CDOM_IF]).Set(elnr);
+              (*elems_of_domain_type[CDOM_IF]).SetBitAtomic(elnr);
             else
-              (*elems_of_domain_type[CDOM_NEG]).Set(elnr);
+              (*elems_of_domain_type[CDOM_NEG]).SetBitAtomic(elnr);
           else
-            (*elems_of_domain_type[CDOM_POS]).Set(elnr);
+            (*elems_of_domain_type[CDOM_POS]).SetBitAtomic(elnr);
         }
         else
         {
           if (part_vol[NEG] > 0.0)
             if (part_vol[POS] > 0.0)
-              (*selems_of_domain_type[CDOM_IF]).Set(elnr);
+              (*selems_of_domain_type[CDOM_IF]).SetBitAtomic(elnr);
             else
-              (*selems_of_domain_type[CDOM_NEG]).Set(elnr);
+              (*selems_of_domain_type[CDOM_NEG]).SetBitAtomic(elnr);
           else
-            (*selems_of_domain_type[CDOM_POS]).Set(elnr);
+            (*selems_of_domain_type[CDOM_POS]).SetBitAtomic(elnr);
         }
 
       });
@@ -118,34 +134,36 @@ namespace ngcomp
       *selems_of_domain_type[CDOM_HASNEG] = *selems_of_domain_type[CDOM_NEG] | *selems_of_domain_type[CDOM_IF];
       *selems_of_domain_type[CDOM_HASPOS] = *selems_of_domain_type[CDOM_POS] | *selems_of_domain_type[CDOM_IF];
     }
+    UpdateIndexLists();
+
+    for (NODE_TYPE nt : {NT_VERTEX,NT_EDGE,NT_FACE,NT_CELL})
+      cut_neighboring_node[nt]->Clear();
 
+    // neighboring elements share nodes (and words of the BitArrays), hence atomic set
     int ne = ma -> GetNE();
-    IterateRange
-      (ne, lh,
+    IterateElementsOfDomainType
+      (CDOM_IF, VOL, lh,
       [&] (int elnr, LocalHeap & lh)
     {
-      if ((*elems_of_domain_type[CDOM_IF]).Test(elnr))
-      {
-        ElementId elid(VOL,elnr);
+      ElementId elid(VOL,elnr);
 
-        Array<int> nodenums(0,lh);
+      Array<int> nodenums(0,lh);
 
-        nodenums = ma->GetElVertices(elid);
-        for (int node : nodenums)
-          cut_neighboring_node[NT_VERTEX]->Set(node);
+      nodenums = ma->GetElVertices(elid);
+      for (int node : nodenums)
+        cut_neighboring_node[NT_VERTEX]->SetBitAtomic(node);
 
-        nodenums = ma->GetElEdges(elid);
-        for (int node : nodenums)
-          cut_neighboring_node[NT_EDGE]->Set(node);
+      nodenums = ma->GetElEdges(elid);
+      for (int node : nodenums)
+        cut_neighboring_node[NT_EDGE]->SetBitAtomic(node);
 
-        if (ma->GetDimension() == 3)
-        {
-          nodenums = ma->GetElFaces(elid.Nr());
-          for (int node : nodenums)
-            cut_neighboring_node[NT_FACE]->Set(node);
-        }
-        cut_neighboring_node[NT_ELEMENT]->Set(elnr);
+      if (ma->GetDimension() == 3)
+      {
+        nodenums = ma->GetElFaces(elid.Nr());
+        for (int node : nodenums)
+          cut_neighboring_node[NT_FACE]->SetBitAtomic(node);
       }
+      cut_neighboring_node[NT_ELEMENT]->SetBitAtomic(elnr);
     });
 
     for (NODE_TYPE nt : {NT_VERTEX,NT_EDGE,NT_FACE,NT_CELL})
@@ -200,27 +218,15 @@ namespace ngcomp
     shared_ptr<BitArray> ret = make_shared<BitArray> (nf);
     ret->Clear();
 
-    BitArray fine_facet(nf);
-    fine_facet.Clear();
-    IterateRange
-      (ma->GetNE(VOL), lh,
-      [&] (int elnr, LocalHeap & lh)
-    {
-      Array<int> fanums(0,lh);
-      fanums = ma->GetElFacets (ElementId(VOL,elnr));
-      for (int j=0; j<fanums.Size(); j++)
-        fine_facet.Set(fanums[j]);
-    });
-
     IterateRange
       (nf, lh,
       [&] (int facnr, LocalHeap & lh)
     {
-      if (fine_facet.Test(facnr))
+      Array<int> elnums(0,lh);
+      ma->GetFacetElements (facnr, elnums);
+      // facets without volume elements (e.g. of coarser levels) are skipped
+      if (elnums.Size() > 0)
       {
-        Array<int> elnums(0,lh);
-        ma->GetFacetElements (facnr, elnums);
-
         if(elnums.Size() < 2)
         {
           int facet2 = ma->GetPeriodicFacet(facnr);
@@ -242,12 +248,12 @@ namespace ngcomp
         if (ask_and)
         {
           if ((a_left && b_right) || (a_right && b_left))
-            ret->Set(facnr);
+            ret->SetBitAtomic(facnr);
         }
         else
         {
           if ((a_left || b_right) || (a_right || b_left))
-            ret->Set(facnr);
+            ret->SetBitAtomic(facnr);
         }
       }
     });
@@ -258,22 +264,20 @@ namespace ngcomp
                                                      shared_ptr<BitArray> a,
                                                      LocalHeap & lh)
   {
-    int nf = ma->GetNFacets();
     int ne = ma->GetNE();
     shared_ptr<BitArray> ret = make_shared<BitArray> (ne);
     ret->Clear();
 
-    IterateRange
-      (nf, lh,
+    Array<int> facnrs;
+    BitArrayToIndices(*a, facnrs);
+    IterateIndices
+      (facnrs, lh,
       [&] (int facnr, LocalHeap & lh)
     {
-      if (a->Test(facnr))
-      {
-        Array<int> elnums(0,lh);
-        ma->GetFacetElements (facnr, elnums);
-        for (auto elnr : elnums)
-          ret->Set(elnr);
-      }
+      Array<int> elnums(0,lh);
+      ma->GetFacetElements (facnr, elnums);
+      for (auto elnr : elnums)
+        ret->SetBitAtomic(elnr);
     });
     return ret;
   }
@@ -282,23 +286,21 @@ namespace ngcomp
                                          shared_ptr<BitArray> a,
                                          LocalHeap & lh)
   {
-    int ne = fes->GetMeshAccess()->GetNE();
     int ndof = fes->GetNDof();
     shared_ptr<BitArray> ret = make_shared<BitArray> (ndof);
     ret->Clear();
 
-    IterateRange
-      (ne, lh,
+    Array<int> elnrs;
+    BitArrayToIndices(*a, elnrs);
+    IterateIndices
+      (elnrs, lh,
       [&] (int elnr, LocalHeap & lh)
     {
       ElementId elid(VOL,elnr);
-      if (a->Test(elnr))
-      {
-        Array<int> dnums(0,lh);
-        fes->GetDofNrs(elid,dnums);
-        for (auto dof : dnums)
-          ret->Set(dof);
-      }
+      Array<int> dnums(0,lh);
+      fes->GetDofNrs(elid,dnums);
+      for (auto dof : dnums)
+        ret->SetBitAtomic(dof);
     });
     return ret;
   }
@@ -307,23 +309,21 @@ namespace ngcomp
                                        shared_ptr<BitArray> a,
                                        LocalHeap & lh)
   {
-    int nf = fes->GetMeshAccess()->GetNFacets();
     int ndof = fes->GetNDof();
     shared_ptr<BitArray> ret = make_shared<BitArray> (ndof);
     ret->Clear();
 
-    IterateRange
-      (nf, lh,
+    Array<int> fanrs;
+    BitArrayToIndices(*a, fanrs);
+    IterateIndices
+      (fanrs, lh,
       [&] (int fanr, LocalHeap & lh)
     {
       NodeId nodeid(NT_FACET,fanr);
-      if (a->Test(fanr))
-      {
-        Array<int> dnums(0,lh);
-        fes->GetDofNrs(nodeid,dnums);
-        for (auto dof : dnums)
-          ret->Set(dof);
-      }
+      Array<int> dnums(0,lh);
+      fes->GetDofNrs(nodeid,dnums);
+      for (auto dof : dnums)
+        ret->SetBitAtomic(dof);
     });
     return ret;
   }
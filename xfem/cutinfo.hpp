@@ -31,7 +31,13 @@ namespace ngcomp
                                                      nullptr, nullptr, nullptr};
     shared_ptr<Array<DOMAIN_TYPE>> dom_of_node [6] = {nullptr, nullptr, nullptr,
                                                       nullptr, nullptr, nullptr};
+    // sorted element/facet numbers of the BitArrays above
+    Array<int> elems_of_domain_type_idx [N_COMBINED_DOMAIN_TYPES];
+    Array<int> selems_of_domain_type_idx [N_COMBINED_DOMAIN_TYPES];
+    Array<int> facets_of_domain_type_idx [N_COMBINED_DOMAIN_TYPES];
     int subdivlvl = 0;
+
+    void UpdateIndexLists();
   public:
     CutInformation (shared_ptr<MeshAccess> ama);
     void Update(shared_ptr<CoefficientFunction> lset, int time_order, LocalHeap & lh);
@@ -89,6 +95,40 @@ namespace ngcomp
     shared_ptr<BitArray> GetFacetsOfDomainType(COMBINED_DOMAIN_TYPE dt) const { return facets_of_domain_type[dt]; }
     shared_ptr<BitArray> GetFacetsOfDomainType(DOMAIN_TYPE dt) const { return facets_of_domain_type[TO_CDT(dt)]; }
 
+    // sorted numbers of the elements / facets of a combined domain type
+    FlatArray<int> GetElementIndicesOfDomainType(COMBINED_DOMAIN_TYPE dt, VorB vb) const
+    {
+      if (vb == VOL)
+        return elems_of_domain_type_idx[dt];
+      else
+        return selems_of_domain_type_idx[dt];
+    }
+    FlatArray<int> GetFacetIndicesOfDomainType(COMBINED_DOMAIN_TYPE dt) const { return facets_of_domain_type_idx[dt]; }
+
+    // loops (in parallel) only over the elements / facets of a combined domain type
+    void IterateElementsOfDomainType(COMBINED_DOMAIN_TYPE dt, VorB vb, LocalHeap & lh,
+                                     const function<void(int,LocalHeap&)> & func) const
+    {
+      IterateIndices(GetElementIndicesOfDomainType(dt,vb), lh, func);
+    }
+    void IterateFacetsOfDomainType(COMBINED_DOMAIN_TYPE dt, LocalHeap & lh,
+                                   const function<void(int,LocalHeap&)> & func) const
+    {
+      IterateIndices(GetFacetIndicesOfDomainType(dt), lh, func);
+    }
+    template <typename TFUNC>
+    void ParallelForElementsOfDomainType(COMBINED_DOMAIN_TYPE dt, VorB vb, TFUNC func) const
+    {
+      FlatArray<int> idx = GetElementIndicesOfDomainType(dt,vb);
+      ParallelFor (idx.Size(), [&] (size_t i) { func(idx[i]); });
+    }
+    template <typename TFUNC>
+    void ParallelForFacetsOfDomainType(COMBINED_DOMAIN_TYPE dt, TFUNC func) const
+    {
+      FlatArray<int> idx = GetFacetIndicesOfDomainType(dt);
+      ParallelFor (idx.Size(), [&] (size_t i) { func(idx[i]); });
+    }
+
   };
 
   shared_ptr<BitArray> GetFacetsWithNeighborTypes(shared_ptr<MeshAccess> ma,
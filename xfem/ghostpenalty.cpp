@@ -1,6 +1,7 @@
 #define FILE_GHOSTPENALTY_CPP
 #include "ghostpenalty.hpp"
 #include <diffop_impl.hpp>
+#include "../utils/ngsxstd.hpp"
 
 namespace ngfem
 {
@@ -135,6 +136,21 @@ namespace ngfem
   };
 
 
+  // On affine elements the shape functions along the line xhat + t * J^{-1} n are polynomials
+  // of degree polorder. A central stencil which is exact for polynomials of that degree gives
+  // the derivative up to round-off. Hence, the stencil can have the size of the element
+  // (no truncation error) and the stencil points do not have to be mapped back.
+  // Returns the required accuracy of the stencil (-1 if no such stencil is available).
+  int ExactStencilAccuracy (int order, int polorder)
+  {
+    // stencil for order with accuracy acc has 2w+1 points, w = acc/2 + (order-1)/2,
+    // and is exact for polynomials up to degree 2w
+    int acc = polorder - 2*((order-1)/2);
+    acc = max2(2, acc + acc % 2);
+    return acc <= 16 ? acc : -1;
+  }
+
+
   template <int D, int ORDER>
   template <typename FEL, typename MIP, typename MAT>
   void DiffOpDuDnkHDiv<D,ORDER>::GenerateMatrix (const FEL & bfel, const MIP & mip,
@@ -148,6 +164,42 @@ namespace ngfem
 
     Vec<D> normal = static_cast<const DimMappedIntegrationPoint<D>&>(mip).GetNV();
 
+    // affine elements: exact derivatives of the reference shape functions + Piola transformation
+    const int polorder = hdivfel.Order()+1;
+    const int exact_accuracy = ExactStencilAccuracy(ORDER, polorder);
+    if (exact_accuracy > 0 && IsAffineElement<D>(mip.GetTransformation()))
+    {
+      if (ORDER > polorder)
+      {
+        mat = 0.0;
+        return;
+      }
+      Vec<D> dir = mip.GetJacobianInverse() * normal;
+      FlatVector<> stencil (CentralFDStencils::Get(ORDER,exact_accuracy));
+      const int stencilpoints = stencil.Size();
+      const int stencilwidth = (stencilpoints-1)/2;
+      // stencil extends over (approx.) the reference element
+      const double eps = 1.0 / (stencilpoints * L2Norm(dir));
+
+      FlatMatrixFixWidth<D> refshape (ndof, lh);
+      FlatMatrixFixWidth<D> sumshape (ndof, lh);
+      sumshape = 0.0;
+      for (int i = 0; i < stencilpoints; ++i)
+      {
+        IntegrationPoint ip(mip.IP());
+        for (int d = 0; d < D; ++d)
+          ip(d) += (i-stencilwidth) * eps * dir(d);
+        hdivfel.CalcShape (ip, refshape);
+        sumshape += stencil(i) * refshape;
+      }
+      const double fac = std::pow(1.0/eps,ORDER) / mip.GetJacobiDet();
+      Mat<D,D> jac = mip.GetJacobian();
+      FlatMatrixFixWidth<D> mappedshape (ndof, lh);
+      mappedshape = fac * sumshape * Trans(jac);
+      mat = Trans(mappedshape);
+      return;
+    }
+
     // cout << "normal: " << normal << endl;
     // Vec<D> normal; normal(0) = -1.0; normal(1) = 1.0;
     // normal /= L2Norm(normal);
@@ -224,6 +276,59 @@ namespace ngfem
     const int FD_ACCURACY = 4;
     int version = 2;
 
+    const ScalarFiniteElement<D> & scafe_aff =
+      dynamic_cast<const ScalarFiniteElement<D> & > (bfel);
+    const int exact_accuracy = ExactStencilAccuracy(ORDER, scafe_aff.Order());
+    if (exact_accuracy > 0 && IsAffineElement<D>(mip.GetTransformation()))
+    // affine elements: exact derivatives of the polynomial shape functions
+    // (FD versions below are only used on curved elements)
+    {
+      const int ndof = scafe_aff.GetNDof();
+      if (ORDER > scafe_aff.Order())
+      {
+        mat = 0.0;
+        return;
+      }
+
+      Vec<D> normal = static_cast<const DimMappedIntegrationPoint<D>&>(mip).GetNV();
+      Vec<D> dir = mip.GetJacobianInverse() * normal;
+
+      if (ORDER == 1)
+        mat.Row(0) = scafe_aff.GetDShape (mip.IP(), lh) * dir;
+      else if (ORDER == 2)
+      {
+        FlatMatrix<> ddshape (ndof, D*D, lh);
+        scafe_aff.CalcDDShape (mip.IP(), ddshape);
+        Vec<D*D> dirdir;
+        for (int i = 0; i < D; ++i)
+          for (int j = 0; j < D; ++j)
+            dirdir(i*D+j) = dir(i) * dir(j);
+        mat.Row(0) = ddshape * dirdir;
+      }
+      else
+      {
+        FlatVector<> stencil (CentralFDStencils::Get(ORDER,exact_accuracy));
+        const int stencilpoints = stencil.Size();
+        const int stencilwidth = (stencilpoints-1)/2;
+        // stencil extends over (approx.) the reference element
+        const double eps = 1.0 / (stencilpoints * L2Norm(dir));
+
+        FlatVector<> shape (ndof, lh);
+        FlatVector<> dshapednk (ndof, lh);
+        dshapednk = 0.0;
+        for (int i = 0; i < stencilpoints; ++i)
+        {
+          IntegrationPoint ip(mip.IP());
+          for (int d = 0; d < D; ++d)
+            ip(d) += (i-stencilwidth) * eps * dir(d);
+          scafe_aff.CalcShape (ip, shape);
+          dshapednk += stencil(i) * shape;
+        }
+        mat.Row(0) = std::pow(1.0/eps,ORDER) * dshapednk;
+      }
+      return;
+    }
+
     if (version == 1)
     // not higher order accurate on curved meshes (!),
     // but more stable and efficient (one derivate less to evaluate by FD)
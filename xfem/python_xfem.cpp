@@ -5,6 +5,8 @@
 #include "../xfem/symboliccutbfi.hpp"
 #include "../xfem/symboliccutlfi.hpp"
 #include "../xfem/ghostpenalty.hpp"
+#include "../xfem/aggregates.hpp"
+#include "../xfem/cutamg.hpp"
 
 using namespace ngcomp;
 
@@ -317,6 +319,196 @@ heapsize : int
 
     );
 
+  py::class_<ElementAggregation, shared_ptr<ElementAggregation>>
+    (m, "ElementAggregation",R"raw(
+An ElementAggregation groups the elements of the active mesh w.r.t. a domain (NEG or POS).
+Elements with a cut ratio below a threshold ("bad" elements) are attached to a well cut or
+uncut neighbor ("root" element), possibly over several layers of bad elements. Together with
+AggregationEmbedding this gives a stabilization of unfitted discretizations that is an
+alternative to ghost penalties.
+)raw")
+    .def("__init__",  [] (ElementAggregation *instance,
+                          shared_ptr<MeshAccess> ma,
+                          py::object acutinfo,
+                          DOMAIN_TYPE dt,
+                          double threshold,
+                          int heapsize)
+         {
+           new (instance) ElementAggregation (ma);
+           if (py::extract<PyCI> (acutinfo).check())
+           {
+             LocalHeap lh (heapsize, "ElementAggregation::Update-heap", true);
+             instance->Update(py::extract<PyCI>(acutinfo)(), dt, threshold, lh);
+           }
+         },
+         py::arg("mesh"),
+         py::arg("cutinfo") = DummyArgument(),
+         py::arg("domain_type") = NEG,
+         py::arg("threshold") = 0.1,
+         py::arg("heapsize") = 1000000,docu_string(R"raw_string(
+Creates an ElementAggregation for a mesh and (optionally) updates it w.r.t. a CutInfo.
+
+Parameters
+
+mesh : Mesh
+
+cutinfo : xfem.CutInfo / None
+  CutInfo w.r.t. which the aggregation is created
+
+domain_type : {NEG,POS}
+  domain for which the active mesh is aggregated
+
+threshold : float
+  elements with a cut ratio (w.r.t. domain_type) below threshold are attached to a root element
+)raw_string")
+      )
+    .def("Update", [](ElementAggregation & self,
+                      PyCI cutinfo,
+                      DOMAIN_TYPE dt,
+                      double threshold,
+                      int heapsize)
+         {
+           LocalHeap lh (heapsize, "ElementAggregation::Update-heap", true);
+           self.Update(cutinfo, dt, threshold, lh);
+         },
+         py::arg("cutinfo"),
+         py::arg("domain_type") = NEG,
+         py::arg("threshold") = 0.1,
+         py::arg("heapsize") = 1000000,docu_string(R"raw_string(
+Updates the aggregation w.r.t. a CutInfo, see constructor for the parameters.
+)raw_string")
+      )
+    .def("GetRootElements", [](ElementAggregation & self)
+         {
+           return self.GetRootElements();
+         },docu_string(R"raw_string(
+Returns BitArray that is true for all (well cut or uncut) root elements of the active mesh.
+)raw_string"))
+    .def("GetBadElements", [](ElementAggregation & self)
+         {
+           return self.GetBadElements();
+         },docu_string(R"raw_string(
+Returns BitArray that is true for all badly cut elements that are attached to a root element.
+)raw_string"))
+    .def("GetRootOfElement", [](ElementAggregation & self, int elnr)
+         {
+           return self.GetRootOfElement(elnr);
+         },
+         py::arg("elnr"),docu_string(R"raw_string(
+Returns the number of the root element of an element (-1 if the element is not active).
+)raw_string"))
+    .def("GetNLayers", [](ElementAggregation & self)
+         {
+           return self.GetNLayers();
+         },docu_string(R"raw_string(
+Returns the number of neighbor layers that were needed to attach all bad elements.
+)raw_string"))
+    ;
+
+  m.def("AggregationEmbedding",
+        [] (shared_ptr<ElementAggregation> aggregation,
+            PyFES fes,
+            py::object afreedofs,
+            int heapsize)
+        {
+          shared_ptr<BitArray> freedofs = nullptr;
+          if (py::extract<PyBA> (afreedofs).check())
+            freedofs = py::extract<PyBA>(afreedofs)();
+          LocalHeap lh (heapsize, "AggregationEmbedding-heap", true);
+          return AggregationEmbedding(fes,*aggregation,freedofs,lh);
+        } ,
+        py::arg("aggregation"),
+        py::arg("space"),
+        py::arg("freedofs") = DummyArgument(),
+        py::arg("heapsize") = 1000000,
+        docu_string(R"raw_string(
+Computes the sparse embedding matrix P of an aggregated (stabilized) space into the
+finite element space. The columns correspond to the free dofs of the root elements. The
+free dofs that are only supported on bad elements are given by the extension of the finite
+element function on the corresponding root element. Solve P^T A P x = P^T f and set u = P x.
+Compared to ghost penalty stabilization no additional couplings are introduced in A.
+
+Parameters:
+
+aggregation : xfem.ElementAggregation
+  aggregation of the active mesh
+
+space : ngsolve.FESpace
+  scalar finite element space (e.g. a Restrict-ed H1 space on the active mesh)
+
+freedofs : ngsolve.BitArray / None
+  free dofs of the space (all dofs if None)
+
+heapsize : int
+  heapsize of local computations.
+)raw_string")
+    );
+
+  py::class_<CutAMG, shared_ptr<CutAMG>, BaseMatrix>
+    (m, "CutAMG",
+     docu_string(R"raw_string(
+Smoothed aggregation algebraic multigrid preconditioner (V-cycle) for unfitted discretizations
+on a single mesh, e.g. XFEM (FESpace([Vh,Vhx])) or ghost penalty stabilized systems. Free dofs
+are aggregated with strongly coupled dofs of the same space component; extended dofs are
+aggregated with their base dof (if the base space is a component of the space). The tentative
+prolongation reproduces the constants on both sides of the interface. All couplings (including
+ghost penalty couplings) of extended dofs with a small cut ratio (below weak_threshold, w.r.t.
+the CutInfo of the XFESpace) count as strong, so that they are interpolated from their well cut
+neighbours. The prolongations are smoothed (damped Jacobi on the filtered matrix), the coarse
+matrices are Galerkin products. On every level but the
+coarsest, nu Gauss-Seidel steps are applied before and (backwards) after the coarse grid
+correction.
+
+Parameters
+
+mat : ngsolve.la.SparseMatrixd
+  system matrix (non-symmetric storage)
+
+space : ngsolve.FESpace
+  finite element space of the matrix (XFESpace or compound space with XFESpace components)
+
+freedofs : ngsolve.BitArray / None
+  free dofs (all dofs if None)
+
+theta : float
+  strength threshold, |a_ij| >= theta * sqrt(|a_ii a_jj|)
+
+weak_threshold : float
+  extended dofs with a (maximal) cut ratio below weak_threshold are weak dofs
+
+coarsesize : int
+  levels are added until the number of dofs is not larger than coarsesize
+
+maxlevels : int
+  maximal number of levels
+
+nu : int
+  number of smoothing steps
+)raw_string"))
+    .def("__init__",
+         [](CutAMG *instance, shared_ptr<BaseMatrix> amat, PyFES fes, py::object afreedofs,
+            double theta, double weak_threshold, size_t coarsesize, int maxlevels, int nu)
+         {
+           auto mat = dynamic_pointer_cast<SparseMatrix<double>>(amat);
+           if (!mat)
+             throw Exception("CutAMG: matrix has to be a real sparse matrix");
+           shared_ptr<BitArray> freedofs = nullptr;
+           if (py::extract<PyBA> (afreedofs).check())
+             freedofs = py::extract<PyBA>(afreedofs)();
+           Array<int> tags, basedofs;
+           Array<double> weights;
+           Array<DOMAIN_TYPE> sides;
+           GetCutAMGDofData (fes, tags, weights, basedofs, sides);
+           new (instance) CutAMG (mat, freedofs, tags, weights, basedofs, sides, theta,
+                                  weak_threshold, coarsesize, maxlevels, nu);
+         },
+         py::arg("mat"), py::arg("space"), py::arg("freedofs") = DummyArgument(),
+         py::arg("theta") = 0.08, py::arg("weak_threshold") = 0.1,
+         py::arg("coarsesize") = 500, py::arg("maxlevels") = 20, py::arg("nu") = 1)
+    .def_property_readonly("nlevels", &CutAMG::GetNLevels, "number of levels")
+    .def("GetNDof", &CutAMG::GetNDof, py::arg("level"), "number of dofs of a level (0 is the finest)")
+    ;
+
 
 //   .def("__init__",  [] (XFESpace *instance,
   m.def("XFESpace", [] (
@@ -459,7 +651,8 @@ elnr : int
                              bool skeleton,
                              py::object definedon,
                              py::object definedonelem,
-                             py::object deformation)
+                             py::object deformation,
+                             bool simd_evaluate)
         -> PyBFI
         {
 
@@ -495,7 +688,9 @@ elnr : int
               throw Exception("Symbolic cuts on facets and boundary not yet (implemented/tested) for time_order >= 0..");
             if (vb == BND)
               throw Exception("Symbolic cuts on facets and boundary not yet (implemented/tested) for boundaries..");
-            bfi = make_shared<SymbolicCutFacetBilinearFormIntegrator> (lset, cf, dt, order, subdivlvl);
+            auto bfime = make_shared<SymbolicCutFacetBilinearFormIntegrator> (lset, cf, dt, order, subdivlvl);
+            bfime->SetSIMDEvaluate(simd_evaluate);
+            bfi = bfime;
           }
           if (py::extract<py::list> (definedon).check())
             bfi -> SetDefinedOn (makeCArray<int> (definedon));
@@ -527,6 +722,7 @@ elnr : int
         py::arg("definedon")=DummyArgument(),
         py::arg("definedonelements")=DummyArgument(),
         py::arg("deformation")=DummyArgument(),
+        py::arg("simd_evaluate")=true,
         docu_string(R"raw_string(
 see documentation of SymbolicBFI (which is a wrapper))raw_string")
     );
@@ -536,7 +732,9 @@ see documentation of SymbolicBFI (which is a wrapper))raw_string")
                                     int time_order,
                                     bool skeleton,
                                     py::object definedonelem,
-                                    py::object deformation)
+                                    py::object deformation,
+                                    bool use_cache,
+                                    bool simd_evaluate)
         -> PyBFI
         {
           // check for DG terms
@@ -556,6 +754,7 @@ see documentation of SymbolicBFI (which is a wrapper))raw_string")
           {
             auto bfime = make_shared<SymbolicFacetBilinearFormIntegrator2> (cf, order);
             bfime->SetTimeIntegrationOrder(time_order);
+            bfime->SetSIMDEvaluate(simd_evaluate);
             bfi = bfime;
           }
           else
@@ -563,6 +762,7 @@ see documentation of SymbolicBFI (which is a wrapper))raw_string")
             // throw Exception("Patch facet blf not implemented yet: TODO(2)!");
             auto bfime = make_shared<SymbolicFacetPatchBilinearFormIntegrator> (cf, order);
             bfime->SetTimeIntegrationOrder(time_order);
+            bfime->SetPatchMatrixCache(use_cache);
             bfi = bfime;
           }
 
@@ -580,6 +780,8 @@ see documentation of SymbolicBFI (which is a wrapper))raw_string")
         py::arg("skeleton") = true,
         py::arg("definedonelements")=DummyArgument(),
         py::arg("deformation")=DummyArgument(),
+        py::arg("use_cache")=false,
+        py::arg("simd_evaluate")=true,
         docu_string(R"raw_string(
 Integrator on facet patches. Two versions are possible:
 * Either (skeleton=False) an integration on the element patch consisting of two neighboring elements is applied, 
@@ -602,6 +804,34 @@ definedonelements : ngsolve.BitArray/None
 time_order : int
   order in time that is used in the space-time integration. time_order=-1 means that no space-time
   rule will be applied. This is only relevant for space-time discretizations.
+
+use_cache : boolean
+  (only active in the facet patch case (skeleton=False)) reuse the patch matrix of congruent
+  (straight) patches, e.g. on structured meshes. Only applied if the form has no other
+  coefficients than constants.
+
+simd_evaluate : boolean
+  (only active in the facet case (skeleton=True)) evaluate the form on SIMD integration rules
+  (with fallback to the scalar evaluation) or use the scalar evaluation only
+)raw_string")
+    );
+
+  m.def("PatchMatrixCacheSize", [](PyBFI bfi)
+        {
+          auto patchbfi = dynamic_pointer_cast<SymbolicFacetPatchBilinearFormIntegrator>(bfi);
+          if (!patchbfi)
+            throw Exception("PatchMatrixCacheSize: not a facet patch integrator (SymbolicFacetPatchBFI with skeleton=False)");
+          return patchbfi->PatchMatrixCacheSize();
+        },
+        py::arg("bfi"),
+        docu_string(R"raw_string(
+Number of patch matrices in the cache of a facet patch integrator (SymbolicFacetPatchBFI with
+skeleton=False and use_cache=True).
+
+Parameters
+
+bfi : ngsolve.BFI
+  facet patch integrator
 )raw_string")
     );
 
@@ -617,7 +847,8 @@ time_order : int
                              bool skeleton,
                              py::object definedon,
                              py::object definedonelem,
-                             py::object deformation)
+                             py::object deformation,
+                             bool simd_evaluate)
         -> PyLFI
         {
 
@@ -633,6 +864,7 @@ time_order : int
 
           auto lfime  = make_shared<SymbolicCutLinearFormIntegrator> (lset, cf, dt, order, subdivlvl, quad_dir_pol,vb);
           lfime->SetTimeIntegrationOrder(time_order);
+          lfime->SetSIMDEvaluate(simd_evaluate);
           shared_ptr<LinearFormIntegrator> lfi = lfime;
 
           if (py::extract<py::list> (definedon).check())
@@ -665,6 +897,7 @@ time_order : int
         py::arg("definedon")=DummyArgument(),
         py::arg("definedonelements")=DummyArgument(),
         py::arg("deformation")=DummyArgument(),
+        py::arg("simd_evaluate")=true,
         docu_string(R"raw_string(
 see documentation of SymbolicLFI (which is a wrapper))raw_string")
     );
@@ -12,6 +12,8 @@
 #include "../xfem/symboliccutbfi.hpp"
 #include "../cutint/xintegration.hpp"
 #include "../cutint/straightcutrule.hpp"
+#include "../xfem/xfiniteelement.hpp"
+#include "../utils/ngsxstd.hpp"
 
 namespace ngfem
 {
@@ -679,6 +681,98 @@ namespace ngfem
     }
 
 
+  // weights of a SIMD integration rule generated from a rule with weights wei,
+  // padded lanes get weight zero
+  static FlatArray<SIMD<double>> PaddedSIMDWeights (FlatArray<double> wei, LocalHeap & lh)
+  {
+    size_t nsimd = (wei.Size()+SIMD<double>::Size()-1) / SIMD<double>::Size();
+    FlatArray<SIMD<double>> simd_wei(nsimd, lh);
+    for (size_t i = 0; i < nsimd; i++)
+      simd_wei[i] = SIMD<double>([&](int j) -> double
+                                 {
+                                   size_t nr = i*SIMD<double>::Size()+j;
+                                   return nr < wei.Size() ? wei[nr] : 0.0;
+                                 });
+    return simd_wei;
+  }
+
+  // SIMD kernel for facet matrices: adds the contributions of all pairs of trial and
+  // test proxies. Proxies of the neighbor (Other()) are evaluated on fel2 and mir2, the
+  // coefficient function is evaluated on mir1. The weights are multiplied with the
+  // measure of mir1 if scale_with_measure is set.
+  static void AddFacetMatrixSIMD (const CoefficientFunction & cf,
+                                  FlatArray<ProxyFunction*> trial_proxies,
+                                  FlatArray<ProxyFunction*> test_proxies,
+                                  const FiniteElement & fel1, const SIMD_BaseMappedIntegrationRule & mir1,
+                                  const FiniteElement & fel2, const SIMD_BaseMappedIntegrationRule & mir2,
+                                  FlatArray<SIMD<double>> simd_wei, bool scale_with_measure,
+                                  ProxyUserData & ud, FlatMatrix<double> elmat, LocalHeap & lh)
+  {
+    for (auto proxy1 : trial_proxies)
+      for (auto proxy2 : test_proxies)
+        {
+          HeapReset hr(lh);
+          size_t dim_proxy1 = proxy1->Dimension();
+          size_t dim_proxy2 = proxy2->Dimension();
+          FlatMatrix<SIMD<double>> proxyvalues(dim_proxy1*dim_proxy2, mir1.Size(), lh);
+
+          for (size_t k = 0; k < dim_proxy1; k++)
+            for (size_t l = 0; l < dim_proxy2; l++)
+              {
+                ud.trialfunction = proxy1;
+                ud.trial_comp = k;
+                ud.testfunction = proxy2;
+                ud.test_comp = l;
+
+                auto kk = l + k*dim_proxy2;
+                cf.Evaluate (mir1, proxyvalues.Rows(kk, kk+1));
+              }
+
+          for (size_t i = 0; i < mir1.Size(); i++)
+            {
+              SIMD<double> fac = scale_with_measure ? mir1[i].GetMeasure() * simd_wei[i] : simd_wei[i];
+              for (size_t kk = 0; kk < proxyvalues.Height(); kk++)
+                proxyvalues(kk, i) *= fac;
+            }
+
+          const FiniteElement & fel_trial = proxy1->IsOther() ? fel2 : fel1;
+          const FiniteElement & fel_test = proxy2->IsOther() ? fel2 : fel1;
+          const SIMD_BaseMappedIntegrationRule & mir_trial = proxy1->IsOther() ? mir2 : mir1;
+          const SIMD_BaseMappedIntegrationRule & mir_test = proxy2->IsOther() ? mir2 : mir1;
+
+          size_t ndof1_trial = proxy1->Evaluator()->BlockDim()*fel1.GetNDof();
+          size_t ndof1_test = proxy2->Evaluator()->BlockDim()*fel1.GetNDof();
+          IntRange trial_range = proxy1->IsOther() ? IntRange(ndof1_trial, elmat.Width()) : IntRange(0, ndof1_trial);
+          IntRange test_range = proxy2->IsOther() ? IntRange(ndof1_test, elmat.Height()) : IntRange(0, ndof1_test);
+          auto loc_elmat = elmat.Rows(test_range).Cols(trial_range);
+
+          FlatMatrix<SIMD<double>> bbmat1(loc_elmat.Width()*dim_proxy1, mir1.Size(), lh);
+          FlatMatrix<SIMD<double>> bbmat2(loc_elmat.Height()*dim_proxy2, mir1.Size(), lh);
+          FlatMatrix<SIMD<double>> bdbmat1(loc_elmat.Width()*dim_proxy2, mir1.Size(), lh);
+          FlatMatrix<SIMD<double>> hbdbmat1(loc_elmat.Width(), dim_proxy2*mir1.Size(), &bdbmat1(0,0));
+          FlatMatrix<SIMD<double>> hbbmat2(loc_elmat.Height(), dim_proxy2*mir1.Size(), &bbmat2(0,0));
+
+          proxy1->Evaluator()->CalcMatrix(fel_trial, mir_trial, bbmat1);
+          proxy2->Evaluator()->CalcMatrix(fel_test, mir_test, bbmat2);
+
+          IntRange r1 = proxy1->Evaluator()->UsedDofs(fel_trial);
+          IntRange r2 = proxy2->Evaluator()->UsedDofs(fel_test);
+
+          bdbmat1 = 0.0;
+          for (auto i : r1)
+            for (size_t j = 0; j < dim_proxy2; j++)
+              for (size_t k = 0; k < dim_proxy1; k++)
+                {
+                  auto res = bdbmat1.Row(i*dim_proxy2+j);
+                  auto a = bbmat1.Row(i*dim_proxy1+k);
+                  auto b = proxyvalues.Row(k*dim_proxy2+j);
+                  res += pw_mult(a,b);
+                }
+
+          AddABt (hbbmat2.Rows(r2), hbdbmat1.Rows(r1), loc_elmat.Rows(r2).Cols(r1));
+        }
+  }
+
   SymbolicCutFacetBilinearFormIntegrator ::
   SymbolicCutFacetBilinearFormIntegrator (shared_ptr<CoefficientFunction> acf_lset,
                                           shared_ptr<CoefficientFunction> acf,
@@ -689,7 +783,7 @@ namespace ngfem
       cf_lset(acf_lset), dt(adt),
       force_intorder(aforce_intorder), subdivlvl(asubdivlvl)
   {
-    simd_evaluate=false;
+    simd_evaluate=true;
   }
 
   void  SymbolicCutFacetBilinearFormIntegrator::CalcFacetMatrix (
@@ -807,9 +901,48 @@ namespace ngfem
       if (ir_scr == nullptr) return;
     }
 
-    IntegrationRule & ir_facet_vol1 = transform1(LocalFacetNr1, (*ir_scr), lh);
-
     Facet2ElementTrafo transform2(eltype2, ElVertices2); 
+
+    if (simd_evaluate)
+    {
+      try
+      {
+        static Timer tsimd("SymbolicCutFacetBilinearFormIntegrator::CalcFacetMatrix (SIMD)", 2);
+        RegionTimer regsimd(tsimd);
+
+        SIMD_IntegrationRule simd_ir_scr(*ir_scr, lh);
+        FlatArray<double> wei(ir_scr->Size(), lh);
+        for (int i = 0; i < ir_scr->Size(); i++)
+          wei[i] = (*ir_scr)[i].Weight();
+
+        auto & simd_ir_facet_vol1 = transform1(LocalFacetNr1, simd_ir_scr, lh);
+        auto & simd_ir_facet_vol2 = transform2(LocalFacetNr2, simd_ir_scr, lh);
+        auto & simd_mir1 = trafo1(simd_ir_facet_vol1, lh);
+        auto & simd_mir2 = trafo2(simd_ir_facet_vol2, lh);
+        simd_mir1.SetOtherMIR (&simd_mir2);
+        simd_mir2.SetOtherMIR (&simd_mir1);
+        simd_mir1.ComputeNormalsAndMeasure (eltype1, LocalFacetNr1);
+        simd_mir2.ComputeNormalsAndMeasure (eltype2, LocalFacetNr2);
+
+        ProxyUserData ud;
+        const_cast<ElementTransformation&>(trafo1).userdata = &ud;
+
+        // for IF the weights are already final (2D->0D or corrected 3D->1D)
+        AddFacetMatrixSIMD (*cf, trial_proxies, test_proxies,
+                            fel1, simd_mir1, fel2, simd_mir2,
+                            PaddedSIMDWeights(wei, lh), dt != IF, ud, elmat, lh);
+        return;
+      }
+      catch (ExceptionNOSIMD e)
+      {
+        cout << IM(6) << e.What() << endl
+             << "switching back to standard evaluation" << endl;
+        simd_evaluate = false;
+        elmat = 0.0;
+      }
+    }
+
+    IntegrationRule & ir_facet_vol1 = transform1(LocalFacetNr1, (*ir_scr), lh);
     IntegrationRule & ir_facet_vol2 = transform2(LocalFacetNr2, (*ir_scr), lh);
 
     BaseMappedIntegrationRule & mir1 = trafo1(ir_facet_vol1, lh);
@@ -951,7 +1084,7 @@ namespace ngfem
     : SymbolicFacetBilinearFormIntegrator(acf,VOL,false),
       force_intorder(aforce_intorder)
   {
-    simd_evaluate=false;
+    simd_evaluate=true;
   }
 
   void SymbolicFacetBilinearFormIntegrator2 ::
@@ -976,6 +1109,49 @@ namespace ngfem
     
     Facet2ElementTrafo transform1(eltype1, ElVertices1); 
     Facet2ElementTrafo transform2(eltype2, ElVertices2);
+
+    // space-time finite elements and the time coefficient function read the time
+    // from the weights of scalar integration points, hence SIMD evaluation is only
+    // used for purely spatial rules
+    if (simd_evaluate && time_order < 0)
+    {
+      try
+      {
+        static Timer tsimd("SymbolicFacetBilinearFormIntegrator2::CalcFacetMatrix (SIMD)", 2);
+        RegionTimer regsimd(tsimd);
+
+        SIMD_IntegrationRule simd_ir_facet(ir_facet, lh);
+        FlatArray<double> wei(ir_facet.Size(), lh);
+        for (int i = 0; i < ir_facet.Size(); i++)
+          wei[i] = ir_facet[i].Weight();
+
+        auto & simd_ir_facet_vol1 = transform1(LocalFacetNr1, simd_ir_facet, lh);
+        auto & simd_ir_facet_vol2 = transform2(LocalFacetNr2, simd_ir_facet, lh);
+        auto & simd_mir1 = trafo1(simd_ir_facet_vol1, lh);
+        auto & simd_mir2 = trafo2(simd_ir_facet_vol2, lh);
+        simd_mir1.ComputeNormalsAndMeasure (eltype1, LocalFacetNr1);
+        simd_mir2.ComputeNormalsAndMeasure (eltype2, LocalFacetNr2);
+
+        ProxyUserData ud;
+        const_cast<ElementTransformation&>(trafo1).userdata = &ud;
+
+        AddFacetMatrixSIMD (*cf, trial_proxies, test_proxies,
+                            fel1, simd_mir1, fel2, simd_mir2,
+                            PaddedSIMDWeights(wei, lh), true, ud, elmat, lh);
+        return;
+      }
+      catch (ExceptionNOSIMD e)
+      {
+        cout << IM(6) << e.What() << endl
+             << "switching back to standard evaluation" << endl;
+        simd_evaluate = false;
+        elmat = 0.0;
+      }
+    }
+
+    // weights of the (space-time) tensor product rule
+    const int n_time = time_order >= 0 ? SelectIntegrationRule(ET_SEGM, time_order).Size() : 1;
+    FlatArray<double> wei(ir_facet.Size() * n_time, lh);
     
     IntegrationRule & ir_facet_vol1_tmp = transform1(LocalFacetNr1, ir_facet, lh);
     IntegrationRule & ir_facet_vol2_tmp = transform2(LocalFacetNr2, ir_facet, lh);
@@ -995,7 +1171,7 @@ namespace ngfem
         for (int j = 0; j < ir_facet_vol1_tmp.Size(); j++)
         {
           const int ij = i*ir_facet_vol1_tmp.Size()+j;
-          (*ir_spacetime1)[ij].SetWeight( ir_time[i].Weight() * ir_facet_vol1_tmp[j].Weight() );
+          wei[ij] = ir_time[i].Weight() * ir_facet[j].Weight();
           st_point = ir_facet_vol1_tmp[j].Point();
           (*ir_spacetime1)[ij].Point() = st_point;
           (*ir_spacetime1)[ij].SetWeight(ir_time[i](0));
@@ -1008,7 +1184,6 @@ namespace ngfem
         for (int j = 0; j < ir_facet_vol2_tmp.Size(); j++)
         {
           const int ij = i*ir_facet_vol2_tmp.Size()+j;
-          (*ir_spacetime2)[ij].SetWeight( ir_time[i].Weight() * ir_facet_vol2_tmp[j].Weight() );
           st_point = ir_facet_vol2_tmp[j].Point();
           (*ir_spacetime2)[ij].Point() = st_point;
           (*ir_spacetime2)[ij].SetWeight(ir_time[i](0));
@@ -1022,6 +1197,8 @@ namespace ngfem
     {
       ir_facet_vol1 = &ir_facet_vol1_tmp;
       ir_facet_vol2 = &ir_facet_vol2_tmp;
+      for (int i = 0; i < ir_facet.Size(); i++)
+        wei[i] = ir_facet[i].Weight();
     }
     
     BaseMappedIntegrationRule & mir1 = trafo1(*ir_facet_vol1, lh);
@@ -1058,7 +1235,7 @@ namespace ngfem
 
           for (int i = 0; i < mir1.Size(); i++)
             // proxyvalues(i,STAR,STAR) *= measure(i) * ir_facet[i].Weight();
-            proxyvalues(i,STAR,STAR) *= mir1[i].GetMeasure() * ir_facet[i].Weight();
+            proxyvalues(i,STAR,STAR) *= mir1[i].GetMeasure() * wei[i];
 
           IntRange trial_range  = proxy1->IsOther() ? IntRange(proxy1->Evaluator()->BlockDim()*fel1.GetNDof(), elmat.Width()) : IntRange(0, proxy1->Evaluator()->BlockDim()*fel1.GetNDof());
           IntRange test_range  = proxy2->IsOther() ? IntRange(proxy2->Evaluator()->BlockDim()*fel1.GetNDof(), elmat.Height()) : IntRange(0, proxy2->Evaluator()->BlockDim()*fel1.GetNDof());
@@ -1110,6 +1287,112 @@ namespace ngfem
     simd_evaluate=false;
   }
 
+  void SymbolicFacetPatchBilinearFormIntegrator :: SetPatchMatrixCache(bool ause_cache)
+  {
+    // cached matrices can only be reused if the integrand depends on the patch only through
+    // the proxies, i.e. all other leaves of the coefficient tree are constants
+    bool only_constants = true;
+    cf->TraverseTree ([&only_constants] (CoefficientFunction & acf)
+                      {
+                        if (acf.InputCoefficientFunctions().Size() > 0) return;
+                        if (dynamic_cast<ProxyFunction*> (&acf)) return;
+                        if (dynamic_cast<ConstantCoefficientFunction*> (&acf)) return;
+                        only_constants = false;
+                      });
+    if (ause_cache && !only_constants)
+      cout << IM(3) << "SymbolicFacetPatchBFI: form has non-constant coefficients, no patch matrix cache used." << endl;
+    use_patch_cache = ause_cache && only_constants;
+    ClearPatchMatrixCache();
+  }
+
+  void SymbolicFacetPatchBilinearFormIntegrator :: ClearPatchMatrixCache() const
+  {
+    lock_guard<mutex> guard(patch_cache_mutex);
+    patch_matrix_cache.clear();
+  }
+
+  size_t SymbolicFacetPatchBilinearFormIntegrator :: PatchMatrixCacheSize() const
+  {
+    lock_guard<mutex> guard(patch_cache_mutex);
+    return patch_matrix_cache.size();
+  }
+
+  // appends the domain signs of the dofs of all XFiniteElement (and XDummyFE) components of fel
+  // to a patch cache key. Patches with the same geometry but different signs have different
+  // matrices (e.g. for neg(u) of an XFESpace)
+  static void AddDofSignsToKey (const FiniteElement & fel, std::vector<long long> & key)
+  {
+    if (auto xfe = dynamic_cast<const XFiniteElement*>(&fel))
+    {
+      auto signs = xfe->GetSignsOfDof();
+      key.push_back(signs.Size());
+      for (DOMAIN_TYPE dt : signs)
+        key.push_back(dt);
+    }
+    else if (auto xdummy = dynamic_cast<const XDummyFE*>(&fel))
+    {
+      key.push_back(-1);
+      key.push_back(xdummy->GetDomainType());
+    }
+    else if (auto cfe = dynamic_cast<const CompoundFiniteElement*>(&fel))
+      for (int i = 0; i < cfe->GetNComponents(); i++)
+        AddDofSignsToKey((*cfe)[i], key);
+  }
+
+  // computes the key of a patch for the patch matrix cache. The key consists of the
+  // element types, the finite elements (order, ndof, signs of XFiniteElement dofs), the relative
+  // order of the vertex numbers of each element (orientation of the shape functions) and the affine
+  // geometry of the patch (Jacobians of both elements and the offset between them relative to the
+  // size of the first element). Returns false if the patch is not affine.
+  template<int D>
+  bool ComputePatchCacheKey(const FiniteElement & fel1, const ElementTransformation & trafo1,
+                            FlatArray<int> & ElVertices1,
+                            const FiniteElement & fel2, const ElementTransformation & trafo2,
+                            FlatArray<int> & ElVertices2,
+                            std::vector<long long> & key)
+  {
+    Mat<D,D> A1, A2;
+    Vec<D> c1, c2;
+    if (!GetAffineElementMap<D>(trafo1, A1, c1) || !GetAffineElementMap<D>(trafo2, A2, c2))
+      return false;
+
+    const double quant = 1e10;
+    key.clear();
+    key.push_back(trafo1.GetElementType());
+    key.push_back(trafo2.GetElementType());
+    for (auto fel : { &fel1, &fel2 })
+    {
+      key.push_back(fel->Order());
+      key.push_back(fel->GetNDof());
+      AddDofSignsToKey(*fel, key);
+    }
+    for (auto verts : { ElVertices1, ElVertices2 })
+      for (int i = 0; i < verts.Size(); i++)
+      {
+        int rank = 0;
+        for (int j = 0; j < verts.Size(); j++)
+          if (verts[j] < verts[i]) rank++;
+        key.push_back(rank);
+      }
+
+    double scale = 0;
+    for (int i = 0; i < D; i++)
+      for (int j = 0; j < D; j++)
+        scale = max2(scale, abs(A1(i,j)));
+    key.push_back(llround(log2(scale) * quant));
+    Vec<D> offset = c2 - c1;
+    for (int i = 0; i < D; i++)
+    {
+      for (int j = 0; j < D; j++)
+      {
+        key.push_back(llround(A1(i,j) / scale * quant));
+        key.push_back(llround(A2(i,j) / scale * quant));
+      }
+      key.push_back(llround(offset(i) / scale * quant));
+    }
+    return true;
+  }
+
   // maps an integration point from inside one element to an integration point of the neighbor element
   // (integration point will be outside), so that the mapped points have the same coordinate
   template<int D>
@@ -1199,6 +1482,55 @@ namespace ngfem
   }
 
 
+  // affine counterpart of MapPatchIntegrationPoint: for two straight elements the map between the
+  // reference elements is affine and computed once per facet. Maps ir_vol1 (ir_vol2) to
+  // the neighbor element and fills ir_patch1 and ir_patch2. Returns false (without mapping) if one of
+  // the elements is not affine.
+  template<int D>
+  bool MapPatchIntegrationRuleAffine(const IntegrationRule & ir_vol1, const ElementTransformation & trafo1,
+                                     const IntegrationRule & ir_vol2, const ElementTransformation & trafo2,
+                                     IntegrationRule & ir_patch1, IntegrationRule & ir_patch2)
+  {
+    Mat<D,D> A1, A2;
+    Vec<D> c1, c2;
+    if (!GetAffineElementMap<D>(trafo1, A1, c1) || !GetAffineElementMap<D>(trafo2, A2, c2))
+      return false;
+
+    Mat<D,D> A1inv = Inv(A1);
+    Mat<D,D> A2inv = Inv(A2);
+    // xhat_2 = M12 xhat_1 + b12 and vice versa
+    Mat<D,D> M12 = A2inv * A1;
+    Vec<D> b12 = A2inv * (c1 - c2);
+    Mat<D,D> M21 = A1inv * A2;
+    Vec<D> b21 = A1inv * (c2 - c1);
+    // ratio of the measures to keep the physical weight
+    const double detratio12 = abs(Det(A1)) / abs(Det(A2));
+
+    Vec<D> xhat;
+    for (int l = 0; l < ir_patch1.Size(); l++)
+    {
+      if (l < ir_vol1.Size())
+      {
+        const IntegrationPoint & ip = ir_vol1[l];
+        for (int d = 0; d < D; d++) xhat(d) = ip(d);
+        ir_patch1[l] = ip;
+        ir_patch2[l] = IntegrationPoint(0.,0.,0.,ip.Weight() * detratio12);
+        ir_patch2[l].Point().Range(0,D) = M12 * xhat + b12;
+      }
+      else
+      {
+        const IntegrationPoint & ip = ir_vol2[l - ir_vol1.Size()];
+        for (int d = 0; d < D; d++) xhat(d) = ip(d);
+        ir_patch2[l] = ip;
+        ir_patch1[l] = IntegrationPoint(0.,0.,0.,ip.Weight() / detratio12);
+        ir_patch1[l].Point().Range(0,D) = M21 * xhat + b21;
+      }
+      ir_patch1[l].SetNr(l);
+      ir_patch2[l].SetNr(l);
+    }
+    return true;
+  }
+
   void SymbolicFacetPatchBilinearFormIntegrator ::
   CalcFacetMatrix (const FiniteElement & fel1, int LocalFacetNr1,
                    const ElementTransformation & trafo1, FlatArray<int> & ElVertices1,
@@ -1211,6 +1543,26 @@ namespace ngfem
     if (LocalFacetNr2==-1) throw Exception ("SymbolicFacetPatchBFI: LocalFacetNr2==-1");
 
     int D = trafo1.SpaceDim();
+
+    // congruent patches (e.g. on structured meshes) reuse the patch matrix
+    std::vector<long long> cache_key;
+    if (use_patch_cache && time_order == -1)
+    {
+      bool has_key = (D==2) ? ComputePatchCacheKey<2>(fel1, trafo1, ElVertices1, fel2, trafo2, ElVertices2, cache_key)
+                            : ComputePatchCacheKey<3>(fel1, trafo1, ElVertices1, fel2, trafo2, ElVertices2, cache_key);
+      if (!has_key)
+        cache_key.clear();
+      else
+      {
+        lock_guard<mutex> guard(patch_cache_mutex);
+        auto it = patch_matrix_cache.find(cache_key);
+        if (it != patch_matrix_cache.end() && it->second.Height() == elmat.Height() && it->second.Width() == elmat.Width())
+        {
+          elmat = it->second;
+          return;
+        }
+      }
+    }
     int maxorder = max2 (fel1.Order(), fel2.Order());
 
     auto eltype1 = trafo1.GetElementType();
@@ -1226,7 +1578,14 @@ namespace ngfem
     IntegrationRule ir_patch2 (ir_vol1.Size()+ir_vol2.Size(),lh);
     //In the non-space time case, the result of the mapping to the other element does not depend on the time
     //Therefore it is sufficient to do it once here.
-    if(time_order == -1){
+    //For straight elements this map is affine and computed in closed form, otherwise we use Newton.
+    bool affine_patch = false;
+    if(time_order == -1)
+    {
+      if (D==2) affine_patch = MapPatchIntegrationRuleAffine<2>(ir_vol1, trafo1, ir_vol2, trafo2, ir_patch1, ir_patch2);
+      else affine_patch = MapPatchIntegrationRuleAffine<3>(ir_vol1, trafo1, ir_vol2, trafo2, ir_patch1, ir_patch2);
+    }
+    if(time_order == -1 && !affine_patch){
         for (int l = 0; l < ir_patch1.Size(); l++) {
             if (l<ir_vol1.Size()) {
                 ir_patch1[l] = ir_vol1[l];
@@ -1408,6 +1767,16 @@ namespace ngfem
               loc_elmat.Rows(r2).Cols(r1) += Trans (bbmat2.Cols(r2)) * bdbmat1.Cols(r1) | Lapack;
             }
         }
+
+    if (!cache_key.empty())
+    {
+      Matrix<double> cached(elmat.Height(), elmat.Width());
+      cached = elmat;
+      lock_guard<mutex> guard(patch_cache_mutex);
+      if (patch_matrix_cache.size() >= max_patch_cache_size)
+        patch_matrix_cache.clear();
+      patch_matrix_cache.emplace(cache_key, std::move(cached));
+    }
   }
 
 }
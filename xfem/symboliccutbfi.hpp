@@ -4,6 +4,8 @@
 #include <ngstd.hpp> // for Array
 
 #include "../cutint/xintegration.hpp"
+#include <map>
+#include <mutex>
 using namespace xintegration;
 
 // #include "xfiniteelement.hpp"
@@ -127,6 +129,8 @@ namespace ngfem
                                             DOMAIN_TYPE adt,
                                             int aforce_intorder,
                                             int asubdivlvl);
+    // SIMD evaluation (with scalar fallback) or scalar evaluation only
+    void SetSIMDEvaluate(bool asimd) { simd_evaluate = asimd; }
 
     virtual VorB VB () const { return vb; }
     virtual xbool IsSymmetric() const { return maybe; }  // correct would be: don't know
@@ -184,6 +188,8 @@ namespace ngfem
     SymbolicFacetBilinearFormIntegrator2 (shared_ptr<CoefficientFunction> acf,
                                           int aforce_intorder);
     void SetTimeIntegrationOrder(int tiorder) { time_order = tiorder; }
+    // SIMD evaluation (with scalar fallback) or scalar evaluation only
+    void SetSIMDEvaluate(bool asimd) { simd_evaluate = asimd; }
 
     virtual VorB VB () const { return vb; }
     virtual xbool IsSymmetric() const { return maybe; }
@@ -239,10 +245,21 @@ namespace ngfem
   protected:
     int force_intorder = -1;
     int time_order = -1;
+    // cache of patch element matrices for congruent (affine) patches, keyed by the
+    // (quantized) geometry of the patch, the vertex orderings and the finite elements
+    // (the cache is cleared once it holds max_patch_cache_size matrices)
+    bool use_patch_cache = false;
+    static constexpr size_t max_patch_cache_size = 4096;
+    mutable std::map<std::vector<long long>, Matrix<double>> patch_matrix_cache;
+    mutable std::mutex patch_cache_mutex;
   public:
     SymbolicFacetPatchBilinearFormIntegrator (shared_ptr<CoefficientFunction> acf,
                                           int aforce_intorder);
     void SetTimeIntegrationOrder(int tiorder) { time_order = tiorder; }
+    // the cache is only used if the form has no other coefficients than constants
+    void SetPatchMatrixCache(bool ause_cache);
+    void ClearPatchMatrixCache() const;
+    size_t PatchMatrixCacheSize() const;
 
     virtual VorB VB () const { return vb; }
     virtual xbool IsSymmetric() const { return maybe; }  // correct would be: don't know
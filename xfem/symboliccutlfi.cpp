@@ -11,6 +11,7 @@
 #include <fem.hpp>
 #include "../xfem/symboliccutlfi.hpp"
 #include "../cutint/xintegration.hpp"
+#include "../cutint/straightcutrule.hpp"
 namespace ngfem
 {
 
@@ -90,7 +91,28 @@ namespace ngfem
 
     if (force_intorder >= 0)
       intorder = force_intorder;
-    
+
+    // fast path for elements that are not cut: if the element is completely in
+    // the domain we can use the standard (SIMD) evaluation of the base class,
+    // if it is completely outside there is nothing to do
+    if (gf_lset && time_order < 0 && dt != IF && intorder == 2*fel.Order())
+    {
+      Array<DofId> dnums(0,lh);
+      gf_lset->GetFESpace()->GetDofNrs(trafo.GetElementId(),dnums);
+      FlatVector<> lset_vals(dnums.Size(),lh);
+      gf_lset->GetVector().GetIndirect(dnums,lset_vals);
+      DOMAIN_TYPE element_domain = CheckIfStraightCut(lset_vals);
+      if (element_domain == dt)
+      {
+        SymbolicLinearFormIntegrator::CalcElementVector (fel, trafo, elvec, lh);
+        return;
+      }
+      else if (element_domain != IF)
+      {
+        elvec = 0;
+        return;
+      }
+    }
     
     ProxyUserData ud;
     const_cast<ElementTransformation&>(trafo).userdata = &ud;
@@ -125,6 +147,58 @@ namespace ngfem
       ir = ir1;
 
 
+    // SIMD evaluation on the (padded) cut rule; space-time rules store the
+    // time in the weight of the integration points, so these stay scalar
+    if (simd_evaluate && time_order < 0)
+    {
+      try
+      {
+        static Timer tsimd("symbolicCutLFI - CalcElementVector (SIMD)", 2);
+        RegionTimer regsimd(tsimd);
+
+        SIMD_IntegrationRule simd_ir(*ir, lh);
+        auto & simd_mir = trafo(simd_ir, lh);
+
+        // weights of the cut rule, padded lanes get weight zero
+        FlatArray<SIMD<double>> simd_wei(simd_ir.Size(), lh);
+        for (size_t i = 0; i < simd_ir.Size(); i++)
+          simd_wei[i] = SIMD<double>([&](int j) -> double
+                                     {
+                                       size_t nr = i*SIMD<double>::Size()+j;
+                                       return nr < ir->Size() ? wei_arr[nr] : 0.0;
+                                     });
+
+        for (auto proxy : proxies)
+          {
+            HeapReset hr(lh);
+            FlatMatrix<SIMD<SCAL>> proxyvalues(proxy->Dimension(), simd_ir.Size(), lh);
+            for (size_t k = 0; k < proxy->Dimension(); k++)
+              {
+                ud.testfunction = proxy;
+                ud.test_comp = k;
+                cf -> Evaluate (simd_mir, proxyvalues.Rows(k,k+1));
+              }
+
+            for (size_t i = 0; i < proxyvalues.Height(); i++)
+              {
+                auto row = proxyvalues.Row(i);
+                for (size_t j = 0; j < row.Size(); j++)
+                  row(j) *= simd_mir[j].GetMeasure() * simd_wei[j];
+              }
+
+            proxy->Evaluator()->AddTrans(fel, simd_mir, proxyvalues, elvec);
+          }
+        return;
+      }
+      catch (ExceptionNOSIMD e)
+      {
+        cout << IM(6) << e.What() << endl
+             << "switching back to standard evaluation" << endl;
+        simd_evaluate = false;
+        elvec = 0;
+      }
+    }
+
     BaseMappedIntegrationRule & mir = trafo(*ir, lh);
 
     FlatVector<SCAL> elvec1(elvec.Size(), lh);
@@ -31,6 +31,7 @@ namespace ngfem
                                      VorB vb = VOL);
 
     void SetTimeIntegrationOrder(int tiorder) { time_order = tiorder; }
+    void SetSIMDEvaluate(bool asimd) { simd_evaluate = asimd; }
     virtual VorB VB () const { return VOL; }
     virtual string Name () const { return string ("Symbolic Cut LFI"); }
 
@@ -72,25 +72,29 @@ namespace ngcomp
     if (trace && ma->GetDimension() == 3)
     // face bubbles on the outer part of the band will be local dofs... (for static cond.)
     {
-      for (int facnr = 0; facnr < ma->GetNFaces(); ++facnr)
+      // only faces of cut elements carry x-dofs
+      Array<int> elnums;
+      for (auto cutelnr : cutinfo->GetElementIndicesOfDomainType(CDOM_IF,VOL))
       {
-        Array<int> elnums;
-        ma->GetFaceElements (facnr, elnums);
-        int cutels = 0;
-        for (auto elnr : elnums)
+        for (auto facnr : ma->GetElFaces(cutelnr))
         {
-          if (cutinfo->GetElementsOfDomainType(IF,VOL)->Test(elnr))
-            cutels++;
-        }
-        if (cutels<2)
-        {
-          Array<int> facedofs;
-          basefes->GetFaceDofNrs (facnr, facedofs);
-          for (auto basedof : facedofs)
+          ma->GetFaceElements (facnr, elnums);
+          int cutels = 0;
+          for (auto elnr : elnums)
+          {
+            if (cutinfo->GetElementsOfDomainType(IF,VOL)->Test(elnr))
+              cutels++;
+          }
+          if (cutels<2)
           {
-            const int dof = basedof2xdof[basedof];
-            if (dof != -1)
-              ctofdof[dof] = LOCAL_DOF;
+            Array<int> facedofs;
+            basefes->GetFaceDofNrs (facnr, facedofs);
+            for (auto basedof : facedofs)
+            {
+              const int dof = basedof2xdof[basedof];
+              if (dof != -1)
+                ctofdof[dof] = LOCAL_DOF;
+            }
           }
         }
       }
@@ -261,7 +265,6 @@ namespace ngcomp
     int nedges=ma->GetNEdges();
     int nf=ma->GetNFaces();
     int nv=ma->GetNV();
-    int nse=ma->GetNSE();
 
     BitArray activedofs(basefes->GetNDof());
     activedofs.Clear();
@@ -275,23 +278,19 @@ namespace ngcomp
 
     for ( VorB vb : {VOL,BND})
     {
-      int ne = ma->GetNE(vb);
-
       TableCreator<int> creator;
       for (; !creator.Done(); creator++)
       {
-        for (int elnr = 0; elnr < ne; ++elnr)
+        cutinfo->ParallelForElementsOfDomainType(CDOM_IF, vb, [&] (int elnr)
         {
-          if (! cutinfo->GetElementsOfDomainType(IF,vb)->Test(elnr))
-            continue;
           Array<int> basednums;
           basefes->GetDofNrs(ElementId(vb,elnr),basednums);
           for (int k = 0; k < basednums.Size(); ++k)
           {
-            activedofs.Set(basednums[k]);
+            activedofs.SetBitAtomic(basednums[k]);
             creator.Add(elnr,basednums[k]);
           }
-        }
+        });
       }
       if (vb == VOL)
         el2dofs = make_shared<Table<int>>(creator.MoveTable());
@@ -320,25 +319,19 @@ namespace ngcomp
         xdof2basedof[ndof++] = i;
     }
 
-    for (int i = 0; i < ne; ++i)
+    cutinfo->ParallelForElementsOfDomainType(CDOM_IF, VOL, [&] (int i)
     {
-      if (cutinfo->GetElementsOfDomainType(IF,VOL)->Test(i))
-      {
-        FlatArray<int> dofs = (*el2dofs)[i];
-        for (int j = 0; j < (*el2dofs)[i].Size(); ++j)
-          (*el2dofs)[i][j] = basedof2xdof[dofs[j] ];
-      }
-    }
+      FlatArray<int> dofs = (*el2dofs)[i];
+      for (int j = 0; j < (*el2dofs)[i].Size(); ++j)
+        (*el2dofs)[i][j] = basedof2xdof[dofs[j] ];
+    });
 
-    for (int i = 0; i < nse; ++i)
+    cutinfo->ParallelForElementsOfDomainType(CDOM_IF, BND, [&] (int i)
     {
-      if (cutinfo->GetElementsOfDomainType(IF,BND)->Test(i))
-      {
-        FlatArray<int> dofs = (*sel2dofs)[i];
-        for (int j = 0; j < (*sel2dofs)[i].Size(); ++j)
-          (*sel2dofs)[i][j] = basedof2xdof[dofs[j] ];
-      }
-    }
+      FlatArray<int> dofs = (*sel2dofs)[i];
+      for (int j = 0; j < (*sel2dofs)[i].Size(); ++j)
+        (*sel2dofs)[i][j] = basedof2xdof[dofs[j] ];
+    });
 
     *testout << " x ndof : " << ndof << endl;
 
@@ -368,21 +361,17 @@ namespace ngcomp
     BitArray dofs_with_cut_on_boundary(GetNDof());
     dofs_with_cut_on_boundary.Clear();
 
-    for (int selnr = 0; selnr < nse; ++selnr)
+    cutinfo->ParallelForElementsOfDomainType(CDOM_IF, BND, [&] (int selnr)
     {
-      ElementId ei(BND,selnr);
-      DOMAIN_TYPE dt = cutinfo->DomainTypeOfElement(ei);
-      if (dt!=IF) continue;
-
       Array<int> dnums;
-      GetDofNrs(ei, dnums);
+      GetDofNrs(ElementId(BND,selnr), dnums);
 
       for (int i = 0; i < dnums.Size(); ++i)
       {
         const int xdof = dnums[i];
-        dofs_with_cut_on_boundary.Set(xdof);
+        dofs_with_cut_on_boundary.SetBitAtomic(xdof);
       }
-    }
+    });
 
     UpdateCouplingDofArray();
     FinalizeUpdate ();